@@ -0,0 +1,52 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-08 09:52:20
+ * @Contact: 2458006466@qq.com
+ * @Description: BloomFilter
+ */
+#include "Base/BloomFilter.h"
+#include "Base/Hash.h"
+#include <algorithm>
+#include <cmath>
+
+NAMESPACE_BEGIN
+BloomFilter::BloomFilter(size_t expected_items, double fp_rate) : size_(0) {
+  // m = -n * ln(p) / (ln2)^2, k = m / n * ln2
+  double n = static_cast<double>(std::max<size_t>(expected_items, 1));
+  double p = std::min(std::max(fp_rate, 1e-9), 0.5);
+  double m = std::ceil(-n * std::log(p) / (std::log(2.0) * std::log(2.0)));
+  size_t words = std::max<size_t>(static_cast<size_t>(m / 64) + 1, 1);
+  bits_ = words * 64;
+  hashes_ = std::min(std::max(static_cast<int>(std::round(bits_ / n * std::log(2.0))), 1), 16);
+  words_.reset(new std::atomic<uint64_t>[words]);
+  for (size_t i = 0; i < words; ++i) {
+    words_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void BloomFilter::Add(const StringPiece &key) {
+  // 由一次哈希的高低32位组合出k个哈希(Kirsch-Mitzenmacher)
+  uint64_t h = Hash::Fnv1a64(key.data(), key.size());
+  uint64_t h1 = h & 0xffffffffULL;
+  uint64_t h2 = (h >> 32) | 1;
+  for (int i = 0; i < hashes_; ++i) {
+    uint64_t bit = (h1 + i * h2) % bits_;
+    words_[bit >> 6].fetch_or(1ULL << (bit & 63), std::memory_order_release);
+  }
+  ++size_;
+}
+
+bool BloomFilter::MightContain(const StringPiece &key) const {
+  uint64_t h = Hash::Fnv1a64(key.data(), key.size());
+  uint64_t h1 = h & 0xffffffffULL;
+  uint64_t h2 = (h >> 32) | 1;
+  for (int i = 0; i < hashes_; ++i) {
+    uint64_t bit = (h1 + i * h2) % bits_;
+    if (!(words_[bit >> 6].load(std::memory_order_acquire) & (1ULL << (bit & 63)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+NAMESPACE_END
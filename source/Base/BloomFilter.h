@@ -0,0 +1,53 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-08 09:52:13
+ * @Contact: 2458006466@qq.com
+ * @Description: BloomFilter
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+NAMESPACE_BEGIN
+/**
+ * @brief 并发可读写的布隆过滤器，MightContain返回false时key一定不存在。
+ * 位数组由原子字组成，Add以fetch_or置位，读取不加锁；只能添加，不能删除。
+ * 插入的元素远超expected_items时误判率随之上升。
+ */
+class API BloomFilter {
+public:
+  /// @param expected_items 预计元素个数
+  /// @param fp_rate 元素个数为expected_items时的误判率
+  BloomFilter(size_t expected_items, double fp_rate);
+
+  void Add(const StringPiece &key);
+
+  bool MightContain(const StringPiece &key) const;
+
+  /// @brief 已添加的次数(重复添加同一元素时重复计数)
+  size_t size() const {
+    return size_;
+  }
+
+  size_t bits() const {
+    return bits_;
+  }
+
+  int hashes() const {
+    return hashes_;
+  }
+
+  NOT_ALLOWED_COPY(BloomFilter)
+
+private:
+  size_t bits_;
+  int hashes_;
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+  std::atomic<size_t> size_;
+};
+
+NAMESPACE_END
@@ -6,12 +6,12 @@
  */
 #include "Base/Buffer.h"
 #include "Base/Logger.h"
+#include "Base/ByteScan.h"
 #include <sys/uio.h>
 #include <errno.h>
+#include <string.h>
 
 NAMESPACE_BEGIN
-static const constexpr char kCRLF[] = "\r\n";
-
 Buffer::Buffer(size_t init_sz) :
   buffer_(kCheapPrepend + init_sz),
   reader_idx_(kCheapPrepend),
@@ -79,9 +79,16 @@ void Buffer::Append(const char *data, size_t len) {
   writer_idx_ += len;
 }
 
+void Buffer::Append(const char *str) {
+  Append(str, strlen(str));
+}
+
+void Buffer::HasWritten(size_t len) {
+  writer_idx_ += len;
+}
+
 const char *Buffer::FindCRLF() const {
-  const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-  return crlf;
+  return ByteScan::FindCRLF(peek(), beginWrite());
 }
 
 char *Buffer::begin() {
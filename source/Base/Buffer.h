@@ -49,6 +49,12 @@ public:
 
   void Append(const char *data, size_t len);
 
+  // 追加C字符串，避免字面量隐式构造临时std::string
+  void Append(const char *str);
+
+  // 直接写入beginWrite()之后，标记已写入的字节数
+  void HasWritten(size_t len);
+
   const char *FindCRLF() const;
 
   ssize_t ReadFd(int fd, int *save_errno);
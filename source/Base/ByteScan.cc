@@ -0,0 +1,287 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-22 09:32:04
+ * @Contact: 2458006466@qq.com
+ * @Description: ByteScan
+ */
+#include "Base/ByteScan.h"
+#include <atomic>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BYTESCAN_X86 1
+#include <immintrin.h>
+#else
+#define BYTESCAN_X86 0
+#endif
+
+NAMESPACE_BEGIN
+namespace ByteScan {
+namespace {
+/// @brief 各指令集实现的函数表
+struct ScanTable {
+  Isa isa;
+  const char *(*find_byte)(const char *, const char *, char);
+  const char *(*find_either)(const char *, const char *, char, char);
+  const char *(*find_non_token)(const char *, const char *);
+  const char *(*find_uri_end)(const char *, const char *, bool);
+};
+
+/// 1.标量实现
+struct TokenTable {
+  TokenTable() {
+    const char *extra = "!#$%&'*+-.^_`|~";
+    for (int i = 0; i < 256; ++i) {
+      tchar[i] = (i >= '0' && i <= '9') || (i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z');
+    }
+    for (const char *p = extra; *p; ++p) {
+      tchar[static_cast<unsigned char>(*p)] = true;
+    }
+  }
+  bool tchar[256];
+};
+const TokenTable kTokenTable;
+
+inline bool IsUriEnd(unsigned char ch, bool stop_at_query) {
+  return ch <= ' ' || ch == 0x7f || (stop_at_query && ch == '?');
+}
+
+const char *ScalarFindByte(const char *begin, const char *end, char ch) {
+  const void *p = memchr(begin, ch, end - begin);
+  return p ? static_cast<const char *>(p) : end;
+}
+
+const char *ScalarFindEither(const char *begin, const char *end, char a, char b) {
+  for (; begin < end; ++begin) {
+    if (*begin == a || *begin == b) {
+      return begin;
+    }
+  }
+  return end;
+}
+
+const char *ScalarFindNonToken(const char *begin, const char *end) {
+  for (; begin < end; ++begin) {
+    if (!kTokenTable.tchar[static_cast<unsigned char>(*begin)]) {
+      return begin;
+    }
+  }
+  return end;
+}
+
+const char *ScalarFindUriEnd(const char *begin, const char *end, bool stop_at_query) {
+  for (; begin < end; ++begin) {
+    if (IsUriEnd(*begin, stop_at_query)) {
+      return begin;
+    }
+  }
+  return end;
+}
+
+const ScanTable kScalarTable = {
+  kScalar, ScalarFindByte, ScalarFindEither, ScalarFindNonToken, ScalarFindUriEnd
+};
+
+#if BYTESCAN_X86
+/**
+ * 2.向量实现：每次比较16(SSE2)或32(AVX2)字节，得到匹配字节的位掩码，
+ * 取最低位即首个匹配位置，不足一个向量的尾部交给标量实现。
+ * 单字节查找直接使用libc的memchr，其本身已按CPU选择了向量实现。
+ * tchar判定：0x21~0x7E之间排除分隔符 "(),/:;<=>?@[\]{}，
+ * 其中部分分隔符连续，可用区间比较代替逐个比较。
+ */
+#define BYTESCAN_DEFINE_IMPL(NAME, VEC, WIDTH, LOAD, SET1, CMPEQ, OR, AND, ANDNOT, MAX, MIN, MOVEMASK, MASK_T) \
+  inline VEC NAME##InRange(VEC v, char lo, char hi) {                                                   \
+    return CMPEQ(MIN(MAX(v, SET1(lo)), SET1(hi)), v);                                                   \
+  }                                                                                                     \
+                                                                                                        \
+  inline VEC NAME##MatchNonToken(VEC v) {                                                               \
+    VEC printable = NAME##InRange(v, 0x21, 0x7e);                                                       \
+    VEC sep = OR(CMPEQ(v, SET1('"')), CMPEQ(v, SET1(',')));                                              \
+    sep = OR(sep, OR(CMPEQ(v, SET1('/')), CMPEQ(v, SET1('{'))));                                         \
+    sep = OR(sep, OR(CMPEQ(v, SET1('}')), NAME##InRange(v, '(', ')')));                                  \
+    sep = OR(sep, OR(NAME##InRange(v, ':', '@'), NAME##InRange(v, '[', ']')));                           \
+    return OR(ANDNOT(printable, CMPEQ(v, v)), AND(printable, sep));                                     \
+  }                                                                                                     \
+                                                                                                        \
+  inline VEC NAME##MatchUriEnd(VEC v, bool stop_at_query) {                                             \
+    VEC m = OR(ANDNOT(NAME##InRange(v, 0x21, static_cast<char>(0xff)), CMPEQ(v, v)),                     \
+               CMPEQ(v, SET1(0x7f)));                                                                   \
+    return stop_at_query ? OR(m, CMPEQ(v, SET1('?'))) : m;                                               \
+  }                                                                                                     \
+                                                                                                        \
+  const char *NAME##FindEither(const char *begin, const char *end, char a, char b) {                    \
+    VEC va = SET1(a);                                                                                   \
+    VEC vb = SET1(b);                                                                                   \
+    for (; end - begin >= WIDTH; begin += WIDTH) {                                                      \
+      VEC v = LOAD(begin);                                                                              \
+      MASK_T mask = MOVEMASK(OR(CMPEQ(v, va), CMPEQ(v, vb)));                                           \
+      if (mask) {                                                                                       \
+        return begin + __builtin_ctz(mask);                                                             \
+      }                                                                                                 \
+    }                                                                                                   \
+    return ScalarFindEither(begin, end, a, b);                                                          \
+  }                                                                                                     \
+                                                                                                        \
+  const char *NAME##FindNonToken(const char *begin, const char *end) {                                  \
+    for (; end - begin >= WIDTH; begin += WIDTH) {                                                      \
+      MASK_T mask = MOVEMASK(NAME##MatchNonToken(LOAD(begin)));                                         \
+      if (mask) {                                                                                       \
+        return begin + __builtin_ctz(mask);                                                             \
+      }                                                                                                 \
+    }                                                                                                   \
+    return ScalarFindNonToken(begin, end);                                                              \
+  }                                                                                                     \
+                                                                                                        \
+  const char *NAME##FindUriEnd(const char *begin, const char *end, bool stop_at_query) {                \
+    for (; end - begin >= WIDTH; begin += WIDTH) {                                                      \
+      MASK_T mask = MOVEMASK(NAME##MatchUriEnd(LOAD(begin), stop_at_query));                            \
+      if (mask) {                                                                                       \
+        return begin + __builtin_ctz(mask);                                                             \
+      }                                                                                                 \
+    }                                                                                                   \
+    return ScalarFindUriEnd(begin, end, stop_at_query);                                                 \
+  }
+
+#define SSE2_LOAD(p) _mm_loadu_si128(reinterpret_cast<const __m128i *>(p))
+#define AVX2_LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+BYTESCAN_DEFINE_IMPL(Sse2, __m128i, 16, SSE2_LOAD, _mm_set1_epi8, _mm_cmpeq_epi8, _mm_or_si128,
+                     _mm_and_si128, _mm_andnot_si128, _mm_max_epu8, _mm_min_epu8, _mm_movemask_epi8,
+                     unsigned)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+BYTESCAN_DEFINE_IMPL(Avx2, __m256i, 32, AVX2_LOAD, _mm256_set1_epi8, _mm256_cmpeq_epi8, _mm256_or_si256,
+                     _mm256_and_si256, _mm256_andnot_si256, _mm256_max_epu8, _mm256_min_epu8,
+                     _mm256_movemask_epi8, unsigned)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+const ScanTable kSse2Table = {
+  kSse2, ScalarFindByte, Sse2FindEither, Sse2FindNonToken, Sse2FindUriEnd
+};
+
+const ScanTable kAvx2Table = {
+  kAvx2, ScalarFindByte, Avx2FindEither, Avx2FindNonToken, Avx2FindUriEnd
+};
+#endif
+
+bool Supports(Isa isa) {
+#if BYTESCAN_X86
+  __builtin_cpu_init();
+  switch (isa) {
+    case kAvx2: return __builtin_cpu_supports("avx2");
+    case kSse2: return __builtin_cpu_supports("sse2");
+    default: return true;
+  }
+#else
+  return isa == kScalar;
+#endif
+}
+
+const ScanTable *TableOf(Isa isa) {
+#if BYTESCAN_X86
+  if (isa == kAvx2) return &kAvx2Table;
+  if (isa == kSse2) return &kSse2Table;
+#endif
+  return &kScalarTable;
+}
+
+std::atomic<const ScanTable *> &Active() {
+  static std::atomic<const ScanTable *> table(
+    TableOf(Supports(kAvx2) ? kAvx2 : (Supports(kSse2) ? kSse2 : kScalar))
+  );
+  return table;
+}
+
+inline const ScanTable *Table() {
+  return Active().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+Isa activeIsa() {
+  return Table()->isa;
+}
+
+const char *isaName(Isa isa) {
+  switch (isa) {
+    case kAvx2: return "avx2";
+    case kSse2: return "sse2";
+    default: return "scalar";
+  }
+}
+
+bool setIsa(Isa isa) {
+  if (!Supports(isa)) {
+    return false;
+  }
+  Active().store(TableOf(isa), std::memory_order_relaxed);
+  return true;
+}
+
+const char *FindByte(const char *begin, const char *end, char ch) {
+  return Table()->find_byte(begin, end, ch);
+}
+
+const char *FindEither(const char *begin, const char *end, char a, char b) {
+  return Table()->find_either(begin, end, a, b);
+}
+
+const char *FindCRLF(const char *begin, const char *end) {
+  const ScanTable *table = Table();
+  for (;;) {
+    const char *cr = table->find_byte(begin, end, '\r');
+    if (cr == end || (cr + 1 < end && cr[1] == '\n')) {
+      return cr;
+    }
+    if (cr + 1 == end) {
+      return end;
+    }
+    begin = cr + 1;
+  }
+}
+
+const char *FindHeaderEnd(const char *begin, const char *end) {
+  const ScanTable *table = Table();
+  for (;;) {
+    const char *cr = table->find_byte(begin, end, '\r');
+    if (end - cr < 4) {
+      return end;
+    }
+    if (memcmp(cr, "\r\n\r\n", 4) == 0) {
+      return cr;
+    }
+    begin = cr + 1;
+  }
+}
+
+const char *FindNonToken(const char *begin, const char *end) {
+  return Table()->find_non_token(begin, end);
+}
+
+const char *FindUriEnd(const char *begin, const char *end, bool stop_at_query) {
+  return Table()->find_uri_end(begin, end, stop_at_query);
+}
+
+} // namespace ByteScan
+NAMESPACE_END
@@ -0,0 +1,68 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-22 09:31:50
+ * @Contact: 2458006466@qq.com
+ * @Description: ByteScan
+ */
+#pragma once
+
+#include "Api.h"
+#include <stddef.h>
+
+NAMESPACE_BEGIN
+/**
+ * @brief Http解析用的字节扫描原语，按CPU支持情况在运行时选择AVX2/SSE2/标量实现。
+ * 所有查找函数在[begin, end)中查找，未找到时返回end。
+ */
+namespace ByteScan {
+enum Isa {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+/// @brief 当前使用的指令集
+Isa API activeIsa();
+
+/// @brief 指令集名称
+API const char *isaName(Isa isa);
+
+/// @brief 切换实现(用于基准测试及一致性校验)
+/// @return CPU不支持该指令集时返回false且不切换
+bool API setIsa(Isa isa);
+
+/// @brief 查找字节ch
+API const char *FindByte(const char *begin, const char *end, char ch);
+
+/// @brief 查找字节a或b
+API const char *FindEither(const char *begin, const char *end, char a, char b);
+
+/// @brief 查找"\r\n"，返回'\r'的位置
+API const char *FindCRLF(const char *begin, const char *end);
+
+/// @brief 查找头部结束标志"\r\n\r\n"，返回第一个'\r'的位置
+API const char *FindHeaderEnd(const char *begin, const char *end);
+
+/// @brief 查找行结束符'\r'或'\n'
+inline const char *FindLineEnd(const char *begin, const char *end) {
+  return FindEither(begin, end, '\r', '\n');
+}
+
+/// @brief 查找表单编码中需要转义处理的'%'或'+'
+inline const char *FindUrlEscape(const char *begin, const char *end) {
+  return FindEither(begin, end, '%', '+');
+}
+
+/// @brief 查找第一个不属于RFC 7230 tchar集合的字节
+API const char *FindNonToken(const char *begin, const char *end);
+
+/// @brief 查找请求目标的结束位置：空格、控制字符，stop_at_query为true时也包括'?'
+API const char *FindUriEnd(const char *begin, const char *end, bool stop_at_query);
+
+/// @brief [begin, end)是否为非空token
+inline bool IsToken(const char *begin, const char *end) {
+  return begin != end && FindNonToken(begin, end) == end;
+}
+
+} // namespace ByteScan
+NAMESPACE_END
@@ -0,0 +1,31 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-25 09:21:44
+ * @Contact: 2458006466@qq.com
+ * @Description: Hash
+ */
+#pragma once
+
+#include "Api.h"
+#include <stddef.h>
+#include <stdint.h>
+
+NAMESPACE_BEGIN
+namespace Hash {
+/// @brief 64位FNV-1a哈希，seed不同时得到相互独立的哈希函数
+inline uint64_t Fnv1a64(const void *data, size_t len, uint64_t seed = 0) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  uint64_t h = 14695981039346656037ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+  for (size_t i = 0; i < len; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  // FNV低位扩散较差，取模前再混合一次
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+} // namespace Hash
+NAMESPACE_END
@@ -7,7 +7,10 @@
 #include "Base/Logger.h"
 
 NAMESPACE_BEGIN
-Logger::Logger() = default;
+Logger::Logger() {
+  // 先于Logger构造spdlog注册表，使其晚于Logger析构，析构时的shutdown才能安全访问
+  spdlog::details::registry::instance();
+}
 Logger::~Logger() { spdlog::shutdown(); }
 
 void Logger::setLogPathImpl(const char *log_file_path) {
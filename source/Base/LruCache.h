@@ -0,0 +1,175 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-08 15:40:26
+ * @Contact: 2458006466@qq.com
+ * @Description: LruCache
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/Hash.h"
+#include "Base/Timestamp.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+NAMESPACE_BEGIN
+/// @brief 缓存的命中统计，过期的元素计为未命中
+struct LruCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t expirations;
+
+  double hitRatio() const {
+    uint64_t total = hits + misses;
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+  }
+};
+
+/**
+ * @brief 分片的LRU缓存，键为字符串，每个元素带有过期时间。
+ * 按键的哈希分到各自带锁的分片中，不同分片的访问互不阻塞；
+ * 分片满时淘汰最久未使用的元素，过期元素在访问时删除。
+ */
+template <typename Value>
+class ShardedLruCache {
+public:
+  using Stats = LruCacheStats;
+
+  /// @param capacity 所有分片的元素总数上限
+  /// @param shards 分片个数
+  explicit ShardedLruCache(size_t capacity, size_t shards = 16) :
+    shards_(new Shard[shards]),
+    num_shards_(shards),
+    shard_capacity_(std::max<size_t>((capacity + shards - 1) / shards, 1)),
+    hits_(0),
+    misses_(0),
+    evictions_(0),
+    expirations_(0) {
+
+  }
+
+  /// @brief 查找未过期的元素，命中时移到最近使用的位置
+  /// @return 是否命中
+  bool Get(const std::string &key, Value *value) {
+    Shard &shard = shardOf(key);
+    int64_t now = Timestamp::Now().microSecondsSinceEpoch();
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      ++misses_;
+      return false;
+    }
+    if (it->second->expire_us <= now) {
+      shard.lru.erase(it->second);
+      shard.index.erase(it);
+      ++expirations_;
+      ++misses_;
+      return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    *value = it->second->value;
+    ++hits_;
+    return true;
+  }
+
+  /// @brief 插入或替换元素
+  /// @param ttl_ms 存活时间
+  void Put(const std::string &key, const Value &value, int64_t ttl_ms) {
+    Shard &shard = shardOf(key);
+    int64_t expire = Timestamp::Now().microSecondsSinceEpoch() + ttl_ms * 1000;
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      it->second->value = value;
+      it->second->expire_us = expire;
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      return;
+    }
+    if (shard.index.size() >= shard_capacity_) {
+      shard.index.erase(shard.lru.back().key);
+      shard.lru.pop_back();
+      ++evictions_;
+    }
+    shard.lru.push_front(Entry{ key, value, expire });
+    shard.index.emplace(key, shard.lru.begin());
+  }
+
+  /// @return 是否删除了元素
+  bool Erase(const std::string &key) {
+    Shard &shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      return false;
+    }
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+    return true;
+  }
+
+  /// @brief 逐个分片遍历未过期的元素，fn(key, value, expire_us)在分片锁内执行
+  template <typename Func>
+  void ForEach(Func fn) {
+    int64_t now = Timestamp::Now().microSecondsSinceEpoch();
+    for (size_t i = 0; i < num_shards_; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mtx);
+      for (const Entry &entry : shards_[i].lru) {
+        if (entry.expire_us > now) {
+          fn(entry.key, entry.value, entry.expire_us);
+        }
+      }
+    }
+  }
+
+  size_t size() {
+    size_t total = 0;
+    for (size_t i = 0; i < num_shards_; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mtx);
+      total += shards_[i].index.size();
+    }
+    return total;
+  }
+
+  Stats stats() const {
+    return Stats{ hits_, misses_, evictions_, expirations_ };
+  }
+
+  NOT_ALLOWED_COPY(ShardedLruCache)
+
+private:
+  struct Entry {
+    std::string key;
+    Value value;
+    int64_t expire_us;
+  };
+
+  struct Shard {
+    std::mutex mtx;
+    /// @brief 最近使用的在前
+    std::list<Entry> lru;
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index;
+  };
+
+  Shard &shardOf(const std::string &key) {
+    return shards_[Hash::Fnv1a64(key.data(), key.size()) % num_shards_];
+  }
+
+private:
+  std::unique_ptr<Shard[]> shards_;
+  const size_t num_shards_;
+  const size_t shard_capacity_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> evictions_;
+  std::atomic<uint64_t> expirations_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,126 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-21 10:12:36
+ * @Contact: 2458006466@qq.com
+ * @Description: StringPiece
+ */
+#pragma once
+
+#include "Api.h"
+#include <string.h>
+#include <string>
+#include <ostream>
+
+NAMESPACE_BEGIN
+/// @brief 只读字符串视图，不持有数据，指向的内存须在使用期间保持有效
+class StringPiece {
+public:
+  static const size_t npos = std::string::npos;
+
+  StringPiece() : ptr_(nullptr), len_(0) {}
+  StringPiece(const char *str) : ptr_(str), len_(str ? strlen(str) : 0) {}
+  StringPiece(const std::string &str) : ptr_(str.data()), len_(str.size()) {}
+  StringPiece(const char *ptr, size_t len) : ptr_(ptr), len_(len) {}
+
+  const char *data() const { return ptr_; }
+  size_t size() const { return len_; }
+  bool empty() const { return len_ == 0; }
+  const char *begin() const { return ptr_; }
+  const char *end() const { return ptr_ + len_; }
+
+  char operator[](size_t i) const { return ptr_[i]; }
+
+  void set(const char *ptr, size_t len) {
+    ptr_ = ptr;
+    len_ = len;
+  }
+
+  void clear() {
+    ptr_ = nullptr;
+    len_ = 0;
+  }
+
+  void RemovePrefix(size_t n) {
+    ptr_ += n;
+    len_ -= n;
+  }
+
+  void RemoveSuffix(size_t n) {
+    len_ -= n;
+  }
+
+  StringPiece substr(size_t pos, size_t n = std::string::npos) const {
+    if (pos > len_) {
+      pos = len_;
+    }
+    if (n > len_ - pos) {
+      n = len_ - pos;
+    }
+    return StringPiece(ptr_ + pos, n);
+  }
+
+  /// @brief 查找子串，未找到返回npos
+  size_t find(const StringPiece &x, size_t pos = 0) const {
+    if (pos > len_) {
+      return npos;
+    }
+    const void *p = memmem(ptr_ + pos, len_ - pos, x.ptr_, x.len_);
+    return p ? static_cast<const char *>(p) - ptr_ : npos;
+  }
+
+  bool StartsWith(const StringPiece &x) const {
+    return len_ >= x.len_ && memcmp(ptr_, x.ptr_, x.len_) == 0;
+  }
+
+  /// @brief 忽略大小写比较，用于Http头部字段名及标记值
+  bool EqualsIgnoreCase(const StringPiece &x) const {
+    if (len_ != x.len_) {
+      return false;
+    }
+    for (size_t i = 0; i < len_; ++i) {
+      if (ToLower(ptr_[i]) != ToLower(x.ptr_[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int compare(const StringPiece &x) const {
+    int r = memcmp(ptr_, x.ptr_, len_ < x.len_ ? len_ : x.len_);
+    if (r == 0) {
+      if (len_ < x.len_) r = -1;
+      else if (len_ > x.len_) r = +1;
+    }
+    return r;
+  }
+
+  std::string ToString() const {
+    return std::string(ptr_, len_);
+  }
+
+  static char ToLower(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+  }
+
+private:
+  const char *ptr_;
+  size_t len_;
+};
+
+inline bool operator==(const StringPiece &x, const StringPiece &y) {
+  return x.size() == y.size() && memcmp(x.data(), y.data(), x.size()) == 0;
+}
+
+inline bool operator!=(const StringPiece &x, const StringPiece &y) {
+  return !(x == y);
+}
+
+inline bool operator<(const StringPiece &x, const StringPiece &y) {
+  return x.compare(y) < 0;
+}
+
+inline std::ostream &operator<<(std::ostream &os, const StringPiece &piece) {
+  return os.write(piece.data(), piece.size());
+}
+
+NAMESPACE_END
@@ -0,0 +1,103 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-28 09:40:24
+ * @Contact: 2458006466@qq.com
+ * @Description: ThreadPool
+ */
+#include "Base/ThreadPool.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <algorithm>
+
+NAMESPACE_BEGIN
+ThreadPool::ThreadPool(const std::string &name) :
+  name_(name),
+  max_queue_size_(65536),
+  running_(false),
+  active_(0),
+  executed_(0),
+  rejected_(0),
+  total_wait_us_(0),
+  max_wait_us_(0) {
+
+}
+
+ThreadPool::~ThreadPool() {
+  Stop();
+}
+
+void ThreadPool::Start(int num_threads) {
+  CHECK(!running_) << "ThreadPool " << name_ << " already started.";
+  running_ = true;
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(new Thread(std::bind(&ThreadPool::WorkerLoop, this), name_ + std::to_string(i)));
+    threads_.back()->Start();
+  }
+}
+
+void ThreadPool::Stop() {
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    tasks_.clear();
+  }
+  cond_.notify_all();
+  for (auto &thread : threads_) {
+    thread->Join();
+  }
+  threads_.clear();
+}
+
+bool ThreadPool::Run(Task task) {
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!running_ || tasks_.size() >= max_queue_size_) {
+      ++rejected_;
+      return false;
+    }
+    tasks_.push_back(Job{ std::move(task), Timestamp::Now().microSecondsSinceEpoch() });
+  }
+  cond_.notify_one();
+  return true;
+}
+
+size_t ThreadPool::queueSize() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  return tasks_.size();
+}
+
+ThreadPool::Stats ThreadPool::stats() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  return Stats{ tasks_.size(), active_, executed_, rejected_, total_wait_us_, max_wait_us_ };
+}
+
+void ThreadPool::WorkerLoop() {
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cond_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+      if (!running_) {
+        return;
+      }
+      Job &job = tasks_.front();
+      task = std::move(job.task);
+      int64_t wait = Timestamp::Now().microSecondsSinceEpoch() - job.enqueue_us;
+      uint64_t wait_us = wait > 0 ? static_cast<uint64_t>(wait) : 0;
+      total_wait_us_ += wait_us;
+      max_wait_us_ = std::max(max_wait_us_, wait_us);
+      tasks_.pop_front();
+      ++active_;
+    }
+    task();
+    std::unique_lock<std::mutex> lock(mtx_);
+    --active_;
+    ++executed_;
+  }
+}
+
+NAMESPACE_END
@@ -0,0 +1,89 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-28 09:40:16
+ * @Contact: 2458006466@qq.com
+ * @Description: ThreadPool
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/Thread.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN
+/**
+ * @brief 固定数量的工作线程，执行压缩、数据库访问等不应占用IO线程的任务。
+ * 任务队列有上限，队列满时Run直接返回false，由调用方决定降级处理。
+ */
+class API ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  /// @brief 运行统计，等待时间为任务从提交到开始执行的时间
+  struct Stats {
+    size_t queue_size;
+    size_t active;
+    uint64_t executed;
+    uint64_t rejected;
+    uint64_t total_wait_us;
+    uint64_t max_wait_us;
+  };
+
+  explicit ThreadPool(const std::string &name = std::string("ThreadPool"));
+  ~ThreadPool();
+
+  /// @brief 设置任务队列上限，须在Start之前调用
+  void setMaxQueueSize(size_t max_size) {
+    max_queue_size_ = max_size;
+  }
+
+  void Start(int num_threads);
+
+  /// @brief 停止接收任务，丢弃未执行的任务并等待工作线程退出
+  void Stop();
+
+  /// @brief 提交任务
+  /// @return 线程池未启动、已停止或队列已满时返回false
+  bool Run(Task task);
+
+  size_t queueSize();
+
+  Stats stats();
+
+  bool running() const {
+    return running_;
+  }
+
+private:
+  struct Job {
+    Task task;
+    int64_t enqueue_us;
+  };
+
+  void WorkerLoop();
+
+  NOT_ALLOWED_COPY(ThreadPool)
+
+private:
+  std::string name_;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::deque<Job> tasks_;
+  std::vector<std::unique_ptr<Thread>> threads_;
+  size_t max_queue_size_;
+  bool running_;
+  size_t active_;
+  uint64_t executed_;
+  uint64_t rejected_;
+  uint64_t total_wait_us_;
+  uint64_t max_wait_us_;
+};
+
+NAMESPACE_END
@@ -5,6 +5,9 @@
  * @Description: Timestamp
  */
 #include "Base/Timestamp.h"
+#include <ctime>
+#include <stdio.h>
+#include <string.h>
 #include <sys/time.h>
 
 NAMESPACE_BEGIN
@@ -32,4 +35,28 @@ std::string Timestamp::toFormattedString(bool showMicroseconds) const {
   return buf;
 }
 
+size_t Timestamp::FormatHttpDate(time_t seconds, char *buf) {
+  struct tm tm_time;
+  gmtime_r(&seconds, &tm_time);
+  return strftime(buf, kHttpDateSize, "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+}
+
+bool Timestamp::ParseHttpDate(const std::string &str, time_t *seconds) {
+  static const char *kFormats[] = {
+    "%a, %d %b %Y %H:%M:%S GMT",
+    "%A, %d-%b-%y %H:%M:%S GMT",
+    "%a %b %e %H:%M:%S %Y",
+  };
+  for (const char *format : kFormats) {
+    struct tm tm_time;
+    memset(&tm_time, 0, sizeof(tm_time));
+    const char *end = strptime(str.c_str(), format, &tm_time);
+    if (end && *end == '\0') {
+      *seconds = timegm(&tm_time);
+      return true;
+    }
+  }
+  return false;
+}
+
 NAMESPACE_END
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "Api.h"
+#include <ctime>
 #include <string>
 
 NAMESPACE_BEGIN
@@ -36,6 +37,15 @@ public:
 
   static Timestamp invalid() { return Timestamp(); }
 
+  /// @brief HTTP日期格式(IMF-fixdate)，如"Sun, 06 Nov 1994 08:49:37 GMT"
+  /// @param buf 至少kHttpDateSize字节
+  /// @return 写入的字符数(不含结尾'\0')
+  static size_t FormatHttpDate(time_t seconds, char *buf);
+  static const size_t kHttpDateSize = 32;
+
+  /// @brief 解析HTTP日期，兼容IMF-fixdate、RFC 850及asctime三种格式
+  static bool ParseHttpDate(const std::string &str, time_t *seconds);
+
 private:
   int64_t micro_seconds_since_epoch_;
 };
@@ -34,6 +34,7 @@ EventLoop::EventLoop() :
   poller_(Poller::newDefaultPoller(this)),
   wakeup_fd_(CreateEvenfd()),
   wakeup_channel_(new Channel(this, wakeup_fd_)),
+  timer_queue_(new TimerQueue(this)),
   curr_active_channel_(nullptr) {
   // 该线程已绑定某个EventLoop对象了，那么该线程就无法创建新EventLoop对象
   if (t_loop_in_this_thread) {
@@ -83,7 +84,8 @@ void EventLoop::Loop() {
 
 void EventLoop::Quit() {
   quit_ = true;
-  if (isInLoopThread()) {
+  // 其他线程调用时loop可能阻塞在Poll中，须唤醒
+  if (!isInLoopThread()) {
     Wakeup();
   }
 }
@@ -120,6 +122,22 @@ void EventLoop::Wakeup() {
   }
 }
 
+TimerQueue::TimerId EventLoop::RunAt(Timestamp time, Functor cb) {
+  return timer_queue_->AddTimer(std::move(cb), time, 0.0);
+}
+
+TimerQueue::TimerId EventLoop::RunAfter(double delay, Functor cb) {
+  return RunAt(addTime(Timestamp::Now(), delay), std::move(cb));
+}
+
+TimerQueue::TimerId EventLoop::RunEvery(double interval, Functor cb) {
+  return timer_queue_->AddTimer(std::move(cb), addTime(Timestamp::Now(), interval), interval);
+}
+
+void EventLoop::Cancel(TimerId id) {
+  timer_queue_->Cancel(id);
+}
+
 /// @brief wakeup_channel_绑定的读回调函数
 void EventLoop::HandleRead() {
   uint64_t one = 1;
@@ -16,6 +16,7 @@
 #include "Base/Timestamp.h"
 #include "Base/CurrentThread.h"
 #include "Base/Logger.h"
+#include "Core/TimerQueue.h"
 
 NAMESPACE_BEGIN
 class Channel;
@@ -33,6 +34,7 @@ class Poller;
 class API EventLoop {
 public:
   using Functor = std::function<void()>;
+  using TimerId = TimerQueue::TimerId;
 
   EventLoop();
   ~EventLoop();
@@ -56,6 +58,18 @@ public:
   /// @brief 唤醒loop所在线程
   void Wakeup();
 
+  /// @brief 在time时刻于loop线程执行cb，可在任意线程调用
+  TimerId RunAt(Timestamp time, Functor cb);
+
+  /// @brief delay秒后执行cb
+  TimerId RunAfter(double delay, Functor cb);
+
+  /// @brief 每隔interval秒执行一次cb
+  TimerId RunEvery(double interval, Functor cb);
+
+  /// @brief 取消定时器
+  void Cancel(TimerId id);
+
   /// EventLoop => Poller
   void UpdateChannel(Channel *channel);
   void RemoveChannel(Channel *channel);
@@ -99,6 +113,9 @@ private:
   int wakeup_fd_;
   std::unique_ptr<Channel> wakeup_channel_;
 
+  /// @brief 定时器，声明在poller_之后，先于其析构
+  std::unique_ptr<TimerQueue> timer_queue_;
+
   /// @brief epoll_wait后获取到的事件
   using ChannelList = std::vector<Channel*>;
   ChannelList active_channels_;
@@ -21,7 +21,7 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb, const std::string
 EventLoopThread::~EventLoopThread() {
   exiting_ = true;
   if (loop_) {
-    loop_->Loop();
+    loop_->Quit();
     thread_.Join();
   }
 }
@@ -32,7 +32,8 @@ int Socket::Accept(InetAddress *perr_addr) {
   socklen_t addr_len = sizeof(addr);
   memset(&addr, 0, sizeof(addr));
 
-  int clnt_sockfd = accept(sockfd_, (sockaddr*) &addr, &addr_len);
+  // 连接须为非阻塞，否则对端接收缓慢时write阻塞整个loop，发送缓冲区及高水位均不起作用
+  int clnt_sockfd = accept4(sockfd_, (sockaddr*) &addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (clnt_sockfd >= 0) {
     perr_addr->setSockAddr(addr);
   } else {
@@ -10,7 +10,8 @@
 #include <errno.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
-#include <functional>
+#include <limits.h>
+#include <algorithm>
 
 #include "Base/Logger.h"
 #include "Core/Socket.h"
@@ -26,11 +27,14 @@ TcpConnection::TcpConnection(
   name_(name),
   state_(kConnecting),
   reading_(true),
+  throttled_(false),
   socket_(new Socket(sockfd)),
   channel_(new Channel(loop, sockfd)),
   local_addr_(local_addr),
   peer_addr_(peer_addr),
-  high_water_mark_(64 * 1024 * 1024) {
+  high_water_mark_(64 * 1024 * 1024),
+  low_water_mark_(16 * 1024 * 1024),
+  context_type_(nullptr) {
   channel_->setReadCallback(
     std::bind(&TcpConnection::HandleRead, this, std::placeholders::_1)
   );
@@ -49,6 +53,9 @@ TcpConnection::TcpConnection(
 }
 
 TcpConnection::~TcpConnection() {
+  if (output_budget_) {
+    output_budget_->used -= output_.ReadableBytes();
+  }
   LogInfo("TcpConnection::dtor [{}] at fd = {}.", name_, channel_->sockfd());
 }
 
@@ -64,7 +71,17 @@ void TcpConnection::Send(const std::string &buf) {
   }
 }
 
-void TcpConnection::SendInLoopImpl(const void *msg, size_t len) {
+void TcpConnection::SendV(const struct iovec *iov, int iovcnt) {
+  if (state_ == kConnected) {
+    SendInLoopImpl(iov, iovcnt);
+  }
+}
+
+void TcpConnection::SendInLoopImpl(const struct iovec *iov, int iovcnt) {
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    len += iov[i].iov_len;
+  }
   ssize_t nwrote = 0;
   size_t remaining = len;
   bool fault_error = false;
@@ -75,9 +92,9 @@ void TcpConnection::SendInLoopImpl(const void *msg, size_t len) {
     return;
   }
 
-  // 2.channel第一次写数据，且缓冲区无待发送数据
-  if (!channel_->isWriting() && output_.ReadableBytes() == 0) {
-    nwrote = write(channel_->sockfd(), msg, len);
+  // 2.channel第一次写数据，且缓冲区无待发送数据，多段数据用一次writev写出
+  if (!channel_->isWriting() && output_.ReadableBytes() == 0 && len > 0) {
+    nwrote = writev(channel_->sockfd(), iov, std::min(iovcnt, IOV_MAX));
     if (nwrote >= 0) {
       // 2.1 判断是否一次写完
       remaining = len - nwrote;
@@ -110,15 +127,32 @@ void TcpConnection::SendInLoopImpl(const void *msg, size_t len) {
       std::bind(high_water_cb_, shared_from_this(), old_len + remaining)
     );
   }
-  output_.Append((char*)msg + nwrote, remaining);
+  size_t skip = nwrote;
+  for (int i = 0; i < iovcnt; ++i) {
+    const char *base = static_cast<const char *>(iov[i].iov_base);
+    size_t seg_len = iov[i].iov_len;
+    if (skip >= seg_len) {
+      skip -= seg_len;
+      continue;
+    }
+    output_.Append(base + skip, seg_len - skip);
+    skip = 0;
+  }
+  if (output_budget_) {
+    output_budget_->used += remaining;
+  }
   if (!channel_->isWriting()) {
     // 注册channel的写事件
     channel_->EnableWriting();
   }
+  CheckBackpressure();
 }
 
 void TcpConnection::SendInLoop(const std::string &str) {
-  SendInLoopImpl(str.c_str(), str.size());
+  struct iovec iov;
+  iov.iov_base = const_cast<char *>(str.data());
+  iov.iov_len = str.size();
+  SendInLoopImpl(&iov, 1);
 }
 
 void TcpConnection::Shutdown() {
@@ -137,6 +171,58 @@ void TcpConnection::ShutdownInLoop() {
   }
 }
 
+void TcpConnection::StartRead() {
+  loop_->RunInLoop(
+    std::bind(&TcpConnection::StartReadInLoop, this)
+  );
+}
+
+void TcpConnection::StartReadInLoop() {
+  reading_ = true;
+  UpdateReadInterest();
+}
+
+void TcpConnection::StopRead() {
+  loop_->RunInLoop(
+    std::bind(&TcpConnection::StopReadInLoop, this)
+  );
+}
+
+void TcpConnection::StopReadInLoop() {
+  reading_ = false;
+  UpdateReadInterest();
+}
+
+void TcpConnection::CheckBackpressure() {
+  size_t pending = output_.ReadableBytes();
+  bool over_budget = output_budget_ && output_budget_->exceeded();
+  if (!throttled_) {
+    // 1.本连接积压超过高水位，或服务器总量超限且本连接也有积压，暂停读取
+    if (pending >= high_water_mark_ || (over_budget && pending > 0)) {
+      throttled_ = true;
+      LogDebug("TcpConnection [{}] pauses reading, {} bytes pending.", name_, pending);
+      UpdateReadInterest();
+    }
+  } else if (pending <= low_water_mark_ && (pending == 0 || !over_budget)) {
+    // 2.回落到低水位以下恢复读取，缓冲区发送完毕后无后续写事件，须无条件恢复
+    throttled_ = false;
+    LogDebug("TcpConnection [{}] resumes reading, {} bytes pending.", name_, pending);
+    UpdateReadInterest();
+  }
+}
+
+void TcpConnection::UpdateReadInterest() {
+  if (state_ == kDisconnected) {
+    return;
+  }
+  bool want = reading_ && !throttled_;
+  if (want && !channel_->isReading()) {
+    channel_->EnableReading();
+  } else if (!want && channel_->isReading()) {
+    channel_->DisableReading();
+  }
+}
+
 /// @brief 创建连接
 void TcpConnection::ConnectEstablished() {
   // 1.建立连接，设置状态为连接态
@@ -144,7 +230,9 @@ void TcpConnection::ConnectEstablished() {
   // 2.让channel记录相关TcpConnection
   channel_->Tie(shared_from_this());
   // 3.向poller注册channel的EPOLLIN读事件
-  channel_->EnableReading();
+  if (reading_) {
+    channel_->EnableReading();
+  }
   // 4.调用连接回调函数
   conn_cb_(shared_from_this());
 }
@@ -185,6 +273,10 @@ void TcpConnection::HandleWrite() {
     if (n > 0) {
       // 2.更新内容索引
       output_.Retrieve(n);
+      if (output_budget_) {
+        output_budget_->used -= n;
+      }
+      CheckBackpressure();
       // 3.output_中数据读取完毕并写入到客户端socket
       if (output_.ReadableBytes() == 0) {
         channel_->DisableWriting();
@@ -10,6 +10,8 @@
 #include <memory>
 #include <atomic>
 #include <string>
+#include <typeinfo>
+#include <sys/uio.h>
 
 #include "Base/Timestamp.h"
 #include "Base/Buffer.h"
@@ -20,6 +22,23 @@ NAMESPACE_BEGIN
 class Channel;
 class EventLoop;
 class Socket;
+
+/// @brief 服务器级发送缓冲区总量统计，由TcpServer创建并在所有连接间共享，
+/// 慢速对端导致的待发送数据总量超过limit后，各连接暂停读取
+struct OutputBudget {
+  OutputBudget() : limit(0), used(0) {}
+
+  /// @brief 是否已超出总量上限，limit为0表示不限制
+  bool exceeded() const {
+    size_t max_bytes = limit.load(std::memory_order_relaxed);
+    return max_bytes > 0 && used.load(std::memory_order_relaxed) >= max_bytes;
+  }
+
+  std::atomic<size_t> limit;   // 所有连接发送缓冲区总字节数上限
+  std::atomic<size_t> used;    // 所有连接发送缓冲区当前总字节数
+};
+using OutputBudgetPtr = std::shared_ptr<OutputBudget>;
+
 /**
  * @brief 用于subLoop中，对连接的sockfd及其相关方法进行封装
  * (读时间、发送事件、消息事件、连接关闭事件及错误事件等)
@@ -54,9 +73,31 @@ public:
   }
 
   void Send(const std::string &buf);
+
+  /// @brief 聚集写，多段数据一次writev发出，未写完部分拷贝进发送缓冲区，
+  /// 因此调用返回后iov指向的内存即可释放。须在所属loop线程调用
+  /// @param iov 待发送数据段
+  /// @param iovcnt 数据段个数
+  void SendV(const struct iovec *iov, int iovcnt);
   
   void Shutdown();
 
+  /// @brief 开始(恢复)监听读事件
+  void StartRead();
+
+  /// @brief 停止监听读事件，内核接收缓冲区写满后由TCP流控反压对端
+  void StopRead();
+
+  /// @brief 用户是否希望读取数据(不含高水位导致的自动暂停)
+  bool isReading() const {
+    return reading_;
+  }
+
+  /// @brief 接收缓冲区，上层暂停解析后可在恢复时直接处理其中剩余的数据，须在所属loop线程调用
+  Buffer *inputBuffer() {
+    return &input_;
+  }
+
   void setConnectionCallback(const ConnectionCallback &cb) {
     conn_cb_ = cb;
   }
@@ -78,6 +119,39 @@ public:
     high_water_mark_ = high_water_mark;
   }
 
+  /// @brief 设置低水位，发送缓冲区超过高水位后暂停读取，回落到低水位以下再恢复
+  void setLowWaterMark(size_t low_water_mark) {
+    low_water_mark_ = low_water_mark;
+  }
+
+  /// @brief 设置服务器级发送缓冲区总量统计
+  void setOutputBudget(const OutputBudgetPtr &budget) {
+    output_budget_ = budget;
+  }
+
+  /// @brief 设置连接上下文(如协议解析状态)，跨多次消息回调保持
+  /// @param context 上下文对象，随连接一起销毁
+  template <typename T>
+  void setContext(const std::shared_ptr<T> &context) {
+    context_ = context;
+    context_type_ = &typeid(T);
+  }
+
+  /// @brief 获取连接上下文
+  /// @return 类型与setContext时一致则返回上下文指针，否则返回nullptr
+  template <typename T>
+  T *getContext() const {
+    if (context_type_ == nullptr || *context_type_ != typeid(T)) {
+      return nullptr;
+    }
+    return static_cast<T *>(context_.get());
+  }
+
+  void clearContext() {
+    context_.reset();
+    context_type_ = nullptr;
+  }
+
   void ConnectEstablished();
   void ConnectDestroyed();
 
@@ -106,8 +180,16 @@ private:
   void HandleError();
 
   void SendInLoop(const std::string &str);
-  void SendInLoopImpl(const void *msg, size_t len);
+  void SendInLoopImpl(const struct iovec *iov, int iovcnt);
   void ShutdownInLoop();
+  void StartReadInLoop();
+  void StopReadInLoop();
+
+  /// @brief 根据发送缓冲区水位及服务器总量决定是否暂停/恢复读取
+  void CheckBackpressure();
+
+  /// @brief 根据reading_和throttled_同步channel读事件注册状态
+  void UpdateReadInterest();
 
   NOT_ALLOWED_COPY(TcpConnection)
 
@@ -116,7 +198,8 @@ private:
   EventLoop *loop_;
   const std::string name_;
   std::atomic_int state_;    // 连接状态
-  bool reading_;
+  bool reading_;             // 用户是否希望读取数据
+  bool throttled_;           // 是否因发送缓冲区积压而暂停读取
 
   /// @brief 保存已连接sockfd
   std::unique_ptr<Socket> socket_;
@@ -132,6 +215,12 @@ private:
   CloseCallback cls_cb_;
   HighWaterMarkCallback high_water_cb_;
   size_t high_water_mark_;
+  size_t low_water_mark_;
+  OutputBudgetPtr output_budget_;
+
+  /// @brief 用户设置的连接上下文及其类型
+  std::shared_ptr<void> context_;
+  const std::type_info *context_type_;
 
   /// @brief 对应Tcp连接用户接收缓冲区
   Buffer input_;
@@ -20,7 +20,8 @@ TcpServer::TcpServer(
   wrt_cb_(),
   thread_init_cb_(),
   started_(0),
-  next_conn_id_(1) {
+  next_conn_id_(1),
+  output_budget_(std::make_shared<OutputBudget>()) {
   // 向acceptor_对象注册一个回调函数TcpServer::NewConnection
   acceptor_->setNewConnectionCallback(
     std::bind(&TcpServer::NewConnection, this, std::placeholders::_1, std::placeholders::_2)
@@ -81,6 +82,7 @@ void TcpServer::NewConnection(int sockfd, const InetAddress &peer_addr) {
   conn_ptr->setConnectionCallback(conn_cb_);
   conn_ptr->setMessageCallback(msg_cb_);
   conn_ptr->setWriteCompleteCallback(wrt_cb_);
+  conn_ptr->setOutputBudget(output_budget_);
   conn_ptr->setCloseCallback(
     std::bind(&TcpServer::RemoveConnection, this, std::placeholders::_1)
   );
@@ -53,6 +53,16 @@ public:
     wrt_cb_ = cb;
   }
 
+  /// @brief 设置所有连接发送缓冲区总字节数上限，超限后积压连接暂停读取，0表示不限制
+  void setMaxOutputBytes(size_t max_bytes) {
+    output_budget_->limit = max_bytes;
+  }
+
+  /// @brief 所有连接发送缓冲区当前总字节数
+  size_t outputBytes() const {
+    return output_budget_->used;
+  }
+
   void setThreadNum(int num_thread);
   void Start();
 
@@ -94,6 +104,9 @@ private:
 
   int next_conn_id_;
   ConnectionMap conns_;
+
+  /// @brief 所有连接共享的发送缓冲区总量统计
+  OutputBudgetPtr output_budget_;
 };
 
 NAMESPACE_END
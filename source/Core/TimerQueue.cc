@@ -0,0 +1,127 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-14 09:31:29
+ * @Contact: 2458006466@qq.com
+ * @Description: TimerQueue
+ */
+#include "Core/TimerQueue.h"
+#include "Core/Channel.h"
+#include "Core/EventLoop.h"
+#include "Base/Logger.h"
+#include <algorithm>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+NAMESPACE_BEGIN
+static int CreateTimerfd() {
+  int fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  CHECK(fd >= 0) << "timerfd_create failed.";
+  return fd;
+}
+
+TimerQueue::TimerQueue(EventLoop *loop) :
+  loop_(loop),
+  timer_fd_(CreateTimerfd()),
+  timer_channel_(new Channel(loop, timer_fd_)),
+  next_id_(1),
+  armed_us_(0) {
+  timer_channel_->setReadCallback(std::bind(&TimerQueue::HandleRead, this));
+  timer_channel_->EnableReading();
+}
+
+TimerQueue::~TimerQueue() {
+  timer_channel_->DisableAll();
+  timer_channel_->Remove();
+  ::close(timer_fd_);
+}
+
+TimerQueue::TimerId TimerQueue::AddTimer(TimerCallback cb, Timestamp when, double interval) {
+  std::shared_ptr<Timer> timer = std::make_shared<Timer>();
+  timer->cb = std::move(cb);
+  timer->expiration_us = when.microSecondsSinceEpoch();
+  timer->interval_us = static_cast<int64_t>(interval * Timestamp::kMicroSecondsPerSecond);
+  TimerId id = next_id_++;
+  loop_->RunInLoop(std::bind(&TimerQueue::AddTimerInLoop, this, id, timer));
+  return id;
+}
+
+void TimerQueue::Cancel(TimerId id) {
+  loop_->RunInLoop(std::bind(&TimerQueue::CancelInLoop, this, id));
+}
+
+void TimerQueue::AddTimerInLoop(TimerId id, const std::shared_ptr<Timer> &timer) {
+  timers_[id] = timer;
+  queue_.insert(std::make_pair(timer->expiration_us, id));
+  Reset();
+}
+
+void TimerQueue::CancelInLoop(TimerId id) {
+  auto it = timers_.find(id);
+  if (it == timers_.end()) {
+    return;
+  }
+  // 正在执行回调的定时器已不在queue_中，删除后不再重新加入
+  queue_.erase(std::make_pair(it->second->expiration_us, id));
+  timers_.erase(it);
+}
+
+void TimerQueue::HandleRead() {
+  uint64_t howmany = 0;
+  ssize_t n = ::read(timer_fd_, &howmany, sizeof(howmany));
+  if (n != sizeof(howmany)) {
+    LogError("TimerQueue::HandleRead() reads {} bytes instead of 8.", n);
+  }
+  armed_us_ = 0;
+
+  // 1.先取出全部到期的定时器，回调中增删定时器不影响本次遍历
+  int64_t now = Timestamp::Now().microSecondsSinceEpoch();
+  std::vector<TimerId> expired;
+  while (!queue_.empty() && queue_.begin()->first <= now) {
+    expired.push_back(queue_.begin()->second);
+    queue_.erase(queue_.begin());
+  }
+
+  // 2.执行回调，周期定时器在回调中未被取消时重新加入
+  for (TimerId id : expired) {
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+      continue;
+    }
+    std::shared_ptr<Timer> timer = it->second;
+    timer->cb();
+    it = timers_.find(id);
+    if (it == timers_.end()) {
+      continue;
+    }
+    if (timer->interval_us > 0) {
+      timer->expiration_us = now + timer->interval_us;
+      queue_.insert(std::make_pair(timer->expiration_us, id));
+    } else {
+      timers_.erase(it);
+    }
+  }
+  Reset();
+}
+
+void TimerQueue::Reset() {
+  if (queue_.empty()) {
+    return;
+  }
+  int64_t earliest = queue_.begin()->first;
+  if (armed_us_ != 0 && armed_us_ <= earliest) {
+    return;
+  }
+  // 绝对时间，已过期的时间使timerfd立即可读
+  struct itimerspec spec {};
+  int64_t when = std::max<int64_t>(earliest, 1);
+  spec.it_value.tv_sec = static_cast<time_t>(when / Timestamp::kMicroSecondsPerSecond);
+  spec.it_value.tv_nsec = static_cast<long>(when % Timestamp::kMicroSecondsPerSecond * 1000);
+  if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+    LogError("timerfd_settime failed.");
+    return;
+  }
+  armed_us_ = earliest;
+}
+
+NAMESPACE_END
@@ -0,0 +1,71 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-14 09:31:17
+ * @Contact: 2458006466@qq.com
+ * @Description: TimerQueue
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/Timestamp.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+NAMESPACE_BEGIN
+class Channel;
+class EventLoop;
+/**
+ * @brief 定时器队列，每个EventLoop一个。
+ * 所有定时器按到期时间排序，只用一个timerfd按最早的到期时间触发，
+ * 到期的回调在loop线程中执行；增删定时器的开销为O(log n)，
+ * 最早到期时间不变时不需要系统调用。
+ */
+class API TimerQueue {
+public:
+  using TimerId = uint64_t;
+  using TimerCallback = std::function<void()>;
+
+  explicit TimerQueue(EventLoop *loop);
+  ~TimerQueue();
+
+  /// @brief 添加定时器，可在任意线程调用
+  /// @param when 到期时间
+  /// @param interval 大于0时为周期定时器的间隔(秒)
+  TimerId AddTimer(TimerCallback cb, Timestamp when, double interval);
+
+  /// @brief 取消定时器，已到期或已取消时无操作，可在任意线程及定时器回调中调用
+  void Cancel(TimerId id);
+
+  NOT_ALLOWED_COPY(TimerQueue)
+
+private:
+  struct Timer {
+    TimerCallback cb;
+    int64_t expiration_us;
+    int64_t interval_us;
+  };
+
+  void AddTimerInLoop(TimerId id, const std::shared_ptr<Timer> &timer);
+  void CancelInLoop(TimerId id);
+  void HandleRead();
+  /// @brief 按最早的到期时间重新设置timerfd
+  void Reset();
+
+private:
+  EventLoop *loop_;
+  const int timer_fd_;
+  std::unique_ptr<Channel> timer_channel_;
+  std::atomic<TimerId> next_id_;
+  /// @brief (到期时间, 定时器ID)，按到期时间排序
+  std::set<std::pair<int64_t, TimerId>> queue_;
+  std::unordered_map<TimerId, std::shared_ptr<Timer>> timers_;
+  /// @brief timerfd当前设置的到期时间，0表示未设置
+  int64_t armed_us_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,431 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-04 10:02:55
+ * @Contact: 2458006466@qq.com
+ * @Description: AsyncMysqlClient
+ */
+#include "Database/AsyncMysqlClient.h"
+#include "Base/Logger.h"
+#include "Core/Channel.h"
+#include "Core/EventLoop.h"
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+NAMESPACE_BEGIN
+/// @brief 客户端错误码(CR_*)从2000开始，表示连接已不可用，与服务端错误区分
+static const unsigned int kClientErrorMin = 2000;
+/// @brief 队列已满或连接失败时回调的错误码，取值同CR_UNKNOWN_ERROR
+static const unsigned int kUnknownError = 2000;
+
+struct AsyncMysqlClient::Connection {
+  enum State {
+    kClosed,
+    kConnecting,
+    kIdle,
+    kQuerying,
+    kStoring,
+  };
+
+  State state {kClosed};
+  MYSQL *mysql {nullptr};
+  /// @brief 非阻塞接口返回的等待状态(MYSQL_WAIT_*)
+  int wait {0};
+  std::shared_ptr<Channel> channel;
+  int timer_fd {-1};
+  std::shared_ptr<Channel> timer;
+  Request request;
+  MYSQL *connect_ret {nullptr};
+  int query_ret {0};
+  MYSQL_RES *rows {nullptr};
+};
+
+AsyncMysqlClient::AsyncMysqlClient(EventLoop *loop, const Options &options) :
+  loop_(loop),
+  options_(options),
+  in_flight_(0),
+  busy_(0),
+  pool_("mysql-async") {
+  if (NonBlocking()) {
+    for (int i = 0; i < options_.max_connections; ++i) {
+      connections_.emplace_back(new Connection);
+    }
+  } else {
+    pool_.setMaxQueueSize(static_cast<size_t>(options_.max_connections));
+    pool_.Start(options_.max_connections);
+  }
+}
+
+AsyncMysqlClient::~AsyncMysqlClient() {
+  for (auto &conn : connections_) {
+    Close(conn.get());
+    if (conn->timer) {
+      conn->timer->DisableAll();
+      conn->timer->Remove();
+      ::close(conn->timer_fd);
+    }
+  }
+  pool_.Stop();
+  for (MYSQL *mysql : idle_) {
+    mysql_close(mysql);
+  }
+}
+
+void AsyncMysqlClient::Query(const std::string &sql, const Callback &cb) {
+  loop_->RunInLoop(std::bind(&AsyncMysqlClient::QueryInLoop, this, sql, cb));
+}
+
+void AsyncMysqlClient::QueryInLoop(const std::string &sql, const Callback &cb) {
+  if (pending_.size() >= options_.max_pending) {
+    Request request { sql, cb };
+    Result result;
+    result.error = kUnknownError;
+    result.message = "too many pending queries";
+    ++in_flight_;
+    Complete(request, result);
+    return;
+  }
+  ++in_flight_;
+  pending_.push_back(Request{ sql, cb });
+  Dispatch();
+}
+
+void AsyncMysqlClient::Complete(Request &request, Result &result) {
+  --in_flight_;
+  if (request.cb) {
+    request.cb(result);
+  }
+  if (result.rows) {
+    mysql_free_result(result.rows);
+    result.rows = nullptr;
+  }
+}
+
+void AsyncMysqlClient::FailAll(unsigned int error, const std::string &message) {
+  std::deque<Request> requests;
+  requests.swap(pending_);
+  for (Request &request : requests) {
+    Result result;
+    result.error = error;
+    result.message = message;
+    Complete(request, result);
+  }
+}
+
+#ifdef MYSQL_WAIT_READ
+bool AsyncMysqlClient::NonBlocking() {
+  return true;
+}
+
+void AsyncMysqlClient::Dispatch() {
+  // 1.空闲连接直接执行队首查询
+  size_t connecting = 0;
+  for (auto &conn : connections_) {
+    if (pending_.empty()) {
+      return;
+    }
+    if (conn->state == Connection::kIdle) {
+      StartQuery(conn.get());
+    } else if (conn->state == Connection::kConnecting) {
+      ++connecting;
+    }
+  }
+
+  // 2.仍有等待的查询则按需建立新连接，正在建立的连接计入
+  for (auto &conn : connections_) {
+    if (pending_.size() <= connecting) {
+      return;
+    }
+    if (conn->state == Connection::kClosed) {
+      ++connecting;
+      StartConnect(conn.get());
+    }
+  }
+}
+
+void AsyncMysqlClient::StartConnect(Connection *conn) {
+  conn->mysql = mysql_init(nullptr);
+  if (!conn->mysql) {
+    FailAll(kUnknownError, "mysql_init failed");
+    return;
+  }
+  mysql_options(conn->mysql, MYSQL_OPT_NONBLOCK, 0);
+  // 与ConnectionPool一致使用gbk字符集
+  mysql_options(conn->mysql, MYSQL_SET_CHARSET_NAME, "gbk");
+  conn->state = Connection::kConnecting;
+  int status = mysql_real_connect_start(&conn->connect_ret, conn->mysql, options_.host.c_str(),
+                                        options_.user.c_str(), options_.passwd.c_str(),
+                                        options_.dbname.c_str(), options_.port, nullptr, 0);
+  Handle(conn, status);
+}
+
+void AsyncMysqlClient::StartQuery(Connection *conn) {
+  conn->request = std::move(pending_.front());
+  pending_.pop_front();
+  conn->state = Connection::kQuerying;
+  const std::string &sql = conn->request.sql;
+  int status = mysql_real_query_start(&conn->query_ret, conn->mysql, sql.data(), sql.size());
+  Handle(conn, status);
+}
+
+void AsyncMysqlClient::Continue(Connection *conn, int ready) {
+  if (!(conn->wait & ready)) {
+    // 同一次epoll返回中前一个回调已推进了状态
+    return;
+  }
+  int status = 0;
+  switch (conn->state) {
+    case Connection::kConnecting:
+      status = mysql_real_connect_cont(&conn->connect_ret, conn->mysql, ready);
+      break;
+    case Connection::kQuerying:
+      status = mysql_real_query_cont(&conn->query_ret, conn->mysql, ready);
+      break;
+    case Connection::kStoring:
+      status = mysql_store_result_cont(&conn->rows, conn->mysql, ready);
+      break;
+    default:
+      return;
+  }
+  Handle(conn, status);
+}
+
+void AsyncMysqlClient::Handle(Connection *conn, int status) {
+  for (;;) {
+    if (status != 0) {
+      Wait(conn, status);
+      return;
+    }
+    // 当前步骤完成，停止关注socket事件
+    conn->wait = 0;
+    if (conn->channel && !conn->channel->isNoneEvent()) {
+      conn->channel->DisableAll();
+    }
+    if (conn->timer_fd >= 0) {
+      struct itimerspec spec;
+      memset(&spec, 0, sizeof(spec));
+      timerfd_settime(conn->timer_fd, 0, &spec, nullptr);
+    }
+
+    switch (conn->state) {
+      case Connection::kConnecting: {
+        if (!conn->connect_ret) {
+          unsigned int error = mysql_errno(conn->mysql);
+          std::string message = mysql_error(conn->mysql);
+          LogError("connect mysql failed: {}.", message);
+          Close(conn);
+          // 没有其他可用或正在建立的连接时，等待中的查询全部失败
+          for (auto &other : connections_) {
+            if (other->state != Connection::kClosed) {
+              return;
+            }
+          }
+          FailAll(error ? error : kUnknownError, message);
+          return;
+        }
+        conn->state = Connection::kIdle;
+        Dispatch();
+        return;
+      }
+      case Connection::kQuerying:
+        if (conn->query_ret != 0) {
+          Finish(conn);
+          return;
+        }
+        conn->state = Connection::kStoring;
+        status = mysql_store_result_start(&conn->rows, conn->mysql);
+        break;
+      case Connection::kStoring:
+        Finish(conn);
+        return;
+      default:
+        return;
+    }
+  }
+}
+
+void AsyncMysqlClient::Finish(Connection *conn) {
+  // 1.收集结果，连接先回到空闲状态，回调中可以提交新的查询
+  Result result;
+  result.error = mysql_errno(conn->mysql);
+  if (result.error != 0) {
+    result.message = mysql_error(conn->mysql);
+  } else {
+    result.rows = conn->rows;
+    result.affected_rows = mysql_affected_rows(conn->mysql);
+    result.insert_id = mysql_insert_id(conn->mysql);
+  }
+  conn->rows = nullptr;
+  Request request = std::move(conn->request);
+  if (result.error >= kClientErrorMin) {
+    LogError("mysql connection lost: {}.", result.message);
+    Close(conn);
+  } else {
+    conn->state = Connection::kIdle;
+  }
+
+  // 2.回调并继续执行等待中的查询
+  Complete(request, result);
+  Dispatch();
+}
+
+void AsyncMysqlClient::Wait(Connection *conn, int status) {
+  conn->wait = status;
+  int fd = mysql_get_socket(conn->mysql);
+  if (!conn->channel || conn->channel->sockfd() != fd) {
+    // 1.连接建立后socket才确定，为其创建Channel
+    Channel *channel = new Channel(loop_, fd);
+    conn->channel.reset(channel);
+    auto ready = [this, conn, channel](int events) {
+      if (conn->channel.get() == channel) {
+        Continue(conn, conn->wait & events);
+      }
+    };
+    channel->setReadCallback(std::bind(ready, MYSQL_WAIT_READ | MYSQL_WAIT_EXCEPT));
+    channel->setWriteCallback(std::bind(ready, MYSQL_WAIT_WRITE));
+    // 对端关闭或出错时继续推进，由客户端库报告错误
+    channel->setCloseCallback(std::bind(ready, MYSQL_WAIT_READ | MYSQL_WAIT_WRITE));
+    channel->setErrorCallback(std::bind(ready, MYSQL_WAIT_READ | MYSQL_WAIT_WRITE));
+  }
+
+  // 2.按等待状态更新关注的事件
+  Channel *channel = conn->channel.get();
+  bool reading = (status & (MYSQL_WAIT_READ | MYSQL_WAIT_EXCEPT)) != 0;
+  bool writing = (status & MYSQL_WAIT_WRITE) != 0;
+  if (reading != channel->isReading()) {
+    reading ? channel->EnableReading() : channel->DisableReading();
+  }
+  if (writing != channel->isWriting()) {
+    writing ? channel->EnableWriting() : channel->DisableWriting();
+  }
+
+  // 3.超时由每条连接的timerfd驱动
+  if (status & MYSQL_WAIT_TIMEOUT) {
+    if (conn->timer_fd < 0) {
+      conn->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      CHECK(conn->timer_fd >= 0) << "timerfd_create failed.";
+      conn->timer.reset(new Channel(loop_, conn->timer_fd));
+      conn->timer->setReadCallback(std::bind(&AsyncMysqlClient::OnTimeout, this, conn));
+      conn->timer->EnableReading();
+    }
+    unsigned int timeout_ms = mysql_get_timeout_value_ms(conn->mysql);
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = timeout_ms / 1000;
+    spec.it_value.tv_nsec = (timeout_ms % 1000) * 1000000L + (timeout_ms == 0 ? 1 : 0);
+    timerfd_settime(conn->timer_fd, 0, &spec, nullptr);
+  }
+}
+
+void AsyncMysqlClient::OnTimeout(Connection *conn) {
+  uint64_t expirations = 0;
+  ssize_t n = ::read(conn->timer_fd, &expirations, sizeof(expirations));
+  (void)n;
+  Continue(conn, conn->wait & MYSQL_WAIT_TIMEOUT);
+}
+
+void AsyncMysqlClient::Close(Connection *conn) {
+  if (conn->channel) {
+    // 可能正处于该Channel的事件回调中，延迟到本轮事件处理之后析构
+    conn->channel->DisableAll();
+    conn->channel->Remove();
+    std::shared_ptr<Channel> channel = conn->channel;
+    loop_->QueueInLoop([channel]() {});
+    conn->channel.reset();
+  }
+  if (conn->rows) {
+    mysql_free_result(conn->rows);
+    conn->rows = nullptr;
+  }
+  if (conn->mysql) {
+    mysql_close(conn->mysql);
+    conn->mysql = nullptr;
+  }
+  conn->wait = 0;
+  conn->state = Connection::kClosed;
+}
+#else
+bool AsyncMysqlClient::NonBlocking() {
+  return false;
+}
+
+void AsyncMysqlClient::Close(Connection *conn) {
+
+}
+
+void AsyncMysqlClient::Dispatch() {
+  // 每个工作线程同时只执行一个查询，其余查询留在队列中
+  while (!pending_.empty() && busy_ < options_.max_connections) {
+    std::shared_ptr<Request> request = std::make_shared<Request>(std::move(pending_.front()));
+    pending_.pop_front();
+    ++busy_;
+    bool queued = pool_.Run(std::bind(&AsyncMysqlClient::RunBlocking, this, request));
+    CHECK(queued);
+  }
+}
+
+MYSQL *AsyncMysqlClient::TakeConnection(Result *result) {
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!idle_.empty()) {
+      MYSQL *mysql = idle_.back();
+      idle_.pop_back();
+      return mysql;
+    }
+  }
+  MYSQL *mysql = mysql_init(nullptr);
+  if (!mysql) {
+    result->error = kUnknownError;
+    result->message = "mysql_init failed";
+    return nullptr;
+  }
+  mysql_options(mysql, MYSQL_SET_CHARSET_NAME, "gbk");
+  if (!mysql_real_connect(mysql, options_.host.c_str(), options_.user.c_str(), options_.passwd.c_str(),
+                          options_.dbname.c_str(), options_.port, nullptr, 0)) {
+    result->error = mysql_errno(mysql) ? mysql_errno(mysql) : kUnknownError;
+    result->message = mysql_error(mysql);
+    LogError("connect mysql failed: {}.", result->message);
+    mysql_close(mysql);
+    return nullptr;
+  }
+  return mysql;
+}
+
+void AsyncMysqlClient::ReturnConnection(MYSQL *mysql, bool broken) {
+  if (broken) {
+    mysql_close(mysql);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mtx_);
+  idle_.push_back(mysql);
+}
+
+void AsyncMysqlClient::RunBlocking(const std::shared_ptr<Request> &request) {
+  std::shared_ptr<Result> result = std::make_shared<Result>();
+  MYSQL *mysql = TakeConnection(result.get());
+  if (mysql) {
+    const std::string &sql = request->sql;
+    if (mysql_real_query(mysql, sql.data(), sql.size()) == 0) {
+      result->rows = mysql_store_result(mysql);
+    }
+    result->error = mysql_errno(mysql);
+    if (result->error != 0) {
+      result->message = mysql_error(mysql);
+    } else {
+      result->affected_rows = mysql_affected_rows(mysql);
+      result->insert_id = mysql_insert_id(mysql);
+    }
+    ReturnConnection(mysql, result->error >= kClientErrorMin);
+  }
+  loop_->RunInLoop(std::bind(&AsyncMysqlClient::FinishBlocking, this, request, result));
+}
+
+void AsyncMysqlClient::FinishBlocking(const std::shared_ptr<Request> &request,
+                                      const std::shared_ptr<Result> &result) {
+  --busy_;
+  Complete(*request, *result);
+  Dispatch();
+}
+#endif
+
+NAMESPACE_END
@@ -0,0 +1,125 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-04 10:02:47
+ * @Contact: 2458006466@qq.com
+ * @Description: AsyncMysqlClient
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/ThreadPool.h"
+#include <mysql/mysql.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN
+class EventLoop;
+/**
+ * @brief 绑定在EventLoop上的异步MySQL客户端，查询完成回调总在该loop中执行。
+ * (1) 客户端库提供MariaDB非阻塞接口(mysql_real_query_start/_cont等)时，连接的socket
+ *     注册为loop上的Channel，由socket可读写事件驱动各连接的状态机，不占用任何线程；
+ * (2) 否则(如Oracle libmysqlclient)退化为在内部线程池中同步执行，完成后投递回loop，
+ *     接口与行为不变。
+ * 连接按需建立，最多max_connections条；超出的查询在队列中等待，
+ * 一个loop可同时持有数千个未完成的查询。客户端须在loop线程中、所有查询回调完成后析构。
+ */
+class API AsyncMysqlClient {
+public:
+  struct Options {
+    std::string host {"localhost"};
+    std::string user;
+    std::string passwd;
+    std::string dbname;
+    unsigned int port {3306};
+    /// @brief 同时打开的连接数上限
+    int max_connections {16};
+    /// @brief 等待连接的查询个数上限，超出时立即以错误回调
+    size_t max_pending {65536};
+  };
+
+  struct Result {
+    /// @brief mysql_errno，成功为0
+    unsigned int error {0};
+    std::string message;
+    /// @brief SELECT等语句的结果集(mysql_store_result)，只在回调期间有效
+    MYSQL_RES *rows {nullptr};
+    uint64_t affected_rows {0};
+    uint64_t insert_id {0};
+
+    bool ok() const {
+      return error == 0;
+    }
+  };
+
+  using Callback = std::function<void(const Result &)>;
+
+  AsyncMysqlClient(EventLoop *loop, const Options &options);
+  ~AsyncMysqlClient();
+
+  /// @brief 提交查询，可在任意线程调用，回调在loop线程中执行
+  void Query(const std::string &sql, const Callback &cb);
+
+  /// @brief 是否使用客户端库的非阻塞接口
+  static bool NonBlocking();
+
+  /// @brief 已提交但尚未回调的查询个数，只在loop线程中调用
+  size_t inFlight() const {
+    return in_flight_;
+  }
+
+  /// @brief 等待连接的查询个数，只在loop线程中调用
+  size_t pending() const {
+    return pending_.size();
+  }
+
+private:
+  struct Request {
+    std::string sql;
+    Callback cb;
+  };
+  struct Connection;
+
+  void QueryInLoop(const std::string &sql, const Callback &cb);
+  void Dispatch();
+  /// @brief 回调并释放结果集，result.rows的所有权转移到此处
+  void Complete(Request &request, Result &result);
+  void FailAll(unsigned int error, const std::string &message);
+
+  // 非阻塞接口：每条连接的状态机
+  void StartConnect(Connection *conn);
+  void StartQuery(Connection *conn);
+  void Continue(Connection *conn, int ready);
+  void Handle(Connection *conn, int status);
+  void Wait(Connection *conn, int status);
+  void Finish(Connection *conn);
+  void OnTimeout(Connection *conn);
+  void Close(Connection *conn);
+
+  // 线程池退化实现
+  void RunBlocking(const std::shared_ptr<Request> &request);
+  MYSQL *TakeConnection(Result *result);
+  void ReturnConnection(MYSQL *mysql, bool broken);
+  void FinishBlocking(const std::shared_ptr<Request> &request, const std::shared_ptr<Result> &result);
+
+  NOT_ALLOWED_COPY(AsyncMysqlClient)
+
+private:
+  EventLoop *loop_;
+  const Options options_;
+  std::deque<Request> pending_;
+  size_t in_flight_;
+  /// @brief 非阻塞实现的连接槽位，关闭的槽位在需要时重新连接
+  std::vector<std::unique_ptr<Connection>> connections_;
+  /// @brief 退化实现中执行查询的线程数及空闲连接
+  int busy_;
+  std::mutex mtx_;
+  std::vector<MYSQL *> idle_;
+  ThreadPool pool_;
+};
+
+NAMESPACE_END
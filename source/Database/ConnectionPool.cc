@@ -6,9 +6,31 @@
  */
 #include "Database/ConnectionPool.h"
 #include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
 
 NAMESPACE_BEGIN
-ConnectionPool::ConnectionPool() : curr_conn_(0), free_conn_(0) {
+/// @brief 客户端错误码(CR_*)从2000开始，表示连接已断开或状态异常
+static const unsigned int kClientErrorMin = 2000;
+
+static int64_t NowUs() {
+  return Timestamp::Now().microSecondsSinceEpoch();
+}
+
+ConnectionPool::ConnectionPool() :
+  waiting_(0),
+  closed_(false),
+  checkouts_(0),
+  affinity_hits_(0),
+  timeouts_(0),
+  connect_failures_(0),
+  last_connect_us_(0),
+  last_connect_failure_us_(0),
+  total_wait_us_(0),
+  max_wait_us_(0) {
 
 }
 
@@ -21,7 +43,42 @@ ConnectionPool *ConnectionPool::getInstance() {
   return &instance;
 }
 
-void ConnectionPool::Init(
+struct ConnectionPool::Registry {
+  std::mutex mtx;
+  std::map<std::string, ConnectionPool *> pools;
+
+  ~Registry() {
+    for (auto &item : pools) {
+      delete item.second;
+    }
+  }
+};
+
+ConnectionPool *ConnectionPool::getInstance(const std::string &name) {
+  if (name.empty()) {
+    return getInstance();
+  }
+  static Registry registry;
+  std::lock_guard<std::mutex> lock(registry.mtx);
+  ConnectionPool *&pool = registry.pools[name];
+  if (!pool) {
+    pool = new ConnectionPool();
+  }
+  return pool;
+}
+
+int &ConnectionPool::Preferred(const ConnectionPool *pool) {
+  static thread_local std::vector<std::pair<const ConnectionPool *, int>> t_preferred;
+  for (auto &item : t_preferred) {
+    if (item.first == pool) {
+      return item.second;
+    }
+  }
+  t_preferred.emplace_back(pool, -1);
+  return t_preferred.back().second;
+}
+
+bool ConnectionPool::Init(
   const std::string &url,
   const std::string &user,
   const std::string &passwd,
@@ -29,87 +86,370 @@ void ConnectionPool::Init(
   unsigned int port,
   int max_conn
 ) {
-  url_ = url;
-  port_ = port;
-  user_ = user;
-  passwd_ = passwd;
-  dbname_ = dbname;
-
-  for (int i = 0; i < max_conn; ++i) {
-    MYSQL *conn = NULL;
-    conn = mysql_init(conn);
-    if (conn == NULL) {
-      LogError("init mysql failed.");
-      exit(1);
-    }
-    conn = mysql_real_connect(
-      conn, url_.c_str(), user_.c_str(), passwd_.c_str(),
-      dbname_.c_str(), port_, NULL, 0
-    );
-    if (conn == NULL) {
-      LogError("connect mysql failed!");
-      exit(1);
+  Options options;
+  options.url = url;
+  options.user = user;
+  options.passwd = passwd;
+  options.dbname = dbname;
+  options.port = port;
+  options.max_conn = max_conn;
+  return Init(options);
+}
+
+bool ConnectionPool::Init(const Options &options) {
+  CHECK(slots_.empty()) << "ConnectionPool initialized twice.";
+  CHECK(options.max_conn > 0);
+  options_ = options;
+  options_.min_conn = std::min(std::max(options_.min_conn, 0), options_.max_conn);
+  for (int i = 0; i < options_.max_conn; ++i) {
+    slots_.emplace_back(new Slot);
+  }
+
+  // 1.并行建立常驻连接，启动耗时为单条连接的耗时
+  std::atomic<int> connected(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options_.min_conn; ++i) {
+    threads.emplace_back([this, i, &connected]() {
+      Slot *slot = slots_[i].get();
+      slot->state = kConnecting;
+      if (Connect(slot)) {
+        slot->last_used_us = NowUs();
+        slot->state = kIdle;
+        ++connected;
+      } else {
+        slot->state = kEmpty;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  LogInfo("connection pool to {}:{} ready, {}/{} connections, max {}.",
+          options_.url, options_.port, connected.load(), options_.min_conn, options_.max_conn);
+
+  // 2.后台维护线程
+  if (options_.idle_timeout_ms > 0 || options_.health_check_ms > 0) {
+    maintainer_.reset(new Thread(std::bind(&ConnectionPool::Maintain, this), "ConnectionPool"));
+    maintainer_->Start();
+  }
+  return connected == options_.min_conn;
+}
+
+bool ConnectionPool::Connect(Slot *slot) {
+  MYSQL *conn = mysql_init(nullptr);
+  if (conn == nullptr) {
+    LogError("init mysql failed.");
+    ++connect_failures_;
+    last_connect_failure_us_ = NowUs();
+    return false;
+  }
+  if (mysql_real_connect(conn, options_.url.c_str(), options_.user.c_str(), options_.passwd.c_str(),
+                         options_.dbname.c_str(), options_.port, NULL, 0) == NULL) {
+    LogError("connect mysql failed: {}.", mysql_error(conn));
+    mysql_close(conn);
+    ++connect_failures_;
+    last_connect_failure_us_ = NowUs();
+    return false;
+  }
+  // 设置中文数据集，C和C++代码默认的编码字符是ASCII，若不设置，中文都会乱码
+  mysql_query(conn, "set names gbk");
+  slot->statements.reset(new StatementCache(conn));
+  slot->last_check_us = NowUs();
+  last_connect_us_ = slot->last_check_us;
+  slot->conn = conn;
+  return true;
+}
+
+void ConnectionPool::Close(Slot *slot) {
+  // 预处理语句须在连接关闭前释放
+  slot->statements.reset();
+  MYSQL *conn = slot->conn.exchange(nullptr);
+  if (conn) {
+    mysql_close(conn);
+  }
+  slot->state = kEmpty;
+}
+
+MYSQL *ConnectionPool::getConnection() {
+  return getConnection(options_.checkout_timeout_ms);
+}
+
+MYSQL *ConnectionPool::getConnection(int timeout_ms) {
+  if (slots_.empty() || closed_) {
+    return nullptr;
+  }
+  // 1.线程亲和：上次使用的连接空闲时直接取得
+  int &preferred = Preferred(this);
+  if (preferred >= 0 && preferred < static_cast<int>(slots_.size())) {
+    Slot *slot = slots_[preferred].get();
+    int expected = kIdle;
+    if (slot->state.compare_exchange_strong(expected, kBusy)) {
+      ++checkouts_;
+      ++affinity_hits_;
+      return slot->conn;
+    }
+  }
+
+  // 2.挑选空闲连接或空槽位，都没有时排队，归还方按FIFO直接交付
+  int64_t start = NowUs();
+  std::unique_lock<std::mutex> lock(mtx_);
+  Slot *slot = waiters_.empty() ? Claim() : nullptr;
+  if (!slot) {
+    Waiter waiter;
+    waiters_.push_back(&waiter);
+    ++waiting_;
+    // 入队后再检查一次，与无锁归还(先置空闲再检查waiting_)配合，不会漏掉唤醒
+    Dispatch();
+    auto ready = [&waiter]() { return waiter.slot != nullptr; };
+    if (timeout_ms < 0) {
+      waiter.cond.wait(lock, ready);
     } else {
-      // 设置中文数据集，C和C++代码默认的编码字符是ASCII，若不设置，中文都会乱码
-      mysql_query(conn, "set names gbk");
-      LogInfo("connect mysql succeed!");
+      waiter.cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    --waiting_;
+    if (!waiter.slot) {
+      waiters_.erase(std::find(waiters_.begin(), waiters_.end(), &waiter));
+      ++timeouts_;
+      LogError("get mysql connection timeout after {}ms.", timeout_ms);
+      return nullptr;
     }
-    conn_list_.push_back(conn);
-    ++free_conn_;
+    slot = waiter.slot;
   }
+  lock.unlock();
 
-  reserve_ = Sem(free_conn_);
-  max_conn_ = free_conn_;
+  // 3.占用的是空槽位时在锁外建立连接
+  if (slot->state == kConnecting) {
+    if (!Connect(slot)) {
+      slot->state = kEmpty;
+      lock.lock();
+      Dispatch();
+      return nullptr;
+    }
+    slot->state = kBusy;
+  }
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].get() == slot) {
+      preferred = static_cast<int>(i);
+      break;
+    }
+  }
+  ++checkouts_;
+  RecordWait(NowUs() - start);
+  return slot->conn;
 }
 
-MYSQL *ConnectionPool::getConnection() {
-  MYSQL *conn = NULL;
-  if (0 == conn_list_.size()) {
-    return NULL;
+ConnectionPool::Slot *ConnectionPool::Claim() {
+  if (closed_) {
+    return nullptr;
+  }
+  for (auto &slot : slots_) {
+    int expected = kIdle;
+    if (slot->state.compare_exchange_strong(expected, kBusy)) {
+      return slot.get();
+    }
+  }
+  for (auto &slot : slots_) {
+    int expected = kEmpty;
+    if (slot->state.compare_exchange_strong(expected, kConnecting)) {
+      return slot.get();
+    }
   }
-  reserve_.Wait();
+  return nullptr;
+}
 
-  locker_.Lock();
-  conn = conn_list_.front();
-  conn_list_.pop_front();
+void ConnectionPool::Dispatch() {
+  while (!waiters_.empty()) {
+    Slot *slot = Claim();
+    if (!slot) {
+      break;
+    }
+    Waiter *waiter = waiters_.front();
+    waiters_.pop_front();
+    waiter->slot = slot;
+    waiter->cond.notify_one();
+  }
+}
 
-  --free_conn_;
-  ++curr_conn_;
-  locker_.Unlock();
-  return conn;
+ConnectionPool::Slot *ConnectionPool::Find(MYSQL *conn) {
+  int preferred = Preferred(this);
+  if (preferred >= 0 && preferred < static_cast<int>(slots_.size()) && slots_[preferred]->conn == conn) {
+    return slots_[preferred].get();
+  }
+  for (auto &slot : slots_) {
+    if (slot->conn == conn) {
+      return slot.get();
+    }
+  }
+  return nullptr;
 }
 
 bool ConnectionPool::ReleaseConnection(MYSQL *conn) {
   if (NULL == conn) {
     return false;
   }
+  Slot *slot = Find(conn);
+  if (!slot) {
+    return false;
+  }
+  slot->last_used_us = NowUs();
+  // 不使用MYSQL_OPT_RECONNECT(已废弃，且重连后会话状态及预处理语句丢失)，
+  // 出现客户端错误的连接直接关闭，槽位由之后的获取按需重建
+  if (mysql_errno(conn) >= kClientErrorMin) {
+    LogError("mysql connection broken: {}, close it.", mysql_error(conn));
+    Close(slot);
+  } else {
+    slot->state = kIdle;
+  }
+  if (waiting_ > 0) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Dispatch();
+  }
+  return true;
+}
 
-  locker_.Lock();
-  conn_list_.push_back(conn);
-  ++free_conn_;
-  --curr_conn_;
-  locker_.Unlock();
+StatementCache *ConnectionPool::statements(MYSQL *conn) {
+  Slot *slot = Find(conn);
+  return slot ? slot->statements.get() : nullptr;
+}
 
-  reserve_.Post();
+void ConnectionPool::RecordWait(int64_t wait_us) {
+  uint64_t wait = static_cast<uint64_t>(std::max<int64_t>(wait_us, 0));
+  total_wait_us_ += wait;
+  uint64_t max_wait = max_wait_us_;
+  while (wait > max_wait && !max_wait_us_.compare_exchange_weak(max_wait, wait)) {
+  }
+}
 
-  return true;
+int ConnectionPool::freeConn() const {
+  int idle = 0;
+  for (auto &slot : slots_) {
+    idle += slot->state == kIdle ? 1 : 0;
+  }
+  return idle;
 }
 
-void ConnectionPool::DestroyPool() {
-  locker_.Lock();
-  if (conn_list_.size() > 0) {
-    for (auto &item : conn_list_) {
-      mysql_close(item);
+ConnectionPool::Stats ConnectionPool::stats() const {
+  Stats stats {};
+  for (auto &slot : slots_) {
+    int state = slot->state;
+    if (state == kIdle) {
+      ++stats.idle;
+    } else if (state == kBusy) {
+      ++stats.busy;
     }
   }
-  curr_conn_ = 0;
-  free_conn_ = 0;
-  locker_.Unlock();
+  stats.total = stats.idle + stats.busy;
+  stats.waiting = waiting_;
+  stats.checkouts = checkouts_;
+  stats.affinity_hits = affinity_hits_;
+  stats.timeouts = timeouts_;
+  stats.connect_failures = connect_failures_;
+  stats.last_connect_us = last_connect_us_;
+  stats.last_connect_failure_us = last_connect_failure_us_;
+  stats.total_wait_us = total_wait_us_;
+  stats.max_wait_us = max_wait_us_;
+  return stats;
+}
+
+void ConnectionPool::Maintain() {
+  int interval = std::max(options_.idle_timeout_ms, options_.health_check_ms);
+  if (options_.idle_timeout_ms > 0) {
+    interval = std::min(interval, options_.idle_timeout_ms);
+  }
+  if (options_.health_check_ms > 0) {
+    interval = std::min(interval, options_.health_check_ms);
+  }
+  interval = std::max(interval / 2, 10);
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!closed_) {
+    maintain_cond_.wait_for(lock, std::chrono::milliseconds(interval));
+    if (closed_) {
+      break;
+    }
+    lock.unlock();
+    MaintainOnce();
+    lock.lock();
+  }
+}
+
+void ConnectionPool::MaintainOnce() {
+  int open = 0;
+  for (auto &slot : slots_) {
+    open += slot->state != kEmpty ? 1 : 0;
+  }
+
+  int64_t now = NowUs();
+  for (auto &item : slots_) {
+    Slot *slot = item.get();
+    int expected = kIdle;
+    if (!slot->state.compare_exchange_strong(expected, kBusy)) {
+      continue;
+    }
+    // 1.关闭多余的空闲连接
+    if (options_.idle_timeout_ms > 0 && open > options_.min_conn &&
+        now - slot->last_used_us >= options_.idle_timeout_ms * 1000LL) {
+      Close(slot);
+      --open;
+      continue;
+    }
+    // 2.健康检查，失败的连接关闭后按需重建
+    if (options_.health_check_ms > 0 && now - slot->last_check_us >= options_.health_check_ms * 1000LL) {
+      slot->last_check_us = now;
+      if (mysql_ping(slot->conn) != 0) {
+        LogError("mysql connection health check failed: {}.", mysql_error(slot->conn));
+        Close(slot);
+        --open;
+        continue;
+      }
+    }
+    slot->state = kIdle;
+  }
+
+  // 3.补足常驻连接
+  for (auto &item : slots_) {
+    if (open >= options_.min_conn) {
+      break;
+    }
+    Slot *slot = item.get();
+    int expected = kEmpty;
+    if (!slot->state.compare_exchange_strong(expected, kConnecting)) {
+      continue;
+    }
+    if (Connect(slot)) {
+      slot->last_used_us = NowUs();
+      slot->state = kIdle;
+      ++open;
+    } else {
+      slot->state = kEmpty;
+      break;
+    }
+  }
+
+  if (waiting_ > 0) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Dispatch();
+  }
+}
+
+void ConnectionPool::DestroyPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    closed_ = true;
+    maintain_cond_.notify_all();
+  }
+  if (maintainer_) {
+    maintainer_->Join();
+    maintainer_.reset();
+  }
+  for (auto &slot : slots_) {
+    Close(slot.get());
+  }
 }
 
 ConnectionPoolRAII::ConnectionPoolRAII(ConnectionPool *pool) {
   conn_raii = pool->getConnection();
   poll_raii = pool;
+  stmt_raii = conn_raii ? pool->statements(conn_raii) : nullptr;
 }
 
 ConnectionPoolRAII::~ConnectionPoolRAII() {
@@ -117,6 +457,10 @@ ConnectionPoolRAII::~ConnectionPoolRAII() {
 }
 
 bool ConnectionPoolRAII::Execute(const std::string &sql) {
+  if (!conn_raii) {
+    LogError("Failed Execute {}, no available connection.", sql);
+    return false;
+  }
   if (mysql_query(conn_raii, sql.c_str()) != 0) {
     LogError("Failed Execute {}, Error is: {}.", sql, mysql_error(conn_raii));
     return false;
@@ -124,12 +468,19 @@ bool ConnectionPoolRAII::Execute(const std::string &sql) {
   return true;
 }
 
-MYSQL_RES *ConnectionPoolRAII::Query(const std::string &sql) {
+ResultSet ConnectionPoolRAII::Query(const std::string &sql) {
   if (!Execute(sql)) {
-    LogError("Failed Query {}, Error is: {}.", sql, mysql_error(conn_raii));
+    return ResultSet();
+  }
+  return ResultSet(conn_raii, mysql_use_result(conn_raii));
+}
+
+PreparedStatement *ConnectionPoolRAII::Prepare(const std::string &sql) {
+  if (!stmt_raii) {
+    LogError("Failed Prepare {}, no available connection.", sql);
     return nullptr;
   }
-  return mysql_use_result(conn_raii);
+  return stmt_raii->Get(sql);
 }
 
 NAMESPACE_END
@@ -7,37 +7,111 @@
 #pragma once
 
 #include "Api.h"
+#include "Base/Thread.h"
+#include "Database/PreparedStatement.h"
+#include "Database/ResultSet.h"
 #include <mysql/mysql.h>
-#include <list>
-
-#include "Base/Locker.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 NAMESPACE_BEGIN
-/// @brief SQL数据库连接池
+/**
+ * @brief SQL数据库连接池
+ * (1) 每个线程记住上次使用的连接，该连接空闲时以一次CAS取得，不加锁；
+ * (2) 否则在锁内挑选空闲连接，没有空闲连接时按FIFO排队等待，超过期限返回nullptr；
+ * (3) 启动时并行建立min_conn条连接，其余在需要时建立，最多max_conn条；
+ * (4) 后台线程关闭空闲过久的多余连接，并对长时间未使用的连接执行mysql_ping，失败的连接被关闭后按需重建；
+ *     不启用自动重连，使用中断开(出现客户端错误)的连接在归还时关闭，同样按需重建；
+ * (5) getInstance()为主库的连接池，getInstance(name)为按名称区分的其他端点(如只读副本)，由DatabaseRouter分配读写。
+ */
 class API ConnectionPool {
 public:
+  struct Options {
+    /// @brief 主机地址
+    std::string url {"localhost"};
+    std::string user;
+    std::string passwd;
+    std::string dbname;
+    unsigned int port {3306};
+    /// @brief 常驻连接数，Init时并行建立
+    int min_conn {1};
+    /// @brief 最大连接数
+    int max_conn {8};
+    /// @brief 获取连接的等待期限，小于0时一直等待
+    int checkout_timeout_ms {3000};
+    /// @brief 超过min_conn的连接空闲该时间后关闭，为0时不回收
+    int idle_timeout_ms {60000};
+    /// @brief 空闲连接每隔该时间检查一次可用性，为0时不检查
+    int health_check_ms {30000};
+  };
+
+  /// @brief 运行统计，等待时间为未命中线程亲和连接时获取连接的耗时
+  struct Stats {
+    int total;
+    int busy;
+    int idle;
+    size_t waiting;
+    uint64_t checkouts;
+    uint64_t affinity_hits;
+    uint64_t timeouts;
+    uint64_t connect_failures;
+    /// @brief 最近一次建立连接成功及失败的时间(微秒)，0表示没有
+    int64_t last_connect_us;
+    int64_t last_connect_failure_us;
+    uint64_t total_wait_us;
+    uint64_t max_wait_us;
+  };
+
   /// @brief 单例模式，获取连接池单例
   /// @return 连接池单例
   static ConnectionPool *getInstance();
 
-  /// @brief 获取一条连接
-  /// @return 一条连接
+  /// @brief 获取名为name的连接池，第一次获取时创建，进程退出时销毁
+  /// @param name 端点名称，为空时返回主库的连接池
+  static ConnectionPool *getInstance(const std::string &name);
+
+  /// @brief 获取一条连接，最多等待checkout_timeout_ms
+  /// @return 一条连接，超时或连接失败时返回nullptr
   MYSQL *getConnection();
 
+  /// @brief 获取一条连接
+  /// @param timeout_ms 等待期限，小于0时一直等待
+  /// @return 一条连接，超时或连接失败时返回nullptr
+  MYSQL *getConnection(int timeout_ms);
+
   /// @brief 用完连接后，将连接存回连接池中
   /// @param conn 当前连接
-  /// @return 当前连接是否为nullptr
+  /// @return 当前连接是否属于连接池
   bool ReleaseConnection(MYSQL *conn);
 
+  /// @brief 获取连接上的预处理语句缓存
+  /// @param conn 由getConnection获取的连接
+  /// @return conn不属于连接池时返回nullptr
+  StatementCache *statements(MYSQL *conn);
+
   /// @brief 返回当前空闲连接数
   /// @return 当前空闲连接数
-  int freeConn() const {
-    return free_conn_;
+  int freeConn() const;
+
+  Stats stats() const;
+
+  const Options &options() const {
+    return options_;
   }
 
   /// @brief 销毁连接池
   void DestroyPool();
 
+  /// @brief 初始化连接池，并行建立min_conn条连接
+  /// @return 常驻连接是否全部建立成功，失败的连接在使用时重试
+  bool Init(const Options &options);
+
   /// @brief 初始化连接池
   /// @param url 主机地址 
   /// @param user 登录用户名
@@ -45,7 +119,7 @@ public:
   /// @param dbname 使用数据库名
   /// @param port 数据库端口
   /// @param max_conn 最大连接数
-  void Init(
+  bool Init(
     const std::string &url,
     const std::string &user,
     const std::string &passwd,
@@ -55,42 +129,82 @@ public:
   );
 
 private:
+  enum SlotState {
+    kEmpty,
+    kConnecting,
+    kIdle,
+    kBusy,
+  };
+
+  struct Slot {
+    std::atomic<int> state {kEmpty};
+    std::atomic<MYSQL *> conn {nullptr};
+    std::unique_ptr<StatementCache> statements;
+    /// @brief 最近一次归还及健康检查的时间
+    std::atomic<int64_t> last_used_us {0};
+    int64_t last_check_us {0};
+  };
+
+  /// @brief 排队等待连接的线程，连接由归还方直接交给队首
+  struct Waiter {
+    std::condition_variable cond;
+    Slot *slot {nullptr};
+  };
+
+  /// @brief 按名称保存的连接池
+  struct Registry;
+
   /// @brief 构造函数
   ConnectionPool();
   
   /// @brief 析构函数
   ~ConnectionPool();
 
-private:
-  /// @brief 池中最大连接数
-  int max_conn_;
+  /// @brief 当前线程在pool中优先使用的连接下标，-1表示没有
+  static int &Preferred(const ConnectionPool *pool);
 
-  /// @brief 当前已使用连接数
-  int curr_conn_;
+  /// @brief 在锁内取得一条空闲连接，或占用一个空槽位(状态为kConnecting，由调用方建立连接)
+  Slot *Claim();
 
-  /// @brief 当前空闲连接数
-  int free_conn_;
+  /// @brief 在锁内把可用连接交给队首的等待者
+  void Dispatch();
 
-  Locker locker_;
+  /// @brief 为状态为kConnecting的槽位建立连接，成功后状态由调用方设置
+  bool Connect(Slot *slot);
 
-  /// @brief 连接池中连接列表
-  std::list<MYSQL *> conn_list_;
-  Sem reserve_;
+  /// @brief 关闭已占用的槽位上的连接，槽位变为kEmpty
+  void Close(Slot *slot);
 
-  /// @brief 主机地址
-  std::string url_;
+  Slot *Find(MYSQL *conn);
 
-  /// @brief 数据库端口号
-  unsigned int port_;
-  
-  /// @brief 登录数据库用户名
-  std::string user_;
+  void RecordWait(int64_t wait_us);
 
-  /// @brief 登录数据库用户密码
-  std::string passwd_;
+  /// @brief 后台线程：回收空闲连接、健康检查、补足常驻连接
+  void Maintain();
 
-  /// @brief 使用数据库名
-  std::string dbname_;  
+  void MaintainOnce();
+
+private:
+  Options options_;
+
+  /// @brief 连接槽位，Init时创建max_conn个，之后不再变化
+  std::vector<std::unique_ptr<Slot>> slots_;
+
+  mutable std::mutex mtx_;
+  std::condition_variable maintain_cond_;
+  std::deque<Waiter *> waiters_;
+  std::atomic<size_t> waiting_;
+  std::atomic<bool> closed_;
+  std::unique_ptr<Thread> maintainer_;
+
+  std::atomic<uint64_t> checkouts_;
+  std::atomic<uint64_t> affinity_hits_;
+  std::atomic<uint64_t> timeouts_;
+  std::atomic<uint64_t> connect_failures_;
+  std::atomic<int64_t> last_connect_us_;
+  std::atomic<int64_t> last_connect_failure_us_;
+  std::atomic<uint64_t> total_wait_us_;
+  std::atomic<uint64_t> max_wait_us_;
 };
 
 /// @brief SQL连接池的RAII封装
@@ -108,15 +222,24 @@ public:
   /// @return 是否执行成功
   bool Execute(const std::string &sql);
 
-  /// @brief 查询
+  /// @brief 查询，结果逐行从连接读取(mysql_use_result)
   /// @param sql 查询语句
-  /// @return 查询结果
-  MYSQL_RES *Query(const std::string &sql);
+  /// @return 查询结果游标，执行失败时无效；须在当前RAII对象析构前销毁
+  ResultSet Query(const std::string &sql);
+
+  /// @brief 获取预处理语句，同一连接上相同文本的语句只预处理一次，
+  /// 返回的语句只在当前RAII对象的生命周期内有效
+  /// @param sql 以?作为参数占位符的语句
+  /// @return 没有可用连接或预处理失败时返回nullptr
+  PreparedStatement *Prepare(const std::string &sql);
 
 private:
   /// @brief 当前从连接池中获取到的连接
   MYSQL *conn_raii;
 
+  /// @brief 当前连接的预处理语句缓存
+  StatementCache *stmt_raii;
+
   /// @brief 当前传入的连接池
   ConnectionPool *poll_raii;
 };
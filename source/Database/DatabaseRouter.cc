@@ -0,0 +1,87 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-13 10:05:37
+ * @Contact: 2458006466@qq.com
+ * @Description: DatabaseRouter
+ */
+#include "Database/DatabaseRouter.h"
+#include "Database/ConnectionPool.h"
+#include "Base/Timestamp.h"
+#include <algorithm>
+
+NAMESPACE_BEGIN
+DatabaseRouter *DatabaseRouter::getInstance() {
+  static DatabaseRouter instance(ConnectionPool::getInstance());
+  return &instance;
+}
+
+DatabaseRouter::DatabaseRouter(ConnectionPool *primary) : DatabaseRouter(primary, Options()) {
+
+}
+
+DatabaseRouter::DatabaseRouter(ConnectionPool *primary, const Options &options) :
+  primary_(primary),
+  options_(options),
+  written_(options.sticky_capacity),
+  next_(0),
+  reads_(0),
+  replica_reads_(0),
+  sticky_reads_(0),
+  writes_(0) {
+
+}
+
+void DatabaseRouter::AddReplica(ConnectionPool *replica) {
+  replicas_.push_back(replica);
+}
+
+ConnectionPool *DatabaseRouter::Writer(const std::string &key) {
+  ++writes_;
+  MarkWrite(key);
+  return primary_;
+}
+
+void DatabaseRouter::MarkWrite(const std::string &key) {
+  if (!key.empty() && !replicas_.empty() && options_.sticky_ms > 0) {
+    written_.Put(key, true, options_.sticky_ms);
+  }
+}
+
+ConnectionPool *DatabaseRouter::Reader(const std::string &key) {
+  ++reads_;
+  if (replicas_.empty()) {
+    return primary_;
+  }
+  bool written = false;
+  if (!key.empty() && written_.Get(key, &written)) {
+    ++sticky_reads_;
+    return primary_;
+  }
+  // 从轮转位置开始比较，负载相同时依次分到各个副本
+  ConnectionPool *best = nullptr;
+  double best_load = 0.0;
+  size_t n = replicas_.size();
+  size_t start = next_++;
+  int64_t now = Timestamp::Now().microSecondsSinceEpoch();
+  for (size_t i = 0; i < n; ++i) {
+    ConnectionPool *replica = replicas_[(start + i) % n];
+    ConnectionPool::Stats stats = replica->stats();
+    // 只按最近的状态判断：其后连上过或失败已超过退避时长的副本重新参与选择
+    if (stats.total == 0 && stats.last_connect_failure_us > stats.last_connect_us &&
+        now - stats.last_connect_failure_us < options_.failure_backoff_ms * 1000) {
+      continue;
+    }
+    double load = static_cast<double>(stats.busy + stats.waiting) / std::max(replica->options().max_conn, 1);
+    if (!best || load < best_load) {
+      best = replica;
+      best_load = load;
+    }
+  }
+  if (!best) {
+    return primary_;
+  }
+  ++replica_reads_;
+  return best;
+}
+
+NAMESPACE_END
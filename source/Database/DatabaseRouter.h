@@ -0,0 +1,94 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-13 10:05:22
+ * @Contact: 2458006466@qq.com
+ * @Description: DatabaseRouter
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/LruCache.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN
+class ConnectionPool;
+/**
+ * @brief 读写分离：写操作使用主库的连接池，读操作使用负载最低的只读副本。
+ * (1) 副本的负载为(使用中的连接数+等待连接的线程数)/max_conn，负载相同时轮流选择；
+ * (2) 没有可用连接且最近一次建立连接失败的副本在failure_backoff_ms内被跳过，期满后由下一次读操作试探，
+ *     后台线程或试探重新连上后恢复使用，没有可用副本时读主库；
+ * (3) 读己之写：以键(如用户名)写入后sticky_ms内以同一键的读操作仍走主库，避免读到复制延迟前的旧数据。
+ *     键不限于会话，AccountHandler以用户名为键，注销后或换一个客户端登录刚注册的账号同样读主库。
+ */
+class API DatabaseRouter {
+public:
+  struct Options {
+    /// @brief 写入后读主库的时长，应大于副本的复制延迟
+    int64_t sticky_ms {3000};
+    /// @brief 最多记录的键数，超出时淘汰最久未写入的键
+    size_t sticky_capacity {65536};
+    /// @brief 副本建立连接失败后跳过的时长，期满后重新试探
+    int64_t failure_backoff_ms {5000};
+  };
+
+  struct Stats {
+    uint64_t reads;
+    /// @brief 由副本处理的读操作
+    uint64_t replica_reads;
+    /// @brief 因读己之写留在主库的读操作
+    uint64_t sticky_reads;
+    uint64_t writes;
+  };
+
+  /// @brief 以ConnectionPool::getInstance()为主库的路由
+  static DatabaseRouter *getInstance();
+
+  explicit DatabaseRouter(ConnectionPool *primary);
+
+  DatabaseRouter(ConnectionPool *primary, const Options &options);
+
+  /// @brief 添加只读副本，须在开始路由前调用
+  void AddReplica(ConnectionPool *replica);
+
+  /// @brief 写操作使用的连接池，并记录键的写入
+  /// @param key 读己之写的键(如用户名)，为空时不记录
+  ConnectionPool *Writer(const std::string &key = std::string());
+
+  /// @brief 读操作使用的连接池
+  /// @param key 读己之写的键，最近写入过的键返回主库
+  ConnectionPool *Reader(const std::string &key = std::string());
+
+  /// @brief 记录键的写入，写入不经过Writer(如批量写入)时在完成后调用
+  void MarkWrite(const std::string &key);
+
+  ConnectionPool *primary() const {
+    return primary_;
+  }
+
+  size_t replicas() const {
+    return replicas_.size();
+  }
+
+  Stats stats() const {
+    return Stats{ reads_, replica_reads_, sticky_reads_, writes_ };
+  }
+
+  NOT_ALLOWED_COPY(DatabaseRouter)
+
+private:
+  ConnectionPool *primary_;
+  std::vector<ConnectionPool *> replicas_;
+  const Options options_;
+  /// @brief 最近写入过的键，过期后恢复读副本
+  ShardedLruCache<bool> written_;
+  std::atomic<size_t> next_;
+  std::atomic<uint64_t> reads_;
+  std::atomic<uint64_t> replica_reads_;
+  std::atomic<uint64_t> sticky_reads_;
+  std::atomic<uint64_t> writes_;
+};
+
+NAMESPACE_END
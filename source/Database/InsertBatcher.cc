@@ -0,0 +1,197 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-07 10:32:06
+ * @Contact: 2458006466@qq.com
+ * @Description: InsertBatcher
+ */
+#include "Database/InsertBatcher.h"
+#include "Database/ConnectionPool.h"
+#include "Base/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+NAMESPACE_BEGIN
+InsertBatcher::InsertBatcher(ConnectionPool *pool, const Options &options) :
+  pool_(pool),
+  options_(options),
+  running_(true),
+  stats_() {
+  CHECK(!options_.table.empty() && !options_.columns.empty());
+  CHECK(options_.max_rows > 0);
+  for (size_t rows = options_.max_rows; ; rows = std::max<size_t>(rows / 4, 1)) {
+    chunk_rows_.push_back(rows);
+    if (rows == 1) {
+      break;
+    }
+  }
+  writer_.reset(new Thread(std::bind(&InsertBatcher::WriterLoop, this), "InsertBatcher"));
+  writer_->Start();
+}
+
+InsertBatcher::~InsertBatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    running_ = false;
+  }
+  cond_.notify_all();
+  writer_->Join();
+}
+
+void InsertBatcher::Insert(const std::vector<std::string> &values, const Callback &cb) {
+  CHECK_EQ(values.size(), options_.columns.size());
+  std::unique_lock<std::mutex> lock(mtx_);
+  if (!running_) {
+    lock.unlock();
+    if (cb) {
+      cb(false);
+    }
+    return;
+  }
+  queue_.push_back(Row{ values, cb });
+  // 新批次的第一行开始计时，攒满一批时立即写入
+  if (queue_.size() == 1 || queue_.size() >= options_.max_rows) {
+    lock.unlock();
+    cond_.notify_one();
+  }
+}
+
+bool InsertBatcher::Insert(const std::vector<std::string> &values) {
+  auto done = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = done->get_future();
+  Insert(values, [done](bool ok) { done->set_value(ok); });
+  return result.get();
+}
+
+InsertBatcher::Stats InsertBatcher::stats() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return stats_;
+}
+
+void InsertBatcher::WriterLoop() {
+  std::vector<Row> batch;
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (true) {
+    cond_.wait(lock, [this]() { return !queue_.empty() || !running_; });
+    if (queue_.empty()) {
+      break;
+    }
+    // 等待更多的行加入当前批次，退出时不再等待
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.max_delay_ms);
+    cond_.wait_until(lock, deadline, [this]() { return queue_.size() >= options_.max_rows || !running_; });
+
+    size_t n = std::min(queue_.size(), options_.max_rows);
+    for (size_t i = 0; i < n; ++i) {
+      batch.push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    lock.unlock();
+    Flush(batch);
+    batch.clear();
+    lock.lock();
+  }
+}
+
+void InsertBatcher::Flush(std::vector<Row> &batch) {
+  std::vector<bool> results(batch.size(), false);
+  bool fallback = false;
+  bool commit_failed = false;
+  {
+    ConnectionPoolRAII raii(pool_);
+    BatchResult result = InsertBatch(raii, batch);
+    if (result == kCommitted) {
+      results.assign(batch.size(), true);
+    } else if (result == kCommitUnknown) {
+      // 逐行重试可能重复插入已提交的行，整批报告失败
+      commit_failed = true;
+      LogError("InsertBatcher commit {} rows into {} failed, result unknown.", batch.size(), options_.table);
+    } else if (batch.size() > 1) {
+      fallback = true;
+      for (size_t i = 0; i < batch.size(); ++i) {
+        results[i] = InsertRow(raii, batch[i]);
+      }
+    }
+  }
+
+  size_t failed = 0;
+  for (bool ok : results) {
+    failed += ok ? 0 : 1;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ++stats_.batches;
+    stats_.rows += batch.size();
+    stats_.failed_rows += failed;
+    stats_.fallbacks += fallback ? 1 : 0;
+    stats_.commit_failures += commit_failed ? 1 : 0;
+  }
+  // 连接归还后再回调，回调中可以再次访问数据库
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (batch[i].cb) {
+      batch[i].cb(results[i]);
+    }
+  }
+}
+
+InsertBatcher::BatchResult InsertBatcher::InsertBatch(ConnectionPoolRAII &raii, const std::vector<Row> &batch) {
+  if (batch.size() == 1) {
+    return InsertRow(raii, batch[0]) ? kCommitted : kRolledBack;
+  }
+  if (!raii.Execute("START TRANSACTION")) {
+    return kRolledBack;
+  }
+  // 按固定行数从大到小拆分，各段共用同一事务
+  size_t begin = 0;
+  for (size_t rows : chunk_rows_) {
+    for (; batch.size() - begin >= rows; begin += rows) {
+      if (!InsertRows(raii, batch, begin, rows)) {
+        // 回滚失败时连接已断开，服务器同样丢弃未提交的事务
+        raii.Execute("ROLLBACK");
+        return kRolledBack;
+      }
+    }
+  }
+  return raii.Execute("COMMIT") ? kCommitted : kCommitUnknown;
+}
+
+bool InsertBatcher::InsertRows(ConnectionPoolRAII &raii, const std::vector<Row> &batch, size_t begin, size_t rows) {
+  PreparedStatement *stmt = raii.Prepare(Statement(rows));
+  if (!stmt) {
+    return false;
+  }
+  int index = 0;
+  for (size_t i = begin; i < begin + rows; ++i) {
+    for (const std::string &value : batch[i].values) {
+      stmt->Bind(index++, value);
+    }
+  }
+  return stmt->Execute();
+}
+
+bool InsertBatcher::InsertRow(ConnectionPoolRAII &raii, const Row &row) {
+  PreparedStatement *stmt = raii.Prepare(Statement(1));
+  if (!stmt) {
+    return false;
+  }
+  for (size_t i = 0; i < row.values.size(); ++i) {
+    stmt->Bind(static_cast<int>(i), row.values[i]);
+  }
+  return stmt->Execute();
+}
+
+std::string InsertBatcher::Statement(size_t rows) const {
+  std::string placeholders = "(";
+  std::string sql = "INSERT INTO " + options_.table + " (";
+  for (size_t i = 0; i < options_.columns.size(); ++i) {
+    sql += (i == 0 ? "" : ", ") + options_.columns[i];
+    placeholders += i == 0 ? "?" : ", ?";
+  }
+  placeholders += ")";
+  sql += ") VALUES ";
+  for (size_t i = 0; i < rows; ++i) {
+    sql += (i == 0 ? "" : ", ") + placeholders;
+  }
+  return sql;
+}
+
+NAMESPACE_END
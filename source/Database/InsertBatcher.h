@@ -0,0 +1,111 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-07 10:31:52
+ * @Contact: 2458006466@qq.com
+ * @Description: InsertBatcher
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/Thread.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN
+class ConnectionPool;
+class ConnectionPoolRAII;
+/**
+ * @brief 合并写入：收集max_delay_ms内或max_rows条待插入的行，在一个事务中以多行INSERT写入，
+ * 再逐一通知各自的调用方。多行INSERT失败(如其中一行违反唯一约束)时回滚，
+ * 改为逐行插入，每行得到各自的结果；COMMIT出错时服务器可能已经提交，整批以失败通知而不重试，
+ * 避免重复插入。
+ * 批次按固定的几种行数(max_rows、max_rows/4、...、1)拆分，每条连接上最多预处理这几条语句，
+ * 不会因批次大小各异而挤占预处理语句缓存。
+ */
+class API InsertBatcher {
+public:
+  struct Options {
+    std::string table;
+    std::vector<std::string> columns;
+    /// @brief 单个批次的最大行数
+    size_t max_rows {64};
+    /// @brief 第一行到达后最多等待的时间
+    int max_delay_ms {5};
+  };
+
+  struct Stats {
+    uint64_t batches;
+    uint64_t rows;
+    uint64_t failed_rows;
+    /// @brief 多行INSERT失败后逐行插入的批次数
+    uint64_t fallbacks;
+    /// @brief COMMIT出错、结果未知而整批失败的批次数
+    uint64_t commit_failures;
+  };
+
+  using Callback = std::function<void(bool)>;
+
+  InsertBatcher(ConnectionPool *pool, const Options &options);
+  /// @brief 写入已提交的行后退出
+  ~InsertBatcher();
+
+  /// @brief 提交一行，values与columns一一对应，cb在写入线程中执行
+  void Insert(const std::vector<std::string> &values, const Callback &cb);
+
+  /// @brief 提交一行并等待写入完成
+  /// @return 是否插入成功
+  bool Insert(const std::vector<std::string> &values);
+
+  Stats stats();
+
+  /// @brief 拆分批次使用的各语句行数，从大到小，最后一个为1
+  const std::vector<size_t> &chunkRows() const {
+    return chunk_rows_;
+  }
+
+private:
+  struct Row {
+    std::vector<std::string> values;
+    Callback cb;
+  };
+
+  enum BatchResult {
+    /// @brief 已提交
+    kCommitted,
+    /// @brief COMMIT之前失败，事务已回滚，可以逐行重试
+    kRolledBack,
+    /// @brief COMMIT出错，服务器可能已提交，结果未知
+    kCommitUnknown,
+  };
+
+  void WriterLoop();
+  void Flush(std::vector<Row> &batch);
+  /// @brief 在一个事务中写入全部行
+  BatchResult InsertBatch(ConnectionPoolRAII &raii, const std::vector<Row> &batch);
+  /// @brief 以一条rows行的语句写入batch[begin, begin + rows)
+  bool InsertRows(ConnectionPoolRAII &raii, const std::vector<Row> &batch, size_t begin, size_t rows);
+  bool InsertRow(ConnectionPoolRAII &raii, const Row &row);
+  /// @brief 插入rows行的语句，如"INSERT INTO t (a, b) VALUES (?, ?), (?, ?)"
+  std::string Statement(size_t rows) const;
+
+  NOT_ALLOWED_COPY(InsertBatcher)
+
+private:
+  ConnectionPool *pool_;
+  const Options options_;
+  std::vector<size_t> chunk_rows_;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::deque<Row> queue_;
+  bool running_;
+  Stats stats_;
+  std::unique_ptr<Thread> writer_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,339 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-12 10:27:06
+ * @Contact: 2458006466@qq.com
+ * @Description: MappedUserStore
+ */
+#include "Database/MappedUserStore.h"
+#include "Base/Hash.h"
+#include "Base/Logger.h"
+#include <fcntl.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NAMESPACE_BEGIN
+static const uint32_t kRecordMagic = 0x55535232; // "USR2"
+/// @brief 早期以FNV摘要保存的记录格式，不再兼容
+static const uint32_t kLegacyMagic = 0x55535231; // "USR1"
+static const size_t kSaltBytes = 16;
+static const size_t kDigestBytes = 32;
+/// @brief 记录中迭代次数的上限，防止损坏或伪造的记录使每次登录耗尽CPU
+static const uint32_t kMaxIterations = 10000000;
+static const size_t kMaxUsername = 255;
+static const size_t kMinMapped = 1 << 20;
+static const size_t kInitSlots = 1024;
+
+/// @brief 记录头，之后依次为用户名、盐及摘要；校验和覆盖user_len及其后的全部字节
+struct RecordHead {
+  uint32_t magic;
+  uint32_t checksum;
+  uint32_t user_len;
+  /// @brief 生成摘要时的PBKDF2迭代次数，调整Options::iterations不影响已有记录
+  uint32_t iterations;
+};
+
+static size_t RecordSize(size_t user_len) {
+  return sizeof(RecordHead) + user_len + kSaltBytes + kDigestBytes;
+}
+
+static uint32_t Checksum(const char *record, size_t size) {
+  size_t skip = offsetof(RecordHead, user_len);
+  return static_cast<uint32_t>(Hash::Fnv1a64(record + skip, size - skip));
+}
+
+static uint64_t UsernameHash(const StringPiece &username) {
+  return Hash::Fnv1a64(username.data(), username.size());
+}
+
+/// @brief PBKDF2-HMAC-SHA256派生256位摘要
+static bool Digest(const char *salt, uint32_t iterations, const std::string &password, char *digest) {
+  return PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()),
+                           reinterpret_cast<const unsigned char *>(salt), static_cast<int>(kSaltBytes),
+                           static_cast<int>(iterations), EVP_sha256(), static_cast<int>(kDigestBytes),
+                           reinterpret_cast<unsigned char *>(digest)) == 1;
+}
+
+static StringPiece RecordUsername(const char *record) {
+  RecordHead head;
+  memcpy(&head, record, sizeof(head));
+  return StringPiece(record + sizeof(head), head.user_len);
+}
+
+MappedUserStore::MappedUserStore(const Options &options) :
+  options_(options),
+  fd_(-1),
+  map_(nullptr),
+  mapped_(0),
+  size_(0),
+  slots_(kInitSlots, Slot{ 0, 0 }),
+  count_(0) {
+  if (!Open()) {
+    LogError("open user store {} failed: {}.", options_.path, strerror(errno));
+  }
+}
+
+MappedUserStore::~MappedUserStore() {
+  if (map_) {
+    ::munmap(map_, mapped_);
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool MappedUserStore::Open() {
+  int fd = ::open(options_.path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  fd_ = fd;
+  size_ = static_cast<size_t>(st.st_size);
+  if (!Remap(size_)) {
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  RecordHead first;
+  if (size_ >= sizeof(first)) {
+    memcpy(&first, map_, sizeof(first));
+    if (first.magic == kLegacyMagic) {
+      // 旧格式的摘要无法转换，拒绝打开而不是当作损坏的尾部截断
+      LogError("user store {} uses the legacy FNV record format, re-create it.", options_.path);
+      errno = EINVAL;
+      ::munmap(map_, mapped_);
+      map_ = nullptr;
+      mapped_ = 0;
+      ::close(fd_);
+      fd_ = -1;
+      return false;
+    }
+  }
+  size_t valid = Recover();
+  if (valid < size_) {
+    // 写入记录时崩溃留下的不完整尾部，截断后追加的记录才能被再次扫描到
+    LogError("user store {} truncated torn tail at {} ({} bytes).", options_.path, valid, size_ - valid);
+    if (::ftruncate(fd_, static_cast<off_t>(valid)) != 0) {
+      LogError("truncate user store {} failed: {}.", options_.path, strerror(errno));
+    }
+    size_ = valid;
+  }
+  LogInfo("user store {} opened, {} users, {} bytes.", options_.path, count_, size_);
+  return true;
+}
+
+size_t MappedUserStore::Recover() {
+  size_t offset = 0;
+  while (size_ - offset >= sizeof(RecordHead)) {
+    const char *record = map_ + offset;
+    RecordHead head;
+    memcpy(&head, record, sizeof(head));
+    if (head.magic != kRecordMagic || head.user_len > kMaxUsername ||
+        head.iterations == 0 || head.iterations > kMaxIterations) {
+      break;
+    }
+    size_t size = RecordSize(head.user_len);
+    if (size > size_ - offset || Checksum(record, size) != head.checksum) {
+      break;
+    }
+    StringPiece username = RecordUsername(record);
+    Index(username, UsernameHash(username), offset);
+    offset += size;
+  }
+  return offset;
+}
+
+bool MappedUserStore::Remap(size_t size) {
+  // 映射长度按2的幂预留，追加的记录通过页缓存直接可见，超出时才重新映射
+  if (map_ && size <= mapped_) {
+    return true;
+  }
+  size_t length = mapped_ == 0 ? kMinMapped : mapped_;
+  while (length < size) {
+    length <<= 1;
+  }
+  void *map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  if (map_) {
+    ::munmap(map_, mapped_);
+  }
+  map_ = static_cast<char *>(map);
+  mapped_ = length;
+  return true;
+}
+
+const char *MappedUserStore::Find(const StringPiece &username, uint64_t hash) const {
+  size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Slot &slot = slots_[i];
+    if (slot.offset == 0) {
+      return nullptr;
+    }
+    if (slot.hash == hash) {
+      const char *record = map_ + slot.offset - 1;
+      if (RecordUsername(record) == username) {
+        return record;
+      }
+    }
+  }
+}
+
+void MappedUserStore::Index(const StringPiece &username, uint64_t hash, uint64_t offset) {
+  if ((count_ + 1) * 10 > slots_.size() * 7) {
+    Grow();
+  }
+  size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    Slot &slot = slots_[i];
+    if (slot.offset == 0) {
+      slot = Slot{ hash, offset + 1 };
+      ++count_;
+      return;
+    }
+    if (slot.hash == hash && RecordUsername(map_ + slot.offset - 1) == username) {
+      slot.offset = offset + 1;
+      return;
+    }
+  }
+}
+
+void MappedUserStore::Grow() {
+  std::vector<Slot> slots(slots_.size() * 2, Slot{ 0, 0 });
+  size_t mask = slots.size() - 1;
+  for (const Slot &slot : slots_) {
+    if (slot.offset == 0) {
+      continue;
+    }
+    size_t i = slot.hash & mask;
+    while (slots[i].offset != 0) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+  slots_.swap(slots);
+}
+
+UserStore::Result MappedUserStore::Authenticate(const std::string &username, const std::string &password) {
+  if (!ok()) {
+    return kError;
+  }
+  RecordHead head;
+  char stored[kSaltBytes + kDigestBytes];
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const char *record = Find(username, UsernameHash(username));
+    if (!record) {
+      return kRejected;
+    }
+    memcpy(&head, record, sizeof(head));
+    memcpy(stored, record + sizeof(head) + username.size(), sizeof(stored));
+  }
+  // 锁外派生摘要，按记录中的迭代次数计算，常数时间比较
+  char digest[kDigestBytes];
+  if (!Digest(stored, head.iterations, password, digest)) {
+    return kError;
+  }
+  return CRYPTO_memcmp(digest, stored + kSaltBytes, kDigestBytes) == 0 ? kOk : kRejected;
+}
+
+UserStore::Result MappedUserStore::Exists(const std::string &username) {
+  if (!ok()) {
+    return kError;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  return Find(username, UsernameHash(username)) ? kOk : kRejected;
+}
+
+UserStore::Result MappedUserStore::Register(const std::string &username, const std::string &password) {
+  if (!ok()) {
+    return kError;
+  }
+  if (username.size() > kMaxUsername) {
+    return kRejected;
+  }
+  uint32_t iterations = options_.iterations;
+  if (iterations == 0 || iterations > kMaxIterations) {
+    LogError("user store {} invalid iterations {}.", options_.path, iterations);
+    return kError;
+  }
+  // 锁外生成记录，锁内只做查重及追加
+  size_t size = RecordSize(username.size());
+  std::string record(size, '\0');
+  char *p = &record[0];
+  RecordHead head{ kRecordMagic, 0, static_cast<uint32_t>(username.size()), iterations };
+  char *salt = p + sizeof(head) + username.size();
+  memcpy(p + sizeof(head), username.data(), username.size());
+  CHECK_EQ(getrandom(salt, kSaltBytes, 0), static_cast<ssize_t>(kSaltBytes));
+  if (!Digest(salt, iterations, password, salt + kSaltBytes)) {
+    return kError;
+  }
+  memcpy(p, &head, sizeof(head));
+  head.checksum = Checksum(p, size);
+  memcpy(p, &head, sizeof(head));
+
+  uint64_t hash = UsernameHash(username);
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (Find(username, hash)) {
+    return kRejected;
+  }
+  ssize_t n = ::write(fd_, p, size);
+  if (n != static_cast<ssize_t>(size)) {
+    LogError("append user store {} failed: {}.", options_.path, strerror(errno));
+    if (n > 0 && ::ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+      LogError("truncate user store {} failed: {}.", options_.path, strerror(errno));
+    }
+    return kError;
+  }
+  if (options_.sync && ::fdatasync(fd_) != 0) {
+    LogError("sync user store {} failed: {}.", options_.path, strerror(errno));
+  }
+  size_t offset = size_;
+  size_ += size;
+  if (!Remap(size_)) {
+    // 记录已写入，重新打开时可恢复；映射失败时暂不加入索引，size_仍与文件结尾一致
+    LogError("remap user store {} failed: {}.", options_.path, strerror(errno));
+    return kError;
+  }
+  Index(username, hash, offset);
+  return kOk;
+}
+
+int64_t MappedUserStore::Count() {
+  if (!ok()) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  return static_cast<int64_t>(count_);
+}
+
+bool MappedUserStore::ForEachUsername(const UsernameCallback &cb) {
+  if (!ok()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (const Slot &slot : slots_) {
+    if (slot.offset != 0) {
+      cb(RecordUsername(map_ + slot.offset - 1));
+    }
+  }
+  return true;
+}
+
+size_t MappedUserStore::fileSize() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return size_;
+}
+
+NAMESPACE_END
@@ -0,0 +1,80 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-12 10:26:51
+ * @Contact: 2458006466@qq.com
+ * @Description: MappedUserStore
+ */
+#pragma once
+
+#include "Database/UserStore.h"
+#include <mutex>
+#include <vector>
+
+NAMESPACE_BEGIN
+/**
+ * @brief 进程内的持久化用户表，不依赖数据库，也用作压测及测试中结果确定的后端。
+ * (1) 账号以只追加的日志文件保存，每条记录为：记录头(魔数、校验和、用户名长度、迭代次数)、
+ *     用户名、16字节随机盐、32字节PBKDF2-HMAC-SHA256摘要，文件中不保存明文密码；
+ * (2) 日志文件以mmap映射读取，映射长度按2的幂预留，文件超过映射长度时重新映射；
+ * (3) 内存中的开放寻址哈希索引保存用户名哈希到记录偏移的映射，线性探测，负载超过0.7时扩容；
+ * (4) 打开时顺序扫描日志重建索引，校验失败的尾部(写入时崩溃)被截断，同一用户名以后写入的记录为准。
+ * 每条记录保存自身的迭代次数，提高Options::iterations后旧记录仍可验证；早期FNV摘要格式的文件拒绝打开。
+ */
+class API MappedUserStore : public UserStore {
+public:
+  struct Options {
+    std::string path;
+    /// @brief 每次注册后fdatasync，关闭时依赖页缓存回写，崩溃时可能丢失最近的注册
+    bool sync {false};
+    /// @brief 新注册记录的PBKDF2迭代次数，登录及注册在阻塞线程池中执行
+    uint32_t iterations {100000};
+  };
+
+  explicit MappedUserStore(const Options &options);
+  ~MappedUserStore() override;
+
+  /// @brief 日志文件是否成功打开，失败时所有操作返回kError
+  bool ok() const {
+    return fd_ >= 0;
+  }
+
+  Result Authenticate(const std::string &username, const std::string &password) override;
+  Result Exists(const std::string &username) override;
+  Result Register(const std::string &username, const std::string &password) override;
+  int64_t Count() override;
+  bool ForEachUsername(const UsernameCallback &cb) override;
+
+  /// @brief 日志文件中有效记录的总长度
+  size_t fileSize();
+
+  NOT_ALLOWED_COPY(MappedUserStore)
+
+private:
+  struct Slot {
+    uint64_t hash;
+    /// @brief 记录偏移加一，0表示空位
+    uint64_t offset;
+  };
+
+  bool Open();
+  /// @brief 扫描日志并重建索引，返回最后一条有效记录的结尾
+  size_t Recover();
+  bool Remap(size_t size);
+  /// @brief 查找用户名对应的记录，不存在时返回nullptr，调用方持有锁
+  const char *Find(const StringPiece &username, uint64_t hash) const;
+  /// @brief 插入或替换索引项，调用方持有锁
+  void Index(const StringPiece &username, uint64_t hash, uint64_t offset);
+  void Grow();
+
+private:
+  const Options options_;
+  int fd_;
+  char *map_;
+  size_t mapped_;
+  size_t size_;
+  std::mutex mtx_;
+  std::vector<Slot> slots_;
+  size_t count_;
+};
+
+NAMESPACE_END
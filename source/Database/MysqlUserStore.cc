@@ -0,0 +1,88 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-12 09:40:13
+ * @Contact: 2458006466@qq.com
+ * @Description: MysqlUserStore
+ */
+#include "Database/MysqlUserStore.h"
+#include "Database/ConnectionPool.h"
+#include "Database/DatabaseRouter.h"
+#include "Base/Logger.h"
+
+NAMESPACE_BEGIN
+static const char *const kSelectLogin = "SELECT 1 FROM user WHERE username = ? AND passwd = ? LIMIT 1";
+static const char *const kSelectUser = "SELECT 1 FROM user WHERE username = ? LIMIT 1";
+
+static InsertBatcher::Options UserBatchOptions() {
+  InsertBatcher::Options options;
+  options.table = "user";
+  options.columns = { "username", "passwd" };
+  return options;
+}
+
+MysqlUserStore::MysqlUserStore(DatabaseRouter *router) :
+  router_(router),
+  batcher_(router->primary(), UserBatchOptions()) {
+
+}
+
+MysqlUserStore::~MysqlUserStore() = default;
+
+UserStore::Result MysqlUserStore::Select(ConnectionPool *pool, const char *sql, const std::string &first,
+                                         const std::string *second) {
+  // 预处理语句按连接缓存，参数以二进制绑定，无需拼接及转义
+  ConnectionPoolRAII raii(pool);
+  PreparedStatement *stmt = raii.Prepare(sql);
+  if (!stmt) {
+    return kError;
+  }
+  stmt->Bind(0, first);
+  if (second) {
+    stmt->Bind(1, *second);
+  }
+  if (!stmt->Execute()) {
+    return kError;
+  }
+  return stmt->Fetch() ? kOk : kRejected;
+}
+
+UserStore::Result MysqlUserStore::Authenticate(const std::string &username, const std::string &password) {
+  return Select(router_->Reader(username), kSelectLogin, username, &password);
+}
+
+UserStore::Result MysqlUserStore::Exists(const std::string &username) {
+  return Select(router_->Reader(username), kSelectUser, username, nullptr);
+}
+
+UserStore::Result MysqlUserStore::ExistsLatest(const std::string &username) {
+  // 副本可能尚未复制刚注册的用户，查重读主库
+  return Select(router_->primary(), kSelectUser, username, nullptr);
+}
+
+UserStore::Result MysqlUserStore::Register(const std::string &username, const std::string &password) {
+  // 等待所在批次写入主库；调用方不持有连接，避免与写入线程争用
+  if (!batcher_.Insert({ username, password })) {
+    return kError;
+  }
+  router_->MarkWrite(username);
+  return kOk;
+}
+
+int64_t MysqlUserStore::Count() {
+  ConnectionPoolRAII raii(router_->primary());
+  ResultSet count = raii.Query("SELECT COUNT(*) FROM user");
+  return count.Next() ? count.row().getInt64(0, -1) : -1;
+}
+
+bool MysqlUserStore::ForEachUsername(const UsernameCallback &cb) {
+  // 逐行从连接读取，内存占用与用户数无关；
+  // 结果用于布隆过滤器，不能缺少副本尚未复制的用户，因此读主库
+  ConnectionPoolRAII raii(router_->primary());
+  ResultSet rows = raii.Query("SELECT username FROM user");
+  while (rows.Next()) {
+    cb(rows.row()[0]);
+  }
+  return rows && rows.error() == 0;
+}
+
+NAMESPACE_END
@@ -0,0 +1,48 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-12 09:40:05
+ * @Contact: 2458006466@qq.com
+ * @Description: MysqlUserStore
+ */
+#pragma once
+
+#include "Database/UserStore.h"
+#include "Database/InsertBatcher.h"
+
+NAMESPACE_BEGIN
+class ConnectionPool;
+class DatabaseRouter;
+/**
+ * @brief 以MySQL的user表为后端，查询使用按连接缓存的预处理语句，
+ * 注册的INSERT经InsertBatcher合并为多行写入。
+ * 读写经DatabaseRouter分配：登录及存在性查询读副本，注册及注册前的查重访问主库，
+ * 以用户名作为读己之写的键，刚注册的用户随后的登录仍读主库。
+ */
+class API MysqlUserStore : public UserStore {
+public:
+  explicit MysqlUserStore(DatabaseRouter *router);
+  ~MysqlUserStore() override;
+
+  Result Authenticate(const std::string &username, const std::string &password) override;
+  Result Exists(const std::string &username) override;
+  Result ExistsLatest(const std::string &username) override;
+  Result Register(const std::string &username, const std::string &password) override;
+  int64_t Count() override;
+  bool ForEachUsername(const UsernameCallback &cb) override;
+
+  InsertBatcher::Stats batchStats() {
+    return batcher_.stats();
+  }
+
+  NOT_ALLOWED_COPY(MysqlUserStore)
+
+private:
+  /// @brief 执行单参数或双参数的SELECT，有结果行时返回kOk
+  Result Select(ConnectionPool *pool, const char *sql, const std::string &first, const std::string *second);
+
+private:
+  DatabaseRouter *router_;
+  InsertBatcher batcher_;
+};
+
+NAMESPACE_END
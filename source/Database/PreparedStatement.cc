@@ -0,0 +1,269 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-05 09:48:40
+ * @Contact: 2458006466@qq.com
+ * @Description: PreparedStatement
+ */
+#include "Database/PreparedStatement.h"
+#include "Base/Logger.h"
+#include <string.h>
+
+NAMESPACE_BEGIN
+/// @brief 需要重新预处理后重试的错误：ER_UNKNOWN_STMT_HANDLER(服务端已丢弃语句)、
+/// ER_NEED_REPREPARE(表结构变化)。连接断开(CR_*)时不重试，连接在归还时由连接池关闭并重建
+static const unsigned int kUnknownStmtHandler = 1243;
+static const unsigned int kNeedReprepare = 1615;
+/// @brief CR_UNKNOWN_ERROR，预处理失败且连接上没有错误码时返回
+static const unsigned int kUnknownError = 2000;
+/// @brief 结果列的初始缓冲区大小，更长的值在Fetch时扩容
+static const size_t kColumnBufferSize = 256;
+
+PreparedStatement::PreparedStatement(MYSQL *conn, const std::string &sql) :
+  conn_(conn),
+  stmt_(nullptr),
+  sql_(sql),
+  has_result_(false) {
+
+}
+
+PreparedStatement::~PreparedStatement() {
+  Close();
+}
+
+bool PreparedStatement::Prepare() {
+  Close();
+  stmt_ = mysql_stmt_init(conn_);
+  if (!stmt_) {
+    LogError("Failed Prepare {}, Error is: {}.", sql_, mysql_error(conn_));
+    return false;
+  }
+  if (mysql_stmt_prepare(stmt_, sql_.data(), sql_.size()) != 0) {
+    LogFailed("Prepare");
+    Close();
+    return false;
+  }
+  params_.resize(mysql_stmt_param_count(stmt_));
+  param_binds_.resize(params_.size());
+  columns_.resize(mysql_stmt_field_count(stmt_));
+  result_binds_.resize(columns_.size());
+  for (auto &column : columns_) {
+    column.buffer.resize(kColumnBufferSize);
+  }
+  return true;
+}
+
+void PreparedStatement::Close() {
+  FreeResult();
+  if (stmt_) {
+    mysql_stmt_close(stmt_);
+    stmt_ = nullptr;
+  }
+}
+
+void PreparedStatement::FreeResult() {
+  if (has_result_) {
+    mysql_stmt_free_result(stmt_);
+    has_result_ = false;
+  }
+}
+
+PreparedStatement &PreparedStatement::Bind(int index, const std::string &value) {
+  CHECK(index >= 0 && static_cast<size_t>(index) < params_.size()) << sql_;
+  Param &param = params_[index];
+  param.type = MYSQL_TYPE_STRING;
+  param.str = value;
+  param.length = static_cast<unsigned long>(value.size());
+  param.is_null = 0;
+  return *this;
+}
+
+PreparedStatement &PreparedStatement::Bind(int index, int64_t value) {
+  CHECK(index >= 0 && static_cast<size_t>(index) < params_.size()) << sql_;
+  Param &param = params_[index];
+  param.type = MYSQL_TYPE_LONGLONG;
+  param.num = value;
+  param.is_null = 0;
+  return *this;
+}
+
+PreparedStatement &PreparedStatement::BindNull(int index) {
+  CHECK(index >= 0 && static_cast<size_t>(index) < params_.size()) << sql_;
+  params_[index].type = MYSQL_TYPE_NULL;
+  params_[index].is_null = 1;
+  return *this;
+}
+
+bool PreparedStatement::Execute() {
+  FreeResult();
+  unsigned int error = ExecuteOnce();
+  if (error == kUnknownStmtHandler || error == kNeedReprepare) {
+    // 重新预处理并重试一次
+    std::vector<Param> params = params_;
+    if (Prepare()) {
+      params_ = params;
+      error = ExecuteOnce();
+    }
+  }
+  if (error != 0) {
+    LogFailed("Execute");
+    return false;
+  }
+  return true;
+}
+
+unsigned int PreparedStatement::ExecuteOnce() {
+  // 上次预处理失败时重新预处理
+  if (!stmt_) {
+    std::vector<Param> params = params_;
+    if (!Prepare()) {
+      return mysql_errno(conn_) ? mysql_errno(conn_) : kUnknownError;
+    }
+    if (params.size() == params_.size()) {
+      params_ = params;
+    }
+  }
+
+  for (size_t i = 0; i < params_.size(); ++i) {
+    Param &param = params_[i];
+    MYSQL_BIND &bind = param_binds_[i];
+    memset(&bind, 0, sizeof(bind));
+    bind.buffer_type = param.type;
+    bind.is_null = &param.is_null;
+    if (param.type == MYSQL_TYPE_STRING) {
+      bind.buffer = const_cast<char *>(param.str.data());
+      bind.buffer_length = param.length;
+      bind.length = &param.length;
+    } else if (param.type == MYSQL_TYPE_LONGLONG) {
+      bind.buffer = &param.num;
+    }
+  }
+  if (!params_.empty() && mysql_stmt_bind_param(stmt_, param_binds_.data())) {
+    return mysql_stmt_errno(stmt_);
+  }
+  if (mysql_stmt_execute(stmt_) != 0) {
+    return mysql_stmt_errno(stmt_);
+  }
+  if (!columns_.empty()) {
+    BindResult();
+    if (mysql_stmt_store_result(stmt_) != 0) {
+      return mysql_stmt_errno(stmt_);
+    }
+    has_result_ = true;
+  }
+  return 0;
+}
+
+void PreparedStatement::BindResult() {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    Column &column = columns_[i];
+    MYSQL_BIND &bind = result_binds_[i];
+    memset(&bind, 0, sizeof(bind));
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = column.buffer.data();
+    bind.buffer_length = static_cast<unsigned long>(column.buffer.size());
+    bind.length = &column.length;
+    bind.is_null = &column.is_null;
+    bind.error = &column.error;
+  }
+  mysql_stmt_bind_result(stmt_, result_binds_.data());
+}
+
+bool PreparedStatement::Fetch() {
+  if (!has_result_) {
+    return false;
+  }
+  int ret = mysql_stmt_fetch(stmt_);
+  if (ret == MYSQL_NO_DATA) {
+    return false;
+  }
+  if (ret == 1) {
+    LogFailed("Fetch");
+    return false;
+  }
+  if (ret == MYSQL_DATA_TRUNCATED) {
+    // 扩容被截断的列并单独取回，之后的行使用新的缓冲区
+    bool grown = false;
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      Column &column = columns_[i];
+      if (!column.error) {
+        continue;
+      }
+      column.buffer.resize(column.length);
+      MYSQL_BIND bind;
+      memset(&bind, 0, sizeof(bind));
+      bind.buffer_type = MYSQL_TYPE_STRING;
+      bind.buffer = column.buffer.data();
+      bind.buffer_length = column.length;
+      if (mysql_stmt_fetch_column(stmt_, &bind, static_cast<unsigned int>(i), 0) != 0) {
+        LogFailed("Fetch");
+        return false;
+      }
+      grown = true;
+    }
+    if (grown) {
+      BindResult();
+    }
+  }
+  return true;
+}
+
+std::string PreparedStatement::getString(int column) const {
+  CHECK(column >= 0 && static_cast<size_t>(column) < columns_.size()) << sql_;
+  const Column &col = columns_[column];
+  if (col.is_null) {
+    return std::string();
+  }
+  return std::string(col.buffer.data(), col.length);
+}
+
+bool PreparedStatement::isNull(int column) const {
+  CHECK(column >= 0 && static_cast<size_t>(column) < columns_.size()) << sql_;
+  return columns_[column].is_null;
+}
+
+uint64_t PreparedStatement::numRows() const {
+  return has_result_ ? mysql_stmt_num_rows(stmt_) : 0;
+}
+
+uint64_t PreparedStatement::affectedRows() const {
+  return stmt_ ? mysql_stmt_affected_rows(stmt_) : 0;
+}
+
+uint64_t PreparedStatement::insertId() const {
+  return stmt_ ? mysql_stmt_insert_id(stmt_) : 0;
+}
+
+void PreparedStatement::LogFailed(const char *what) const {
+  LogError("Failed {} {}, Error is: {}.", what, sql_, stmt_ ? mysql_stmt_error(stmt_) : mysql_error(conn_));
+}
+
+StatementCache::StatementCache(MYSQL *conn, size_t capacity) : conn_(conn), capacity_(capacity) {
+
+}
+
+StatementCache::~StatementCache() {
+  statements_.clear();
+  lru_.clear();
+}
+
+PreparedStatement *StatementCache::Get(const std::string &sql) {
+  auto it = statements_.find(sql);
+  if (it != statements_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return lru_.front().get();
+  }
+
+  Entry stmt(new PreparedStatement(conn_, sql));
+  if (!stmt->Prepare()) {
+    return nullptr;
+  }
+  if (statements_.size() >= capacity_) {
+    statements_.erase(lru_.back()->sql());
+    lru_.pop_back();
+  }
+  lru_.push_front(std::move(stmt));
+  statements_.emplace(sql, lru_.begin());
+  return lru_.front().get();
+}
+
+NAMESPACE_END
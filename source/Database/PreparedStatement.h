@@ -0,0 +1,129 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-05 09:48:31
+ * @Contact: 2458006466@qq.com
+ * @Description: PreparedStatement
+ */
+#pragma once
+
+#include "Api.h"
+#include <mysql/mysql.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+NAMESPACE_BEGIN
+/**
+ * @brief MySQL预处理语句，参数以二进制协议绑定，无需拼接及转义SQL。
+ * 语句在连接上只解析一次，之后每次执行只发送参数；服务端丢弃语句或表结构变化时自动重新预处理，
+ * 连接断开时执行失败，由连接池关闭该连接及其语句缓存。由StatementCache缓存，只能在持有该连接的线程中使用。
+ */
+class API PreparedStatement {
+public:
+  ~PreparedStatement();
+
+  /// @brief 绑定参数，index从0开始，绑定的值在下次Execute时生效
+  PreparedStatement &Bind(int index, const std::string &value);
+  PreparedStatement &Bind(int index, int64_t value);
+  PreparedStatement &BindNull(int index);
+
+  /// @brief 执行语句，有结果集时缓存到客户端(mysql_stmt_store_result)
+  /// @return 是否执行成功
+  bool Execute();
+
+  /// @brief 取结果集的下一行
+  /// @return 没有更多的行或出错时返回false
+  bool Fetch();
+
+  /// @brief 当前行第column列的值，NULL返回空串
+  std::string getString(int column) const;
+
+  bool isNull(int column) const;
+
+  uint64_t numRows() const;
+
+  uint64_t affectedRows() const;
+
+  uint64_t insertId() const;
+
+  const std::string &sql() const {
+    return sql_;
+  }
+
+private:
+  friend class StatementCache;
+  /// @brief MYSQL_BIND::is_null的类型，MariaDB为my_bool，MySQL 8为bool
+  using Flag = std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type;
+
+  struct Param {
+    enum_field_types type {MYSQL_TYPE_NULL};
+    std::string str;
+    long long num {0};
+    unsigned long length {0};
+    Flag is_null {1};
+  };
+
+  struct Column {
+    std::vector<char> buffer;
+    unsigned long length {0};
+    Flag is_null {0};
+    Flag error {0};
+  };
+
+  PreparedStatement(MYSQL *conn, const std::string &sql);
+
+  bool Prepare();
+  void Close();
+  void FreeResult();
+  /// @brief 执行一次，失败时返回mysql_stmt_errno
+  unsigned int ExecuteOnce();
+  void BindResult();
+  void LogFailed(const char *what) const;
+
+  NOT_ALLOWED_COPY(PreparedStatement)
+
+private:
+  MYSQL *conn_;
+  MYSQL_STMT *stmt_;
+  const std::string sql_;
+  bool has_result_;
+  std::vector<Param> params_;
+  std::vector<MYSQL_BIND> param_binds_;
+  std::vector<Column> columns_;
+  std::vector<MYSQL_BIND> result_binds_;
+};
+
+/**
+ * @brief 单条连接上的预处理语句缓存，以语句文本为键，超出容量时关闭最久未使用的语句，
+ * 避免动态拼接的语句耗尽服务端的max_prepared_stmt_count。
+ */
+class API StatementCache {
+public:
+  explicit StatementCache(MYSQL *conn, size_t capacity = 64);
+  ~StatementCache();
+
+  /// @brief 获取语句，首次使用时预处理
+  /// @return 预处理失败时返回nullptr
+  PreparedStatement *Get(const std::string &sql);
+
+  size_t size() const {
+    return statements_.size();
+  }
+
+  NOT_ALLOWED_COPY(StatementCache)
+
+private:
+  using Entry = std::unique_ptr<PreparedStatement>;
+
+  MYSQL *conn_;
+  const size_t capacity_;
+  /// @brief 按使用顺序排列，最近使用的在前
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> statements_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,104 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-06 16:25:17
+ * @Contact: 2458006466@qq.com
+ * @Description: ResultSet
+ */
+#include "Database/ResultSet.h"
+#include "Base/Logger.h"
+#include <stdlib.h>
+
+NAMESPACE_BEGIN
+int64_t ResultSet::Row::getInt64(size_t column, int64_t def) const {
+  // 客户端返回的列值以'\0'结尾，可直接解析
+  const char *value = row_[column];
+  if (!value) {
+    return def;
+  }
+  char *end = nullptr;
+  long long num = strtoll(value, &end, 10);
+  return end == value ? def : static_cast<int64_t>(num);
+}
+
+double ResultSet::Row::getDouble(size_t column, double def) const {
+  const char *value = row_[column];
+  if (!value) {
+    return def;
+  }
+  char *end = nullptr;
+  double num = strtod(value, &end);
+  return end == value ? def : num;
+}
+
+ResultSet::ResultSet() : conn_(nullptr), res_(nullptr), rows_(0), error_(0) {
+
+}
+
+ResultSet::ResultSet(MYSQL *conn, MYSQL_RES *res) : conn_(conn), res_(res), rows_(0), error_(0) {
+  if (res_) {
+    row_.fields_ = mysql_num_fields(res_);
+  }
+}
+
+ResultSet::ResultSet(ResultSet &&other) :
+  conn_(other.conn_),
+  res_(other.res_),
+  row_(other.row_),
+  rows_(other.rows_),
+  error_(other.error_) {
+  other.res_ = nullptr;
+  other.row_ = Row();
+}
+
+ResultSet &ResultSet::operator=(ResultSet &&other) {
+  if (this != &other) {
+    Close();
+    conn_ = other.conn_;
+    res_ = other.res_;
+    row_ = other.row_;
+    rows_ = other.rows_;
+    error_ = other.error_;
+    other.res_ = nullptr;
+    other.row_ = Row();
+  }
+  return *this;
+}
+
+ResultSet::~ResultSet() {
+  Close();
+}
+
+bool ResultSet::Next() {
+  if (!res_) {
+    return false;
+  }
+  MYSQL_ROW row = mysql_fetch_row(res_);
+  if (!row) {
+    // 结果集结束与读取出错都返回NULL，以mysql_errno区分
+    error_ = conn_ ? mysql_errno(conn_) : 0;
+    if (error_ != 0) {
+      LogError("Failed fetch row, Error is: {}.", mysql_error(conn_));
+    }
+    row_.row_ = nullptr;
+    row_.lengths_ = nullptr;
+    return false;
+  }
+  row_.row_ = row;
+  row_.lengths_ = mysql_fetch_lengths(res_);
+  ++rows_;
+  return true;
+}
+
+void ResultSet::Close() {
+  if (!res_) {
+    return;
+  }
+  // 未读完的行留在连接上会使下一条语句失败(Commands out of sync)
+  while (mysql_fetch_row(res_)) {
+  }
+  mysql_free_result(res_);
+  res_ = nullptr;
+  row_ = Row();
+}
+
+NAMESPACE_END
@@ -0,0 +1,97 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-06 16:25:09
+ * @Contact: 2458006466@qq.com
+ * @Description: ResultSet
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <mysql/mysql.h>
+#include <cstdint>
+
+NAMESPACE_BEGIN
+/**
+ * @brief mysql_use_result结果集的RAII游标，逐行从连接读取，内存占用与结果集大小无关。
+ * 析构或Close时读完剩余的行并释放结果集，连接可以立即执行下一条语句。
+ * 列值为指向客户端缓冲区的视图，只在移动到下一行之前有效。
+ */
+class API ResultSet {
+public:
+  /// @brief 当前行，列值为客户端缓冲区的视图
+  class Row {
+  public:
+    size_t size() const {
+      return fields_;
+    }
+
+    bool isNull(size_t column) const {
+      return row_[column] == nullptr;
+    }
+
+    /// @brief 第column列的值，NULL返回空视图
+    StringPiece operator[](size_t column) const {
+      return StringPiece(row_[column], row_[column] ? lengths_[column] : 0);
+    }
+
+    /// @brief 按整数解析第column列，NULL或非数字时返回def
+    int64_t getInt64(size_t column, int64_t def = 0) const;
+
+    double getDouble(size_t column, double def = 0.0) const;
+
+  private:
+    friend class ResultSet;
+    MYSQL_ROW row_ {nullptr};
+    unsigned long *lengths_ {nullptr};
+    size_t fields_ {0};
+  };
+
+  ResultSet();
+  /// @param res 由mysql_use_result或mysql_store_result返回，所有权转移到ResultSet
+  ResultSet(MYSQL *conn, MYSQL_RES *res);
+  ResultSet(ResultSet &&other);
+  ResultSet &operator=(ResultSet &&other);
+  ~ResultSet();
+
+  /// @brief 移动到下一行
+  /// @return 没有更多的行或读取出错时返回false，出错时error()非0
+  bool Next();
+
+  const Row &row() const {
+    return row_;
+  }
+
+  /// @brief 结果集是否有效，语句执行失败或没有结果集时为false
+  explicit operator bool() const {
+    return res_ != nullptr;
+  }
+
+  size_t numFields() const {
+    return row_.fields_;
+  }
+
+  /// @brief 已读取的行数
+  uint64_t rowCount() const {
+    return rows_;
+  }
+
+  /// @brief 读取过程中的mysql_errno，正常结束为0
+  unsigned int error() const {
+    return error_;
+  }
+
+  /// @brief 读完剩余的行并释放结果集
+  void Close();
+
+  NOT_ALLOWED_COPY(ResultSet)
+
+private:
+  MYSQL *conn_;
+  MYSQL_RES *res_;
+  Row row_;
+  uint64_t rows_;
+  unsigned int error_;
+};
+
+NAMESPACE_END
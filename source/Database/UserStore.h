@@ -0,0 +1,58 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-12 09:14:36
+ * @Contact: 2458006466@qq.com
+ * @Description: UserStore
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+NAMESPACE_BEGIN
+/**
+ * @brief 用户账号的存储后端，AccountHandler通过该接口登录及注册。
+ * 实现有MysqlUserStore(连接池)及MappedUserStore(进程内的内存映射日志)，
+ * 所有接口须可在多个线程中同时调用。
+ */
+class API UserStore {
+public:
+  enum Result {
+    /// @brief 成功：密码匹配、用户存在或注册成功
+    kOk,
+    /// @brief 否定的结果：用户不存在或密码错误、用户已存在
+    kRejected,
+    /// @brief 后端不可用，结果未知，不应缓存
+    kError,
+  };
+
+  using UsernameCallback = std::function<void(const StringPiece &)>;
+
+  virtual ~UserStore() = default;
+
+  /// @brief 校验用户名及密码
+  virtual Result Authenticate(const std::string &username, const std::string &password) = 0;
+
+  /// @brief 用户名是否存在，存在时返回kOk
+  virtual Result Exists(const std::string &username) = 0;
+
+  /// @brief 注册前的查重，须读到最新的数据(读写分离时读主库)，存在时返回kOk
+  virtual Result ExistsLatest(const std::string &username) {
+    return Exists(username);
+  }
+
+  /// @brief 注册新用户，调用方已确认用户名不存在(或由后端自行检查)
+  virtual Result Register(const std::string &username, const std::string &password) = 0;
+
+  /// @brief 用户个数，出错时返回-1
+  virtual int64_t Count() = 0;
+
+  /// @brief 遍历全部用户名，用于启动时加载过滤器
+  /// @return 是否遍历完成
+  virtual bool ForEachUsername(const UsernameCallback &cb) = 0;
+};
+
+NAMESPACE_END
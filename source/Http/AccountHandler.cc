@@ -0,0 +1,230 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-31 14:05:44
+ * @Contact: 2458006466@qq.com
+ * @Description: AccountHandler
+ */
+#include "Http/AccountHandler.h"
+#include "Http/HttpServer.h"
+#include "Base/BloomFilter.h"
+#include "Database/DatabaseRouter.h"
+#include "Database/MysqlUserStore.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+NAMESPACE_BEGIN
+static const char *const kPages[] = {
+  "/index", "/register", "/login"
+};
+
+/// @brief 须登录后访问的页面
+static const char *const kMemberPages[] = {
+  "/welcome", "/video", "/image",
+  "/fans"
+};
+
+static std::unique_ptr<UserStore> &Store() {
+  static std::unique_ptr<UserStore> store;
+  return store;
+}
+
+/// @brief 过滤器按现有用户数的两倍(至少kMinUsernames)设计容量，为启动后的注册留出余量
+static const int64_t kMinUsernames = 100000;
+static const double kUsernameFalsePositive = 0.01;
+
+/// @brief 已存在用户名的过滤器，在Install中加载，服务启动后只读取指针
+static std::unique_ptr<BloomFilter> &Usernames() {
+  static std::unique_ptr<BloomFilter> usernames;
+  return usernames;
+}
+
+/// @brief 登录缓存的元素，只保存密码的HMAC-SHA256
+struct Credential {
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  bool ok;
+};
+
+static const size_t kCredentialCapacity = 65536;
+static const int64_t kCredentialTtlMs = 60 * 1000;
+static const int64_t kRejectedTtlMs = 5 * 1000;
+
+static ShardedLruCache<Credential> &Credentials() {
+  static ShardedLruCache<Credential> credentials(kCredentialCapacity);
+  return credentials;
+}
+
+/// @brief 以进程启动时随机生成的密钥计算用户名及密码的HMAC-SHA256，缓存中不保存明文，
+/// 密钥不落盘，缓存内容无法离线还原出密码
+static Credential Digest(const std::string &username, const std::string &password) {
+  static const std::vector<unsigned char> key = [] {
+    std::vector<unsigned char> value(32);
+    if (RAND_bytes(value.data(), static_cast<int>(value.size())) != 1) {
+      std::random_device rd;
+      for (unsigned char &byte : value) {
+        byte = static_cast<unsigned char>(rd());
+      }
+    }
+    return value;
+  }();
+  // 用户名以长度为前缀，避免不同的用户名及密码拼接出相同的消息
+  uint32_t user_len = static_cast<uint32_t>(username.size());
+  std::string message(reinterpret_cast<const char *>(&user_len), sizeof(user_len));
+  message += username;
+  message += password;
+  Credential credential;
+  unsigned int len = sizeof(credential.digest);
+  HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()), reinterpret_cast<const unsigned char *>(message.data()),
+       message.size(), credential.digest, &len);
+  credential.ok = false;
+  return credential;
+}
+
+void AccountHandler::InvalidateCredential(const std::string &username) {
+  Credentials().Erase(username);
+}
+
+LruCacheStats AccountHandler::credentialStats() {
+  return Credentials().stats();
+}
+
+void AccountHandler::setUserStore(std::unique_ptr<UserStore> store) {
+  Store() = std::move(store);
+}
+
+UserStore *AccountHandler::userStore() {
+  // 未指定时使用数据库的user表，读写由DatabaseRouter分配到主库及副本
+  if (!Store()) {
+    Store().reset(new MysqlUserStore(DatabaseRouter::getInstance()));
+  }
+  return Store().get();
+}
+
+bool AccountHandler::LoadUsernames() {
+  UserStore *store = userStore();
+  int64_t total = store->Count();
+  if (total < 0) {
+    LogError("load usernames failed, requests always query the user store.");
+    return false;
+  }
+  std::unique_ptr<BloomFilter> filter(new BloomFilter(std::max(total * 2, kMinUsernames), kUsernameFalsePositive));
+  BloomFilter *usernames = filter.get();
+  if (!store->ForEachUsername([usernames](const StringPiece &username) { usernames->Add(username); })) {
+    LogError("load usernames failed, requests always query the user store.");
+    return false;
+  }
+  LogInfo("loaded {} usernames into bloom filter ({} bits, {} hashes).", filter->size(), filter->bits(), filter->hashes());
+  Usernames() = std::move(filter);
+  return true;
+}
+
+bool AccountHandler::Verify(const std::string &username, const std::string &password, bool is_login) {
+  // 最近校验过相同的用户名及密码时直接返回
+  Credential credential = Digest(username, password);
+  if (is_login) {
+    Credential cached;
+    if (Credentials().Get(username, &cached) &&
+        CRYPTO_memcmp(cached.digest, credential.digest, sizeof(credential.digest)) == 0) {
+      return cached.ok;
+    }
+  }
+
+  // 过滤器判定不存在的用户名不访问后端
+  BloomFilter *usernames = Usernames().get();
+  bool maybe_exists = !usernames || usernames->MightContain(username);
+  if (is_login && !maybe_exists) {
+    return false;
+  }
+  UserStore *store = userStore();
+  if (is_login) {
+    // 1.登录验证，只缓存后端给出的结果，出错时不缓存
+    UserStore::Result result = store->Authenticate(username, password);
+    if (result == UserStore::kError) {
+      return false;
+    }
+    credential.ok = result == UserStore::kOk;
+    Credentials().Put(username, credential, credential.ok ? kCredentialTtlMs : kRejectedTtlMs);
+    return credential.ok;
+  }
+  if (maybe_exists && store->ExistsLatest(username) != UserStore::kRejected) {
+    return false;
+  }
+  // 2.注册用户
+  if (store->Register(username, password) != UserStore::kOk) {
+    return false;
+  }
+  if (usernames) {
+    usernames->Add(username);
+  }
+  InvalidateCredential(username);
+  return true;
+}
+
+static std::unique_ptr<SessionStore> &Sessions() {
+  static std::unique_ptr<SessionStore> sessions;
+  return sessions;
+}
+
+SessionStore *AccountHandler::sessions() {
+  return Sessions().get();
+}
+
+void AccountHandler::Install(HttpServer *server, const SessionStore::Options &sessions) {
+  LoadUsernames();
+  Sessions().reset(new SessionStore(sessions));
+  SessionStore *store = Sessions().get();
+
+  // 1.页面别名，会员页面没有会话时返回登录页面
+  for (const char *page : kPages) {
+    std::string path = std::string(page) + ".html";
+    server->Get(page, [path](const HttpRequest &, HttpResponse *resp) {
+      resp->setPath(path);
+    });
+  }
+  // 会员页面的.html形式同样注册，否则会绕过会话校验直接按文件发送
+  for (const char *page : kMemberPages) {
+    std::string path = std::string(page) + ".html";
+    auto member = [store, path](const HttpRequest &req, HttpResponse *resp) {
+      std::string username;
+      resp->setPath(store->Find(req, &username) ? path : "/login.html");
+    };
+    server->Get(page, member);
+    server->Get(path, member);
+  }
+  server->Get("/logout", [store](const HttpRequest &req, HttpResponse *resp) {
+    store->Remove(store->SessionId(req));
+    resp->AddHeader("Set-Cookie", store->ClearCookie());
+    resp->setPath("/login.html");
+  });
+
+  // 2.登录和注册，表单的action为相对路径，同时注册.html形式；
+  // Verify同步访问UserStore，注册为阻塞路由在工作线程中执行
+  auto account = [store](bool is_login) {
+    return [store, is_login](const HttpRequest &req, HttpResponse *resp) {
+      std::string username = req.getPost("username");
+      std::string password = req.getPost("password");
+      LogInfo("username: {}", username);
+      std::string session_user;
+      if (is_login && store->Find(req, &session_user) && session_user == username) {
+        // 已持有该用户的会话，不再校验密码
+        resp->setPath("/welcome.html");
+      } else if (Verify(username, password, is_login)) {
+        resp->AddHeader("Set-Cookie", store->SetCookie(store->Create(username)));
+        resp->setPath("/welcome.html");
+      } else {
+        resp->setPath(is_login ? "/login.html" : "/register.html");
+      }
+    };
+  };
+  server->Route(HttpRequest::kPost, "/login", account(true), true);
+  server->Route(HttpRequest::kPost, "/login.html", account(true), true);
+  server->Route(HttpRequest::kPost, "/register", account(false), true);
+  server->Route(HttpRequest::kPost, "/register.html", account(false), true);
+}
+
+NAMESPACE_END
@@ -0,0 +1,59 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-31 14:05:37
+ * @Contact: 2458006466@qq.com
+ * @Description: AccountHandler
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/LruCache.h"
+#include "Database/UserStore.h"
+#include "Http/SessionStore.h"
+#include <memory>
+#include <string>
+
+NAMESPACE_BEGIN
+class HttpServer;
+/**
+ * @brief 示例站点的页面别名及登录注册路由，原先硬编码在HttpContext中：
+ * (1) GET /index、/login等发送对应的.html页面；
+ * (2) POST /login、/register读取表单中的username及password，
+ *     成功跳转到welcome.html，失败返回登录或注册页面，在阻塞任务线程中执行；
+ *     账号保存在UserStore中，默认为MySQL的user表，也可换成进程内的MappedUserStore；
+ * (3) 登录或注册成功后通过Set-Cookie下发会话，/welcome、/video等页面及其.html形式须持有会话，
+ *     否则返回登录页面；已持有该用户会话的登录请求不再校验密码；GET /logout删除会话。
+ */
+class API AccountHandler {
+public:
+  /// @brief 指定账号的存储后端，须在Install之前调用；未指定时使用DatabaseRouter上的MysqlUserStore
+  static void setUserStore(std::unique_ptr<UserStore> store);
+
+  static UserStore *userStore();
+
+  /// @brief 在server上注册路由，须在InitDatabase(或setUserStore)之后、Start之前调用
+  /// @param sessions 会话表的配置，设置snapshot时重启后保留会话
+  static void Install(HttpServer *server, const SessionStore::Options &sessions = SessionStore::Options());
+
+  /// @brief Install创建的会话表，供其他处理函数校验登录状态
+  static SessionStore *sessions();
+
+  /// @brief 从UserStore流式加载已存在用户名的布隆过滤器，Install时调用；
+  /// 加载失败时不使用过滤器，所有请求照常查询后端
+  /// @return 是否加载成功
+  static bool LoadUsernames();
+
+  /// @brief 使用户的登录缓存失效，注册及修改密码后调用
+  static void InvalidateCredential(const std::string &username);
+
+  /// @brief 登录缓存的命中统计
+  static LruCacheStats credentialStats();
+
+  /// @brief 登录时校验用户名及密码，注册时插入新用户；
+  /// 最近校验过的用户名及密码由缓存直接返回结果，成功的结果保留60秒，失败的保留5秒；
+  /// 过滤器判定用户名不存在时，登录直接失败、注册跳过存在性查询；
+  /// 后端出错时返回false且不缓存
+  static bool Verify(const std::string &username, const std::string &password, bool is_login);
+};
+
+NAMESPACE_END
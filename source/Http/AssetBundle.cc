@@ -0,0 +1,329 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-25 10:02:20
+ * @Contact: 2458006466@qq.com
+ * @Description: AssetBundle
+ */
+#include "Http/AssetBundle.h"
+#include "Http/HttpResponse.h"
+#include "Http/Gzip.h"
+#include "Base/Hash.h"
+#include "Base/Logger.h"
+#include <algorithm>
+#include <cstddef>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+NAMESPACE_BEGIN
+static const char kMagic[8] = { 'M', 'I', 'R', 'R', 'O', 'R', 'A', 'B' };
+/// @brief 位移值最高位置位表示直接存放槽位(只含一个路径的桶)
+static const uint32_t kDirectSlot = 0x80000000u;
+static const uint32_t kMaxSeed = 1u << 24;
+
+namespace {
+struct PackItem {
+  std::string path;
+  std::string body;
+  std::string gzip;
+  time_t last_modified;
+};
+
+bool ReadFile(const std::string &path, std::string *content) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  content->clear();
+  char buf[64 * 1024];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    content->append(buf, n);
+  }
+  close(fd);
+  return n == 0;
+}
+
+/// @brief 递归收集目录下的普通文件，忽略隐藏文件
+bool Collect(const std::string &root, const std::string &dir, std::vector<PackItem> *items) {
+  DIR *d = opendir((root + dir).c_str());
+  if (!d) {
+    LogError("AssetBundle open dir {} failed.", root + dir);
+    return false;
+  }
+  bool ok = true;
+  while (struct dirent *ent = readdir(d)) {
+    if (ent->d_name[0] == '.') {
+      continue;
+    }
+    std::string path = dir + "/" + ent->d_name;
+    struct stat st;
+    if (stat((root + path).c_str(), &st) < 0) {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      ok = Collect(root, path, items) && ok;
+    } else if (S_ISREG(st.st_mode)) {
+      PackItem item;
+      item.path = path;
+      item.last_modified = st.st_mtime;
+      if (!ReadFile(root + path, &item.body)) {
+        LogError("AssetBundle read {} failed.", root + path);
+        ok = false;
+        continue;
+      }
+      items->push_back(std::move(item));
+    }
+  }
+  closedir(d);
+  return ok;
+}
+
+void Align(std::string *out, size_t alignment) {
+  out->resize((out->size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+} // namespace
+
+uint32_t AssetBundle::Slot(const StringPiece &path, uint32_t seed, uint32_t count) {
+  return static_cast<uint32_t>(Hash::Fnv1a64(path.data(), path.size(), seed) % count);
+}
+
+bool AssetBundle::Pack(const std::string &root_path, const std::string &out_path, bool gzip) {
+  // 1.收集文件
+  std::vector<PackItem> items;
+  if (!Collect(root_path, "", &items)) {
+    return false;
+  }
+  uint32_t count = static_cast<uint32_t>(items.size());
+
+  // 2.构建完美哈希：按桶大小降序为每个桶寻找使其路径全部落入空槽位的位移值
+  std::vector<uint32_t> seeds(count, 0);
+  std::vector<int> slot_owner(count, -1);
+  std::vector<std::vector<uint32_t>> buckets(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    buckets[Slot(items[i].path, 0, count)].push_back(i);
+  }
+  std::vector<uint32_t> order(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+  uint32_t free_slot = 0;
+  for (uint32_t b : order) {
+    const std::vector<uint32_t> &bucket = buckets[b];
+    if (bucket.empty()) {
+      break;
+    }
+    if (bucket.size() == 1) {
+      while (slot_owner[free_slot] >= 0) {
+        ++free_slot;
+      }
+      slot_owner[free_slot] = bucket[0];
+      seeds[b] = kDirectSlot | free_slot;
+      continue;
+    }
+    uint32_t seed = 1;
+    std::vector<uint32_t> slots;
+    for (; seed < kMaxSeed; ++seed) {
+      slots.clear();
+      for (uint32_t idx : bucket) {
+        uint32_t slot = Slot(items[idx].path, seed, count);
+        if (slot_owner[slot] >= 0 || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (slots.size() == bucket.size()) {
+        break;
+      }
+    }
+    if (seed == kMaxSeed) {
+      LogError("AssetBundle perfect hash construction failed.");
+      return false;
+    }
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      slot_owner[slots[i]] = bucket[i];
+    }
+    seeds[b] = seed;
+  }
+
+  // 3.写入头部、位移表、记录、字符串区及资源内容
+  std::string out(sizeof(Header), '\0');
+  out.append(reinterpret_cast<const char *>(seeds.data()), seeds.size() * sizeof(uint32_t));
+  Align(&out, alignof(Record));
+  size_t records_offset = out.size();
+  std::vector<Record> records(count);
+  out.resize(out.size() + count * sizeof(Record), '\0');
+
+  auto append = [&out](const std::string &str, size_t alignment) {
+    Align(&out, alignment);
+    Span span = { out.size(), str.size() };
+    out.append(str);
+    return span;
+  };
+  for (uint32_t slot = 0; slot < count; ++slot) {
+    PackItem &item = items[slot_owner[slot]];
+    Record &record = records[slot];
+    std::string mime = HttpResponse::MimeType(item.path);
+    std::string etag = HttpResponse::MakeETag(item.body);
+    if (gzip && Gzip::Compressible(mime) &&
+        (!Gzip::Compress(item.body.data(), item.body.size(), &item.gzip, 9) ||
+         item.gzip.size() >= item.body.size() * 9 / 10)) {
+      // 压缩失败或收益不明显，不保存gzip版本
+      item.gzip.clear();
+    }
+    std::string gzip_etag = item.gzip.empty() ? std::string() : HttpResponse::MakeETag(item.body, true);
+    std::string vary = item.gzip.empty() ? "" : "Vary: Accept-Encoding\r\n";
+    record.path = append(item.path, 1);
+    record.mime = append(mime, 1);
+    record.etag = append(etag, 1);
+    record.headers = append("Content-Type: " + mime + "\r\n" +
+                            HttpResponse::ValidatorHeaders(etag, item.last_modified) + vary +
+                            "Accept-Ranges: bytes\r\nContent-Length: " + std::to_string(item.body.size()) + "\r\n", 1);
+    record.gzip_etag = append(gzip_etag, 1);
+    record.gzip_headers = append(item.gzip.empty() ? std::string() : "Content-Type: " + mime + "\r\n" +
+                                 HttpResponse::ValidatorHeaders(gzip_etag, item.last_modified) + vary +
+                                 "Content-Encoding: gzip\r\nContent-Length: " +
+                                 std::to_string(item.gzip.size()) + "\r\n", 1);
+    record.last_modified = item.last_modified;
+  }
+  for (uint32_t slot = 0; slot < count; ++slot) {
+    const PackItem &item = items[slot_owner[slot]];
+    records[slot].body = append(item.body, kAlignment);
+    records[slot].gzip_body = append(item.gzip, kAlignment);
+  }
+  Align(&out, kAlignment);
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.count = count;
+  header.file_size = out.size();
+  memcpy(&out[0], &header, sizeof(header));
+  if (count > 0) {
+    memcpy(&out[records_offset], records.data(), count * sizeof(Record));
+  }
+
+  // 4.先写临时文件再重命名，正在服务的进程映射的旧文件不受影响
+  std::string tmp_path = out_path + ".tmp";
+  FILE *fp = fopen(tmp_path.c_str(), "wb");
+  if (!fp) {
+    LogError("AssetBundle create {} failed.", tmp_path);
+    return false;
+  }
+  bool ok = fwrite(out.data(), 1, out.size(), fp) == out.size();
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(tmp_path.c_str(), out_path.c_str()) < 0) {
+    LogError("AssetBundle write {} failed.", out_path);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  LogInfo("AssetBundle packed {} assets from {} into {}, {} bytes.", count, root_path, out_path, out.size());
+  return true;
+}
+
+AssetBundle::AssetBundle(const char *data, size_t size) :
+  data_(data),
+  size_(size),
+  count_(0),
+  seeds_(nullptr),
+  records_(nullptr) {
+
+}
+
+AssetBundle::~AssetBundle() {
+  munmap(const_cast<char *>(data_), size_);
+}
+
+std::shared_ptr<AssetBundle> AssetBundle::Open(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LogError("AssetBundle open {} failed.", path);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    LogError("AssetBundle {} is not a bundle.", path);
+    return nullptr;
+  }
+  // 一次映射并预读全部页面，服务期间不再缺页
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LogError("AssetBundle mmap {} failed.", path);
+    return nullptr;
+  }
+  std::shared_ptr<AssetBundle> bundle(new AssetBundle(static_cast<const char *>(data), st.st_size));
+  if (!bundle->Validate()) {
+    LogError("AssetBundle {} is corrupted.", path);
+    return nullptr;
+  }
+  LogInfo("AssetBundle {} loaded, {} assets.", path, bundle->size());
+  return bundle;
+}
+
+bool AssetBundle::Validate() {
+  static_assert(offsetof(Record, last_modified) == kSpans * sizeof(Span), "spans must precede other fields");
+  const Header *header = reinterpret_cast<const Header *>(data_);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+      header->file_size != size_) {
+    return false;
+  }
+  uint32_t count = header->count;
+  size_t seeds_end = sizeof(Header) + static_cast<size_t>(count) * sizeof(uint32_t);
+  size_t records_offset = (seeds_end + alignof(Record) - 1) / alignof(Record) * alignof(Record);
+  if (records_offset + static_cast<size_t>(count) * sizeof(Record) > size_) {
+    return false;
+  }
+  const uint32_t *seeds = reinterpret_cast<const uint32_t *>(data_ + sizeof(Header));
+  const Record *records = reinterpret_cast<const Record *>(data_ + records_offset);
+  for (uint32_t i = 0; i < count; ++i) {
+    if ((seeds[i] & kDirectSlot) && (seeds[i] & ~kDirectSlot) >= count) {
+      return false;
+    }
+    const Span *spans = &records[i].path;
+    for (size_t j = 0; j < kSpans; ++j) {
+      if (spans[j].offset > size_ || spans[j].length > size_ - spans[j].offset) {
+        return false;
+      }
+    }
+  }
+  count_ = count;
+  seeds_ = seeds;
+  records_ = records;
+  return true;
+}
+
+bool AssetBundle::Find(const StringPiece &path, Asset *asset) const {
+  if (count_ == 0) {
+    return false;
+  }
+  uint32_t seed = seeds_[Slot(path, 0, count_)];
+  uint32_t slot = (seed & kDirectSlot) ? (seed & ~kDirectSlot) : Slot(path, seed, count_);
+  const Record &record = records_[slot];
+  // 不在包中的路径也会落到某个槽位，须比较路径
+  if (View(record.path) != path) {
+    return false;
+  }
+  asset->path = View(record.path);
+  asset->mime = View(record.mime);
+  asset->etag = View(record.etag);
+  asset->headers = View(record.headers);
+  asset->body = View(record.body);
+  asset->gzip_etag = View(record.gzip_etag);
+  asset->gzip_headers = View(record.gzip_headers);
+  asset->gzip_body = View(record.gzip_body);
+  asset->last_modified = static_cast<time_t>(record.last_modified);
+  return true;
+}
+
+NAMESPACE_END
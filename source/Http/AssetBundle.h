@@ -0,0 +1,108 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-25 10:02:13
+ * @Contact: 2458006466@qq.com
+ * @Description: AssetBundle
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <ctime>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+NAMESPACE_BEGIN
+/**
+ * @brief 静态资源包：构建时将文档根目录打包为单个带索引的文件，服务时整体mmap。
+ * 文件布局(本机字节序)：
+ * (1) Header：魔数、版本、资源数；
+ * (2) 完美哈希的位移表seeds[count]及资源记录records[count]，路径先哈希到桶，
+ *     再以桶的位移值哈希到唯一槽位，查找只需两次哈希和一次路径比较；
+ * (3) 字符串区：路径、MIME类型、ETag及预先生成的响应头部(不含结尾空行)；
+ * (4) 资源内容及gzip压缩版本，按kAlignment对齐。
+ */
+class API AssetBundle {
+public:
+  static const uint32_t kVersion = 2;
+  static const size_t kAlignment = 64;
+
+  /// @brief 一个资源，所有字段均指向映射的包文件
+  struct Asset {
+    StringPiece path;
+    StringPiece mime;
+    StringPiece etag;
+    /// @brief Content-Type、ETag、Last-Modified、Content-Length等头部，不含结尾空行
+    StringPiece headers;
+    StringPiece body;
+    /// @brief gzip版本，资源不适合压缩时为空
+    StringPiece gzip_etag;
+    StringPiece gzip_headers;
+    StringPiece gzip_body;
+    /// @brief 打包时文件的修改时间
+    time_t last_modified;
+  };
+
+  ~AssetBundle();
+
+  /// @brief 将文档根目录打包到out_path
+  /// @param gzip 是否为文本类资源生成gzip版本
+  static bool Pack(const std::string &root_path, const std::string &out_path, bool gzip = true);
+
+  /// @brief 以MAP_POPULATE映射包文件并校验索引
+  /// @return 文件不存在或格式错误时返回nullptr
+  static std::shared_ptr<AssetBundle> Open(const std::string &path);
+
+  /// @brief 按请求路径查找资源，不产生系统调用
+  bool Find(const StringPiece &path, Asset *asset) const;
+
+  uint32_t size() const {
+    return count_;
+  }
+
+private:
+  struct Span {
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t file_size;
+  };
+
+  struct Record {
+    Span path;
+    Span mime;
+    Span etag;
+    Span headers;
+    Span body;
+    Span gzip_etag;
+    Span gzip_headers;
+    Span gzip_body;
+    int64_t last_modified;
+  };
+  static const size_t kSpans = 8;
+
+  AssetBundle(const char *data, size_t size);
+
+  bool Validate();
+  StringPiece View(const Span &span) const {
+    return StringPiece(data_ + span.offset, span.length);
+  }
+  static uint32_t Slot(const StringPiece &path, uint32_t seed, uint32_t count);
+
+  NOT_ALLOWED_COPY(AssetBundle)
+
+private:
+  const char *data_;
+  size_t size_;
+  uint32_t count_;
+  const uint32_t *seeds_;
+  const Record *records_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,315 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-24 09:48:20
+ * @Contact: 2458006466@qq.com
+ * @Description: FileCache
+ */
+#include "Http/FileCache.h"
+#include "Http/HttpResponse.h"
+#include "Http/Gzip.h"
+#include "Base/ThreadPool.h"
+#include "Base/Logger.h"
+#include "Core/Channel.h"
+#include "Core/EventLoop.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NAMESPACE_BEGIN
+static size_t EntryBytes(const FileCache::Entry &entry) {
+  size_t bytes = entry.body.size() + entry.headers.size();
+  FileCache::VariantPtr gzip = entry.gzip();
+  if (gzip) {
+    bytes += gzip->body.size() + gzip->headers.size();
+  }
+  return bytes;
+}
+
+/// @brief 只缓存规范路径，避免同一文件以多个键缓存而无法失效
+static bool Cacheable(const std::string &path) {
+  return !path.empty() && path[0] == '/' &&
+         path.find("/.") == std::string::npos &&
+         path.find("//") == std::string::npos &&
+         path.find('\0') == std::string::npos;
+}
+
+FileCache::FileCache(const std::string &root_path, size_t max_bytes, size_t max_file_size) :
+  root_path_(root_path),
+  shard_capacity_(max_bytes / kShards),
+  max_file_size_(max_file_size),
+  worker_pool_(nullptr),
+  inotify_fd_(-1) {
+
+}
+
+FileCache::~FileCache() {
+  if (channel_) {
+    channel_->DisableAll();
+    channel_->Remove();
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+}
+
+FileCache::Shard &FileCache::ShardOf(const std::string &path) {
+  return shards_[std::hash<std::string>()(path) % kShards];
+}
+
+FileCache::EntryPtr FileCache::Get(const std::string &path) {
+  if (!Cacheable(path)) {
+    return nullptr;
+  }
+  // 1.命中则移到LRU表头
+  Shard &shard = ShardOf(path);
+  uint64_t generation = 0;
+  {
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      return *it->second;
+    }
+    generation = shard.generation;
+  }
+
+  // 2.未命中则在锁外读取文件
+  EntryPtr entry = Load(path);
+  if (!entry) {
+    return nullptr;
+  }
+  size_t size = EntryBytes(*entry);
+  if (size > shard_capacity_) {
+    return entry;
+  }
+
+  // 3.加入缓存，加载期间发生过失效或已被其他线程加入则不再插入
+  std::unique_lock<std::mutex> lock(shard.mtx);
+  if (shard.generation != generation) {
+    return entry;
+  }
+  auto it = shard.index.find(path);
+  if (it != shard.index.end()) {
+    return *it->second;
+  }
+  while (shard.bytes + size > shard_capacity_ && !shard.lru.empty()) {
+    Evict(&shard, std::prev(shard.lru.end()));
+  }
+  shard.lru.push_front(entry);
+  shard.index[path] = shard.lru.begin();
+  shard.bytes += size;
+  return entry;
+}
+
+FileCache::EntryPtr FileCache::Load(const std::string &path) {
+  std::string full_path = root_path_ + path;
+  struct stat st;
+  if (stat(full_path.c_str(), &st) < 0 || !S_ISREG(st.st_mode) || !(st.st_mode & S_IROTH) ||
+      static_cast<size_t>(st.st_size) > max_file_size_) {
+    return nullptr;
+  }
+  int fd = open(full_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+  entry->path = path;
+  entry->last_modified = st.st_mtime;
+  entry->body.resize(st.st_size);
+  size_t nread = 0;
+  while (nread < entry->body.size()) {
+    ssize_t n = read(fd, &entry->body[nread], entry->body.size() - nread);
+    if (n <= 0) {
+      break;
+    }
+    nread += n;
+  }
+  close(fd);
+  if (nread != entry->body.size()) {
+    // 读取期间文件被截断
+    return nullptr;
+  }
+
+  std::string mime = HttpResponse::MimeType(path);
+  entry->compressible = entry->body.size() >= Gzip::kMinSize && Gzip::Compressible(mime);
+  entry->etag = HttpResponse::MakeETag(entry->body);
+  std::string headers = "Content-Type: " + mime + "\r\n" +
+                        HttpResponse::ValidatorHeaders(entry->etag, entry->last_modified);
+  if (entry->compressible) {
+    headers += "Vary: Accept-Encoding\r\n";
+  }
+  headers += "Accept-Ranges: bytes\r\n";
+  entry->headers = headers + "Content-Length: " + std::to_string(entry->body.size()) + "\r\n";
+  LogDebug("FileCache load {}, {} bytes.", path, entry->body.size());
+  return entry;
+}
+
+FileCache::VariantPtr FileCache::Compressed(const EntryPtr &entry) {
+  if (!entry->compressible) {
+    return nullptr;
+  }
+  VariantPtr gzip = entry->gzip();
+  if (gzip || !worker_pool_ || entry->gzip_started.exchange(true)) {
+    return gzip;
+  }
+  // 压缩只进行一次，且不占用IO线程
+  if (!worker_pool_->Run(std::bind(&FileCache::Compress, this, entry))) {
+    entry->gzip_started = false;
+  }
+  return nullptr;
+}
+
+void FileCache::Compress(const EntryPtr &entry) {
+  std::shared_ptr<Variant> gzip = std::make_shared<Variant>();
+  if (!Gzip::Compress(entry->body.data(), entry->body.size(), &gzip->body) ||
+      gzip->body.size() >= entry->body.size() * 9 / 10) {
+    // 压缩收益不明显，之后一直发送未压缩版本
+    return;
+  }
+  gzip->etag = HttpResponse::MakeETag(entry->body, true);
+  gzip->headers = "Content-Type: " + HttpResponse::MimeType(entry->path) + "\r\n" +
+                  HttpResponse::ValidatorHeaders(gzip->etag, entry->last_modified) + "Vary: Accept-Encoding\r\n"
+                  "Content-Encoding: gzip\r\nContent-Length: " + std::to_string(gzip->body.size()) + "\r\n";
+
+  // 缓存项仍在缓存中才挂上gzip版本，同时计入内存占用
+  Shard &shard = ShardOf(entry->path);
+  std::unique_lock<std::mutex> lock(shard.mtx);
+  auto it = shard.index.find(entry->path);
+  if (it == shard.index.end() || *it->second != entry) {
+    return;
+  }
+  std::atomic_store(&entry->gzip_, VariantPtr(gzip));
+  shard.bytes += gzip->body.size() + gzip->headers.size();
+  while (shard.bytes > shard_capacity_ && shard.lru.size() > 1 && shard.lru.back() != entry) {
+    Evict(&shard, std::prev(shard.lru.end()));
+  }
+}
+
+void FileCache::Evict(Shard *shard, std::list<EntryPtr>::iterator it) {
+  const Entry &entry = **it;
+  shard->bytes -= EntryBytes(entry);
+  shard->index.erase(entry.path);
+  shard->lru.erase(it);
+}
+
+void FileCache::Invalidate(const std::string &path) {
+  Shard &shard = ShardOf(path);
+  std::unique_lock<std::mutex> lock(shard.mtx);
+  ++shard.generation;
+  auto it = shard.index.find(path);
+  if (it != shard.index.end()) {
+    LogDebug("FileCache invalidate {}.", path);
+    Evict(&shard, it->second);
+  }
+}
+
+void FileCache::Clear() {
+  for (Shard &shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    ++shard.generation;
+    shard.lru.clear();
+    shard.index.clear();
+    shard.bytes = 0;
+  }
+}
+
+size_t FileCache::bytes() {
+  size_t total = 0;
+  for (Shard &shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    total += shard.bytes;
+  }
+  return total;
+}
+
+bool FileCache::Watch(EventLoop *loop) {
+  if (channel_) {
+    return true;
+  }
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    LogError("inotify_init1 failed, errno: {}.", errno);
+    return false;
+  }
+  AddWatch("");
+  channel_.reset(new Channel(loop, inotify_fd_));
+  channel_->setReadCallback(std::bind(&FileCache::HandleRead, this));
+  channel_->EnableReading();
+  return true;
+}
+
+void FileCache::AddWatch(const std::string &dir) {
+  // 1.监听目录本身，inotify不递归，子目录需逐个添加
+  std::string full_path = root_path_ + dir;
+  const uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                        IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+  int wd = inotify_add_watch(inotify_fd_, full_path.c_str(), mask);
+  if (wd < 0) {
+    LogError("inotify_add_watch {} failed, errno: {}.", full_path, errno);
+    return;
+  }
+  watches_[wd] = dir;
+
+  // 2.递归添加子目录
+  DIR *d = opendir(full_path.c_str());
+  if (!d) {
+    return;
+  }
+  while (struct dirent *ent = readdir(d)) {
+    std::string name = ent->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+    struct stat st;
+    std::string sub = dir + "/" + name;
+    if (stat((root_path_ + sub).c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      AddWatch(sub);
+    }
+  }
+  closedir(d);
+}
+
+void FileCache::HandleRead() {
+  alignas(struct inotify_event) char buf[4096];
+  for (;;) {
+    ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+    if (n <= 0) {
+      break;
+    }
+    for (char *p = buf; p < buf + n;) {
+      const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+      p += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        // 事件丢失，无法确定哪些文件变化
+        LogInfo("FileCache inotify queue overflow, clear all.");
+        Clear();
+        continue;
+      }
+      auto it = watches_.find(event->wd);
+      if (it == watches_.end()) {
+        continue;
+      }
+      if (event->mask & IN_IGNORED) {
+        watches_.erase(it);
+        continue;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+      std::string path = it->second + "/" + event->name;
+      if (event->mask & IN_ISDIR) {
+        // 目录增删或重命名，其下所有缓存项都可能失效
+        Clear();
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          AddWatch(path);
+        }
+      } else {
+        Invalidate(path);
+      }
+    }
+  }
+}
+
+NAMESPACE_END
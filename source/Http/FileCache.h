@@ -0,0 +1,126 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-24 09:48:12
+ * @Contact: 2458006466@qq.com
+ * @Description: FileCache
+ */
+#pragma once
+
+#include "Api.h"
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+NAMESPACE_BEGIN
+class Channel;
+class EventLoop;
+class ThreadPool;
+/**
+ * @brief 静态文件响应缓存。
+ * (1) 缓存项为预先生成的实体头部(Content-Type、ETag、Content-Length等)及文件内容，
+ *     构建后只读，状态行、连接及Date等头部在发送时由HttpHeaderWriter写入；
+ *     以shared_ptr在各subLoop间共享，命中时不产生任何文件系统调用；
+ * (2) 按路径哈希分片，每个分片独立加锁并按LRU淘汰，总内存受max_bytes限制；
+ * (3) Watch后通过inotify监听文档根目录(含子目录)，文件变化时使对应缓存项失效；
+ * (4) 文本类文件的gzip版本在首次被请求时交给工作线程生成，完成后挂到缓存项上。
+ */
+class API FileCache {
+public:
+  /// @brief 同一文件的一种编码
+  struct Variant {
+    /// @brief 实体头部，不含结尾空行
+    std::string headers;
+    std::string body;
+    /// @brief 由内容哈希生成的强ETag
+    std::string etag;
+  };
+  using VariantPtr = std::shared_ptr<const Variant>;
+
+  struct Entry : public Variant {
+    Entry() : last_modified(0), compressible(false), gzip_started(false) {}
+
+    /// @brief gzip版本，尚未生成或压缩无收益时为空
+    VariantPtr gzip() const {
+      return std::atomic_load(&gzip_);
+    }
+
+    std::string path;
+    time_t last_modified;
+    bool compressible;
+    mutable std::atomic<bool> gzip_started;
+    mutable VariantPtr gzip_;
+  };
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  static const size_t kShards = 16;
+
+  /// @param max_bytes 缓存总字节数上限
+  /// @param max_file_size 可缓存的单个文件大小上限，更大的文件仍走mmap
+  FileCache(const std::string &root_path, size_t max_bytes, size_t max_file_size);
+  ~FileCache();
+
+  /// @brief 查找缓存，未命中时从磁盘加载并加入缓存
+  /// @return 文件不存在、不可读或不适合缓存时返回nullptr
+  EntryPtr Get(const std::string &path);
+
+  /// @brief 取缓存项的gzip版本，尚未生成时提交给工作线程压缩并返回nullptr，
+  /// 本次请求先发送未压缩版本
+  VariantPtr Compressed(const EntryPtr &entry);
+
+  /// @brief 设置执行压缩的工作线程池，未设置时不生成gzip版本
+  void setWorkerPool(ThreadPool *pool) {
+    worker_pool_ = pool;
+  }
+
+  /// @brief 使路径对应的缓存项失效
+  void Invalidate(const std::string &path);
+
+  /// @brief 清空所有缓存项
+  void Clear();
+
+  /// @brief 在loop上监听文档根目录的变化，须在loop线程调用
+  bool Watch(EventLoop *loop);
+
+  /// @brief 当前缓存占用的字节数
+  size_t bytes();
+
+private:
+  struct Shard {
+    Shard() : bytes(0), generation(0) {}
+
+    std::mutex mtx;
+    std::list<EntryPtr> lru;
+    std::unordered_map<std::string, std::list<EntryPtr>::iterator> index;
+    size_t bytes;
+    /// @brief 每次失效递增，丢弃失效前开始加载的数据
+    uint64_t generation;
+  };
+
+  Shard &ShardOf(const std::string &path);
+  EntryPtr Load(const std::string &path);
+  void Compress(const EntryPtr &entry);
+  void Evict(Shard *shard, std::list<EntryPtr>::iterator it);
+  void AddWatch(const std::string &dir);
+  void HandleRead();
+
+  NOT_ALLOWED_COPY(FileCache)
+
+private:
+  const std::string root_path_;
+  const size_t shard_capacity_;
+  const size_t max_file_size_;
+  Shard shards_[kShards];
+  ThreadPool *worker_pool_;
+
+  int inotify_fd_;
+  std::unique_ptr<Channel> channel_;
+  /// @brief inotify watch描述符到相对根目录路径的映射，只在loop线程访问
+  std::unordered_map<int, std::string> watches_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,127 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-28 10:15:40
+ * @Contact: 2458006466@qq.com
+ * @Description: Gzip
+ */
+#include "Http/Gzip.h"
+#include "Base/Buffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+NAMESPACE_BEGIN
+namespace Gzip {
+/// @brief windowBits + 16 输出gzip格式
+static const int kWindowBits = 15 + 16;
+static const int kMemLevel = 8;
+
+bool Compressible(const StringPiece &mime) {
+  return mime.StartsWith("text/") || mime.find("xml") != StringPiece::npos ||
+         mime.find("javascript") != StringPiece::npos || mime.find("json") != StringPiece::npos;
+}
+
+static StringPiece Trim(StringPiece str) {
+  while (!str.empty() && (str[0] == ' ' || str[0] == '\t')) {
+    str.RemovePrefix(1);
+  }
+  while (!str.empty() && (str[str.size() - 1] == ' ' || str[str.size() - 1] == '\t')) {
+    str.RemoveSuffix(1);
+  }
+  return str;
+}
+
+bool Accepted(const StringPiece &accept_encoding) {
+  // 形如 "gzip, deflate;q=0.5, *;q=0"，显式列出的gzip优先于通配符
+  int gzip = -1;
+  int wildcard = -1;
+  StringPiece rest = accept_encoding;
+  while (!rest.empty()) {
+    size_t comma = rest.find(",");
+    StringPiece item = rest.substr(0, comma);
+    rest = (comma == StringPiece::npos) ? StringPiece() : rest.substr(comma + 1);
+
+    size_t semi = item.find(";");
+    StringPiece coding = Trim(item.substr(0, semi));
+    bool allowed = true;
+    if (semi != StringPiece::npos) {
+      StringPiece param = Trim(item.substr(semi + 1));
+      if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+        std::string q = param.substr(2).ToString();
+        allowed = atof(q.c_str()) > 0;
+      }
+    }
+    if (coding.EqualsIgnoreCase("gzip") || coding.EqualsIgnoreCase("x-gzip")) {
+      gzip = allowed;
+    } else if (coding == "*") {
+      wildcard = allowed;
+    }
+  }
+  return gzip >= 0 ? gzip == 1 : wildcard == 1;
+}
+
+bool Compress(const char *data, size_t len, std::string *out, int level) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit2(&zs, level, Z_DEFLATED, kWindowBits, kMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&zs, len));
+  zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  zs.avail_in = static_cast<uInt>(len);
+  zs.next_out = reinterpret_cast<Bytef *>(&(*out)[0]);
+  zs.avail_out = static_cast<uInt>(out->size());
+  int ret = deflate(&zs, Z_FINISH);
+  out->resize(zs.total_out);
+  deflateEnd(&zs);
+  return ret == Z_STREAM_END;
+}
+
+Stream::Stream(int level) : zs_(new z_stream), ok_(false) {
+  memset(zs_.get(), 0, sizeof(z_stream));
+  ok_ = deflateInit2(zs_.get(), level, Z_DEFLATED, kWindowBits, kMemLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+Stream::~Stream() {
+  if (ok_) {
+    deflateEnd(zs_.get());
+  }
+}
+
+bool Stream::Deflate(const char *data, size_t len, int flush, Buffer *out) {
+  if (!ok_) {
+    return false;
+  }
+  zs_->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  zs_->avail_in = static_cast<uInt>(len);
+  for (;;) {
+    // 直接压缩到Buffer的可写区域，空间不足时扩容
+    out->EnsureWriteableBytes(deflateBound(zs_.get(), zs_->avail_in) + 64);
+    size_t avail = out->WriteableBytes();
+    zs_->next_out = reinterpret_cast<Bytef *>(out->beginWrite());
+    zs_->avail_out = static_cast<uInt>(avail);
+    int ret = deflate(zs_.get(), flush);
+    out->HasWritten(avail - zs_->avail_out);
+    if (ret == Z_STREAM_END) {
+      return true;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      ok_ = false;
+      return false;
+    }
+    if (zs_->avail_in == 0 && zs_->avail_out != 0) {
+      return flush != Z_FINISH;
+    }
+  }
+}
+
+bool Stream::Write(const char *data, size_t len, Buffer *out) {
+  return Deflate(data, len, Z_NO_FLUSH, out);
+}
+
+bool Stream::Finish(Buffer *out) {
+  return Deflate(nullptr, 0, Z_FINISH, out);
+}
+
+} // namespace Gzip
+NAMESPACE_END
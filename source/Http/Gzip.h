@@ -0,0 +1,52 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-28 10:15:32
+ * @Contact: 2458006466@qq.com
+ * @Description: Gzip
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <memory>
+#include <string>
+
+struct z_stream_s;
+
+NAMESPACE_BEGIN
+class Buffer;
+namespace Gzip {
+/// @brief 小于该大小的响应体压缩收益不足以抵消CPU开销
+static const size_t kMinSize = 1024;
+
+/// @brief 文本类MIME类型才值得压缩，图片、视频等本身已压缩
+API bool Compressible(const StringPiece &mime);
+
+/// @brief 按Accept-Encoding协商是否可以使用gzip，支持q值及通配符
+API bool Accepted(const StringPiece &accept_encoding);
+
+/// @brief 一次性压缩为gzip格式
+API bool Compress(const char *data, size_t len, std::string *out, int level = 6);
+
+/// @brief 流式压缩，输出直接写入Buffer，响应体可以分段产生
+class API Stream {
+public:
+  explicit Stream(int level = 6);
+  ~Stream();
+
+  bool Write(const char *data, size_t len, Buffer *out);
+  /// @brief 写入剩余数据及gzip尾部
+  bool Finish(Buffer *out);
+
+private:
+  bool Deflate(const char *data, size_t len, int flush, Buffer *out);
+
+  NOT_ALLOWED_COPY(Stream)
+
+private:
+  std::unique_ptr<z_stream_s> zs_;
+  bool ok_;
+};
+
+} // namespace Gzip
+NAMESPACE_END
@@ -0,0 +1,33 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-01 10:18:40
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpAsyncResponse
+ */
+#include "Http/HttpAsyncResponse.h"
+#include "Core/EventLoop.h"
+
+NAMESPACE_BEGIN
+HttpAsyncResponse::HttpAsyncResponse(EventLoop *loop, const Finisher &finisher) :
+  loop_(loop),
+  finisher_(finisher),
+  done_(false) {
+  response_.setOutput(&output_);
+}
+
+HttpAsyncResponse::~HttpAsyncResponse() = default;
+
+void HttpAsyncResponse::Done() {
+  if (done_.exchange(true)) {
+    return;
+  }
+  // 持有自身直到在loop中完成
+  loop_->RunInLoop(std::bind(&HttpAsyncResponse::Finish, shared_from_this()));
+}
+
+void HttpAsyncResponse::Finish() {
+  finisher_(this);
+  finisher_ = nullptr;
+}
+
+NAMESPACE_END
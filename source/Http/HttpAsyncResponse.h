@@ -0,0 +1,58 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-01 10:18:32
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpAsyncResponse
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/Buffer.h"
+#include "Http/HttpResponse.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+NAMESPACE_BEGIN
+class EventLoop;
+/**
+ * @brief 异步响应句柄，处理函数在其他线程(或稍后)生成响应，
+ * 完成时调用Done将结果投递回连接所属的loop，由loop按管线化顺序发送。
+ * 连接在完成前关闭时结果被丢弃。
+ */
+class API HttpAsyncResponse : public std::enable_shared_from_this<HttpAsyncResponse> {
+public:
+  /// @brief 在所属loop中执行，将结果写入连接的待发送响应
+  using Finisher = std::function<void(HttpAsyncResponse *)>;
+
+  HttpAsyncResponse(EventLoop *loop, const Finisher &finisher);
+  ~HttpAsyncResponse();
+
+  /// @brief 处理函数使用的响应，MakeResponse(str, type)写入output()
+  HttpResponse *response() {
+    return &response_;
+  }
+
+  Buffer *output() {
+    return &output_;
+  }
+
+  /// @brief 响应生成完毕，可在任意线程调用，重复调用无效
+  void Done();
+
+private:
+  void Finish();
+
+  NOT_ALLOWED_COPY(HttpAsyncResponse)
+
+private:
+  EventLoop *loop_;
+  Finisher finisher_;
+  HttpResponse response_;
+  Buffer output_;
+  std::atomic<bool> done_;
+};
+
+using HttpAsyncResponsePtr = std::shared_ptr<HttpAsyncResponse>;
+
+NAMESPACE_END
@@ -7,204 +7,360 @@
 #include "Http/HttpContext.h"
 #include "Base/Buffer.h"
 #include "Base/Logger.h"
-#include "Database/ConnectionPool.h"
-#include <regex>
-#include <unordered_set>
-#include <unordered_map>
+#include "Base/ByteScan.h"
+#include <algorithm>
+#include <limits>
 
 NAMESPACE_BEGIN
-const std::unordered_set<std::string> DefaultHtml {
-  "/index", "/register", "/login",
-  "/welcome", "/video", "/image", 
-  "/fans"
-};
-
-const std::unordered_map<std::string, int> DefaultHtmlTag {
-  {"/register.html", 0}, {"/login.html", 1},
-};
-
-static int ConverHex(char ch) {
-  if(ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
-  if(ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
-  return ch;
+/// @brief chunk长度行及trailer行的长度上限
+static const size_t kMaxChunkLine = 4096;
+
+static int HexValue(char ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+  return -1;
 }
 
-static bool Verify(const std::string &username, const std::string &passward, bool is_login) {
-  ConnectionPoolRAII raii(ConnectionPool::getInstance());
-  if (is_login) {
-    // 1.登录验证
-    std::string sql_query = "SELECT username, passwd FROM user WHERE username='" + username + "' AND passwd='" + passward + "'";
-    auto result = raii.Query(sql_query);
-    if (!result) {
-      return false;
+/// @brief application/x-www-form-urlencoded解码，整段拷贝无需转义的字节
+static void UrlDecode(const char *begin, const char *end, std::string *out) {
+  out->clear();
+  while (begin < end) {
+    const char *esc = ByteScan::FindUrlEscape(begin, end);
+    out->append(begin, esc);
+    if (esc == end) {
+      break;
     }
-    return true;
-  } else {
-    std::string sql_query = "SELECT username, passwd FROM user WHERE username='" + username + "' LIMIT 1";
-    auto result = raii.Query(sql_query);
-    if (result) {
-      return false;
+    if (*esc == '+') {
+      out->push_back(' ');
+      begin = esc + 1;
+    } else if (end - esc >= 3 && HexValue(esc[1]) >= 0 && HexValue(esc[2]) >= 0) {
+      out->push_back(static_cast<char>(HexValue(esc[1]) * 16 + HexValue(esc[2])));
+      begin = esc + 3;
+    } else {
+      // 不完整的转义序列按原样保留
+      out->push_back('%');
+      begin = esc + 1;
     }
-    // 2.注册用户
-    std::string sql_insert = "INSERT INTO user (username, passwd) VALUES ('" + username + "', '" + passward + "')";
-    return raii.Execute(sql_insert);
   }
 }
 
-HttpContext::HttpContext() : state_(kExpectRequestLine) {
+/// @brief 规范化请求路径：合并连续的'/'，去掉"."段并回退".."段，以便路由及会话校验
+/// 与最终发送的文件一致(如"//welcome.html"、"/x/../welcome.html")
+/// @return ".."越过根目录时返回false
+static bool NormalizePath(const StringPiece &path, std::string *out) {
+  out->clear();
+  bool dir = false;
+  size_t i = 0;
+  while (i < path.size()) {
+    while (i < path.size() && path[i] == '/') {
+      ++i;
+    }
+    size_t begin = i;
+    while (i < path.size() && path[i] != '/') {
+      ++i;
+    }
+    StringPiece segment(path.data() + begin, i - begin);
+    // 以"/"、"."或".."结尾的路径仍指向目录
+    dir = segment.empty() || segment == "." || segment == "..";
+    if (segment == "..") {
+      if (out->empty()) {
+        return false;
+      }
+      out->resize(out->rfind('/'));
+    } else if (!dir) {
+      out->push_back('/');
+      out->append(segment.data(), segment.size());
+    }
+  }
+  if (dir || out->empty()) {
+    out->push_back('/');
+  }
+  return true;
+}
+
+HttpContext::HttpContext() :
+  state_(kExpectRequestLine),
+  request_size_(0),
+  framing_(kNoBody),
+  body_remaining_(0),
+  chunk_state_(kChunkSize),
+  max_body_size_(kDefaultMaxBodySize),
+  stream_(nullptr),
+  error_code_(400),
+  expect_continue_(false),
+  requests_(0),
+  idle_timer_(0) {
 
 }
 
 HttpContext::~HttpContext() = default;
 
-bool HttpContext::ParseRequestLine(const std::string &line) {
-  LogDebug("ParseRequestLine: {}", line);
-  std::regex pattern("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-  std::smatch match;
-  if (std::regex_match(line, match, pattern)) {
-    req_.setMethod(match[1].str());
-    req_.setPath(match[2].str());
-    req_.setVersion(match[3].str());
-    state_ = kExpectHeaders;
-    return true;
+bool HttpContext::FillRequest(Timestamp recv_time) {
+  req_.setMethod(parser_.method());
+  StringPiece path = parser_.path();
+  if (path.empty() || path[0] != '/' || (path.find("//") == StringPiece::npos && path.find("/.") == StringPiece::npos)) {
+    req_.setPath(path);
+  } else {
+    std::string normalized;
+    if (!NormalizePath(path, &normalized)) {
+      return false;
+    }
+    req_.setPath(normalized);
+  }
+  req_.setQuery(parser_.query());
+  req_.setVersion(parser_.version());
+  req_.setReceiveTime(recv_time);
+  for (size_t i = 0; i < parser_.headerCount(); ++i) {
+    req_.AddHeader(parser_.headerName(i), parser_.headerValue(i));
   }
+  return true;
+}
+
+bool HttpContext::Fail(int code) {
+  error_code_ = code;
   return false;
 }
 
-void HttpContext::ParseHeaders(const std::string &line) {
-  LogDebug("ParseHeaders: {}", line);
-  std::regex pattern("^([^:]*): ?(.*)$");
-  std::smatch match;
-  if (std::regex_match(line, match, pattern)) {
-    req_.AddHeader(match[1].str(), match[2].str());
-  } else {
-    state_ = kExpectBody;
+bool HttpContext::StartBody(Buffer *buffer) {
+  // 1.确定分帧方式，同时出现Transfer-Encoding和Content-Length视为请求走私
+  StringPiece te = req_.getHeader("Transfer-Encoding");
+  StringPiece cl = req_.getHeader("Content-Length");
+  framing_ = kNoBody;
+  body_remaining_ = 0;
+  if (!te.empty()) {
+    if (!cl.empty()) {
+      return Fail(400);
+    }
+    if (!te.EqualsIgnoreCase("chunked")) {
+      return Fail(501);
+    }
+    framing_ = kChunked;
+    chunk_state_ = kChunkSize;
+  } else if (!cl.empty()) {
+    for (size_t i = 0; i < cl.size(); ++i) {
+      if (cl[i] < '0' || cl[i] > '9' || body_remaining_ > (std::numeric_limits<size_t>::max() - 9) / 10) {
+        return Fail(400);
+      }
+      body_remaining_ = body_remaining_ * 10 + (cl[i] - '0');
+    }
+    framing_ = (body_remaining_ > 0) ? kContentLength : kNoBody;
+  }
+  if (framing_ == kNoBody) {
+    return true;
   }
-}
 
-void HttpContext::ParseBody(const std::string &line) {
-  LogDebug("ParseBody: {}", line);
-  req_.setBody(line);
-  ParsePosts();
-  state_ = kGotAll;
+  // 2.由处理器决定整体缓存还是流式接收
+  stream_ = body_selector_ ? body_selector_(req_) : nullptr;
+  if (!stream_ && framing_ == kContentLength && body_remaining_ > max_body_size_) {
+    return Fail(413);
+  }
+  expect_continue_ = buffer->ReadableBytes() == request_size_ &&
+                     req_.getHeader("Expect").EqualsIgnoreCase("100-continue");
+
+  // 3.请求体需逐段消费时，先将头部拷贝出来并释放其占用的缓冲区
+  if (stream_ || framing_ == kChunked) {
+    req_.Detach(buffer->peek(), request_size_);
+    buffer->Retrieve(request_size_);
+    request_size_ = 0;
+  } else if (buffer->ReadableBytes() < request_size_ + body_remaining_) {
+    // 4.请求体尚未到齐，后续读入可能搬移缓冲区，头部视图须改为指向拷贝
+    req_.Detach(buffer->peek(), request_size_);
+  }
+  return true;
 }
 
-void HttpContext::ParsePosts() {
-  // 1.解析post相关信息
-  if (std::string(req_.methodString()) != "POST" || req_.getHeader("Content-Type") != "application/x-www-form-urlencoded") {
-    LogDebug("No post data.");
-    LogDebug("method:{}, Content-Type:{}.", req_.methodString(), req_.getHeader("Content-Type"));
-    return;
+bool HttpContext::DeliverBody(const char *data, size_t len) {
+  if (stream_) {
+    return (*stream_)(req_, StringPiece(data, len)) ? true : Fail(500);
   }
-  std::string body = req_.body();
-  LogInfo("body: {}", body);
-  if (body.empty()) {
-    return;
+  if (len > 0) {
+    req_.AppendBody(data, len);
   }
-  std::string key, value;
-  int num = 0;
-  int n = body.size();
-  int i = 0, j = 0;
-  for (; i < n; ++i) {
-    char ch = body[i];
-    switch (ch) {
-      case '=': {
-        key = body.substr(j, i - j);
-        j = i + 1;
-        break;
+  return true;
+}
+
+bool HttpContext::ParseBody(Buffer *buffer) {
+  if (framing_ == kContentLength && stream_) {
+    // 1.流式接收：已到达的数据直接交给处理器后释放
+    size_t n = std::min(buffer->ReadableBytes(), body_remaining_);
+    if (n > 0) {
+      if (!DeliverBody(buffer->peek(), n)) {
+        return false;
       }
-      case '+': {
-        body[i] = ' ';
+      buffer->Retrieve(n);
+      body_remaining_ -= n;
+    }
+    if (body_remaining_ > 0) {
+      return true;
+    }
+    if (!DeliverBody(nullptr, 0)) {
+      return false;
+    }
+  } else if (framing_ == kContentLength) {
+    // 2.整体缓存：等待请求体全部到达，请求体直接引用缓冲区数据
+    size_t total = request_size_ + body_remaining_;
+    if (buffer->ReadableBytes() < total) {
+      return true;
+    }
+    req_.setBody(StringPiece(buffer->peek() + request_size_, body_remaining_));
+    request_size_ = total;
+    body_remaining_ = 0;
+  } else if (framing_ == kChunked) {
+    if (!ParseChunked(buffer)) {
+      return false;
+    }
+    if (chunk_state_ != kChunkDone) {
+      return true;
+    }
+  }
+  if (!stream_) {
+    ParsePosts();
+  }
+  state_ = kGotAll;
+  return true;
+}
+
+bool HttpContext::ParseChunked(Buffer *buffer) {
+  while (chunk_state_ != kChunkDone) {
+    const char *begin = buffer->peek();
+    const char *end = buffer->beginWrite();
+    switch (chunk_state_) {
+      case kChunkSize: {
+        // 1.十六进制的chunk长度，忽略chunk扩展
+        const char *crlf = ByteScan::FindCRLF(begin, end);
+        if (crlf == end) {
+          return static_cast<size_t>(end - begin) > kMaxChunkLine ? Fail(400) : true;
+        }
+        size_t size = 0;
+        const char *p = begin;
+        for (; p < crlf && HexValue(*p) >= 0; ++p) {
+          if (size > (std::numeric_limits<size_t>::max() >> 4)) {
+            return Fail(400);
+          }
+          size = size * 16 + HexValue(*p);
+        }
+        if (p == begin || (p < crlf && *p != ';' && *p != ' ' && *p != '\t')) {
+          return Fail(400);
+        }
+        buffer->Retrieve(crlf + 2 - begin);
+        if (size == 0) {
+          chunk_state_ = kChunkTrailer;
+        } else {
+          if (!stream_ && req_.body().size() + size > max_body_size_) {
+            return Fail(413);
+          }
+          body_remaining_ = size;
+          chunk_state_ = kChunkData;
+        }
         break;
       }
-      case '%': {
-        num = ConverHex(body[i + 1]) * 16 + ConverHex(body[i + 2]);
-        body[i + 2] = num % 10 + '0';
-        body[i + 1] = (num / 10) + '0';
-        i += 2;
+      case kChunkData: {
+        size_t n = std::min(buffer->ReadableBytes(), body_remaining_);
+        if (n == 0) {
+          return true;
+        }
+        if (!DeliverBody(begin, n)) {
+          return false;
+        }
+        buffer->Retrieve(n);
+        body_remaining_ -= n;
+        if (body_remaining_ == 0) {
+          chunk_state_ = kChunkDataCRLF;
+        }
         break;
       }
-      case '&': {
-        value = body.substr(j, i - j);
-        j = i + 1;
-        req_.AddPost(key, value);
-        LogDebug("key: {}, value: {}", key, value);
+      case kChunkDataCRLF: {
+        if (end - begin < 2) {
+          return true;
+        }
+        if (begin[0] != '\r' || begin[1] != '\n') {
+          return Fail(400);
+        }
+        buffer->Retrieve(2);
+        chunk_state_ = kChunkSize;
         break;
       }
-      default: {
+      case kChunkTrailer: {
+        // 2.忽略trailer字段直到空行
+        const char *crlf = ByteScan::FindCRLF(begin, end);
+        if (crlf == end) {
+          return static_cast<size_t>(end - begin) > kMaxChunkLine ? Fail(400) : true;
+        }
+        bool last = (crlf == begin);
+        buffer->Retrieve(crlf + 2 - begin);
+        if (last) {
+          if (!DeliverBody(nullptr, 0)) {
+            return false;
+          }
+          chunk_state_ = kChunkDone;
+        }
         break;
       }
-    }  
-  }
-  assert(j <= i);
-  if (req_.posts().count(key) == 0 && j < i) { 
-    value = body.substr(j, i - j);
-    req_.AddPost(key, value);
-  }
-
-  // 2.解析登录和注册信息
-  if (DefaultHtmlTag.count(req_.path())) {
-    std::string username = req_.getPost("username");
-    std::string password = req_.getPost("password");
-    LogInfo("username: {}, password: {}", username, password);
-    int tag = DefaultHtmlTag.at(req_.path());
-    bool is_login = (tag == 1);
-    if (Verify(username, password, is_login)) {
-      req_.setPath("/welcome.html");
-    } else {
-      if (is_login) {
-        req_.setPath("/login.html");
-      } else {
-        req_.setPath("/register.html");
-      }
+      default:
+        return Fail(400);
     }
   }
+  return true;
 }
 
-void HttpContext::ParsePath() {
-  std::string path = req_.path();
-  if (path == "/") {
-    path = "/index.html";
-  } else {
-    if (DefaultHtml.find(path) != DefaultHtml.end()) {
-      path += ".html";
+void HttpContext::ParsePosts() {
+  // 解析application/x-www-form-urlencoded表单，路由处理函数通过getPost读取
+  if (std::string(req_.methodString()) != "POST" || req_.getHeader("Content-Type") != "application/x-www-form-urlencoded") {
+    LogDebug("No post data.");
+    LogDebug("method:{}, Content-Type:{}.", req_.methodString(), req_.getHeader("Content-Type").ToString());
+    return;
+  }
+  const StringPiece &body = req_.body();
+  LogDebug("body size: {}", body.size());
+  std::string key, value;
+  const char *p = body.data();
+  const char *end = p + body.size();
+  while (p < end) {
+    // 以'&'分隔键值对，以'='分隔键和值
+    const char *amp = ByteScan::FindByte(p, end, '&');
+    const char *eq = ByteScan::FindByte(p, amp, '=');
+    UrlDecode(p, eq, &key);
+    UrlDecode(eq == amp ? amp : eq + 1, amp, &value);
+    if (!key.empty()) {
+      LogDebug("key: {}, value: {}", key, value);
+      req_.AddPost(key, value);
+    }
+    if (amp == end) {
+      break;
     }
+    p = amp + 1;
   }
-  req_.setPath(path);
 }
 
-
 bool HttpContext::ParseRequest(Buffer *buffer, Timestamp recv_time) {
-  LogInfo("buffer: {}.", std::string(buffer->peek(), buffer->ReadableBytes()));
-  if (buffer->ReadableBytes() <= 0) {
-    return false;
-  }
-  while (buffer->ReadableBytes() > 0 && state_ != kGotAll) {
-    const char *crlf = buffer->FindCRLF();
-    std::string line(buffer->peek(), crlf);
-    switch (state_) {
-      case kExpectRequestLine:
-        if (!ParseRequestLine(line)) {
-          return false;
-        }
-        ParsePath();
-        break;
-      case kExpectHeaders:
-        ParseHeaders(line);
-        if (buffer->ReadableBytes() <= 2) {
-          state_ = kGotAll;
-        }
-        break;
-      case kExpectBody:
-        ParseBody(line);
-        break;
-      default:
-        break;
+  if (state_ == kExpectRequestLine || state_ == kExpectHeaders) {
+    // 1.解析请求行及头部，数据不完整时保留在缓冲区中等待后续数据
+    HttpParser::Status status = parser_.Parse(buffer->peek(), buffer->ReadableBytes());
+    if (status == HttpParser::kError) {
+      return false;
     }
-    if (crlf == buffer->beginWrite()) {
-      break;
+    if (status == HttpParser::kNeedMore) {
+      state_ = (parser_.headSize() > 0) ? kExpectHeaders : kExpectRequestLine;
+      return true;
+    }
+    if (!FillRequest(recv_time)) {
+      return Fail(400);
+    }
+    request_size_ = parser_.headSize();
+    state_ = kExpectBody;
+    if (!StartBody(buffer)) {
+      return false;
+    }
+  }
+  if (state_ == kExpectBody) {
+    // 2.按Content-Length或chunked分帧解析请求体
+    if (!ParseBody(buffer)) {
+      return false;
+    }
+    if (state_ != kGotAll) {
+      return true;
     }
-    buffer->RetrieveUtil(crlf + 2);
   }
   LogDebug("[{}], [{}], [{}]", req_.methodString(), req_.path(), req_.version());
   return true;
@@ -8,11 +8,24 @@
 
 #include "Api.h"
 #include "Http/HttpRequest.h"
+#include "Http/HttpParser.h"
+#include "Http/HttpPipeline.h"
+#include "Core/TimerQueue.h"
+#include <functional>
 
 NAMESPACE_BEGIN
 class Buffer;
 class API HttpContext {
 public:
+  /// @brief 流式接收请求体，每收到一段数据回调一次，数据直接指向接收缓冲区，
+  /// 回调返回后即被释放；请求体结束时以空数据回调一次。返回false时中止请求(500)
+  using BodyCallback = std::function<bool(const HttpRequest &, const StringPiece &)>;
+  /// @brief 头部解析完成后选择请求体的接收方式，返回nullptr表示整体缓存
+  using BodySelector = std::function<const BodyCallback *(const HttpRequest &)>;
+
+  /// @brief 整体缓存的请求体默认上限
+  static const size_t kDefaultMaxBodySize = 1024 * 1024;
+
   enum HttpRequestParseState {
     kExpectRequestLine,
     kExpectHeaders,
@@ -30,9 +43,72 @@ public:
 
   void Reset() {
     state_ = kExpectRequestLine;
+    request_size_ = 0;
+    framing_ = kNoBody;
+    body_remaining_ = 0;
+    chunk_state_ = kChunkSize;
+    stream_ = nullptr;
+    error_code_ = 400;
+    expect_continue_ = false;
+    parser_.Reset();
     req_.Reset();
   }
 
+  /// @brief 整体缓存的请求体上限，超出时回复413
+  void setMaxBodySize(size_t max_size) {
+    max_body_size_ = max_size;
+  }
+
+  void setBodySelector(const BodySelector &selector) {
+    body_selector_ = selector;
+  }
+
+  /// @brief ParseRequest失败时应回复的状态码
+  int errorCode() const {
+    return error_code_;
+  }
+
+  /// @brief 客户端携带Expect: 100-continue且正在等待请求体，取出后清除标记
+  bool TakeContinue() {
+    bool expect = expect_continue_;
+    expect_continue_ = false;
+    return expect;
+  }
+
+  /// @brief 当前请求在缓冲区中占用的字节数，请求处理完毕后由调用方Retrieve
+  size_t requestSize() const {
+    return request_size_;
+  }
+
+  /// @brief 该连接上等待按序发送的响应
+  HttpPipeline &pipeline() {
+    return pipeline_;
+  }
+
+  /// @brief 记录该连接上的一个新请求，Reset时不清零
+  /// @return 包括该请求在内已接收的请求数
+  int CountRequest() {
+    return ++requests_;
+  }
+
+  /// @brief 最近一次收到数据的时间，用于长连接的空闲超时
+  Timestamp lastActive() const {
+    return last_active_;
+  }
+
+  void setLastActive(Timestamp time) {
+    last_active_ = time;
+  }
+
+  /// @brief 空闲超时定时器，连接关闭时取消
+  TimerQueue::TimerId idleTimer() const {
+    return idle_timer_;
+  }
+
+  void setIdleTimer(TimerQueue::TimerId id) {
+    idle_timer_ = id;
+  }
+
   const HttpRequest &request() const {
     return req_;
   }
@@ -42,15 +118,51 @@ public:
   }
 
 private:
-  bool ParseRequestLine(const std::string &line);
-  void ParseHeaders(const std::string &line);
-  void ParseBody(const std::string &line);
+  /// @brief 请求体的分帧方式
+  enum BodyFraming {
+    kNoBody,
+    kContentLength,
+    kChunked,
+  };
+
+  /// @brief chunked编码的解析状态
+  enum ChunkState {
+    kChunkSize,
+    kChunkData,
+    kChunkDataCRLF,
+    kChunkTrailer,
+    kChunkDone,
+  };
+
+  /// @return 请求路径越过根目录时返回false
+  bool FillRequest(Timestamp recv_time);
+  bool StartBody(Buffer *buffer);
+  bool ParseBody(Buffer *buffer);
+  bool ParseChunked(Buffer *buffer);
+  bool DeliverBody(const char *data, size_t len);
+  bool Fail(int code);
   void ParsePosts();
-  void ParsePath();
 
 private:
   HttpRequestParseState state_;
+  HttpParser parser_;
   HttpRequest req_;
+  size_t request_size_;
+  HttpPipeline pipeline_;
+
+  BodyFraming framing_;
+  /// @brief Content-Length剩余字节数或当前chunk剩余字节数
+  size_t body_remaining_;
+  ChunkState chunk_state_;
+  size_t max_body_size_;
+  /// @brief 非空表示当前请求以流式方式接收请求体
+  const BodyCallback *stream_;
+  BodySelector body_selector_;
+  int error_code_;
+  bool expect_continue_;
+  int requests_;
+  Timestamp last_active_;
+  TimerQueue::TimerId idle_timer_;
 };
 
 NAMESPACE_END
@@ -0,0 +1,189 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-30 10:12:53
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpHeaderWriter
+ */
+#include "Http/HttpHeaderWriter.h"
+#include "Base/Buffer.h"
+#include "Base/Timestamp.h"
+#include <string.h>
+
+NAMESPACE_BEGIN
+namespace {
+struct Status {
+  int code;
+  StringPiece message;
+  StringPiece line;
+};
+
+const Status kStatus[] = {
+  { 200, "OK",                    "HTTP/1.1 200 OK\r\n" },
+  { 206, "Partial Content",       "HTTP/1.1 206 Partial Content\r\n" },
+  { 304, "Not Modified",          "HTTP/1.1 304 Not Modified\r\n" },
+  { 400, "Bad Request",           "HTTP/1.1 400 Bad Request\r\n" },
+  { 403, "Forbidden",             "HTTP/1.1 403 Forbidden\r\n" },
+  { 404, "Not Found",             "HTTP/1.1 404 Not Found\r\n" },
+  { 405, "Method Not Allowed",    "HTTP/1.1 405 Method Not Allowed\r\n" },
+  { 413, "Payload Too Large",     "HTTP/1.1 413 Payload Too Large\r\n" },
+  { 416, "Range Not Satisfiable", "HTTP/1.1 416 Range Not Satisfiable\r\n" },
+  { 500, "Internal Server Error", "HTTP/1.1 500 Internal Server Error\r\n" },
+  { 501, "Not Implemented",       "HTTP/1.1 501 Not Implemented\r\n" },
+  { 503, "Service Unavailable",   "HTTP/1.1 503 Service Unavailable\r\n" },
+};
+
+struct Mime {
+  StringPiece suffix;
+  StringPiece type;
+  StringPiece line;
+};
+
+const Mime kMimes[] = {
+  { ".html",  "text/html",              "Content-Type: text/html\r\n" },
+  { ".xml",   "text/xml",               "Content-Type: text/xml\r\n" },
+  { ".xhtml", "application/xhtml+xml",  "Content-Type: application/xhtml+xml\r\n" },
+  { ".txt",   "text/plain",             "Content-Type: text/plain\r\n" },
+  { ".rtf",   "application/rtf",        "Content-Type: application/rtf\r\n" },
+  { ".pdf",   "application/pdf",        "Content-Type: application/pdf\r\n" },
+  { ".word",  "application/nsword",     "Content-Type: application/nsword\r\n" },
+  { ".png",   "image/png",              "Content-Type: image/png\r\n" },
+  { ".gif",   "image/gif",              "Content-Type: image/gif\r\n" },
+  { ".jpg",   "image/jpeg",             "Content-Type: image/jpeg\r\n" },
+  { ".jpeg",  "image/jpeg",             "Content-Type: image/jpeg\r\n" },
+  { ".au",    "audio/basic",            "Content-Type: audio/basic\r\n" },
+  { ".mpeg",  "video/mpeg",             "Content-Type: video/mpeg\r\n" },
+  { ".mpg",   "video/mpeg",             "Content-Type: video/mpeg\r\n" },
+  { ".avi",   "video/x-msvideo",        "Content-Type: video/x-msvideo\r\n" },
+  { ".gz",    "application/x-gzip",     "Content-Type: application/x-gzip\r\n" },
+  { ".tar",   "application/x-tar",      "Content-Type: application/x-tar\r\n" },
+  { ".css",   "text/css",               "Content-Type: text/css\r\n" },
+  { ".js",    "text/javascript",        "Content-Type: text/javascript\r\n" },
+};
+
+const Mime kDefaultMime = { "", "text/plain", "Content-Type: text/plain\r\n" };
+
+const char kKeepAlive[] = "Connection: keep-alive\r\n";
+const char kClose[] = "Connection: close\r\n";
+const char kServer[] = "Server: mirror\r\n";
+
+/// @brief 每个IO线程运行一个loop，按线程缓存即按loop缓存
+__thread time_t t_date_seconds = -1;
+__thread char t_date_line[64];
+__thread size_t t_date_len = 0;
+
+const Mime &FindMime(const StringPiece &path) {
+  const char *dot = static_cast<const char *>(memrchr(path.data(), '.', path.size()));
+  if (!dot) {
+    return kDefaultMime;
+  }
+  StringPiece suffix(dot, path.end() - dot);
+  for (const Mime &mime : kMimes) {
+    if (mime.suffix == suffix) {
+      return mime;
+    }
+  }
+  return kDefaultMime;
+}
+
+const Status *FindStatus(int code) {
+  for (const Status &status : kStatus) {
+    if (status.code == code) {
+      return &status;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+StringPiece HttpHeaderWriter::StatusMessage(int code) {
+  const Status *status = FindStatus(code);
+  return status ? status->message : StringPiece();
+}
+
+bool HttpHeaderWriter::StatusLine(int code, Buffer *buffer) {
+  const Status *status = FindStatus(code);
+  if (!status) {
+    return false;
+  }
+  buffer->Append(status->line.data(), status->line.size());
+  return true;
+}
+
+void HttpHeaderWriter::Connection(bool keep_alive, int timeout, int max, Buffer *buffer) {
+  if (!keep_alive) {
+    buffer->Append(kClose, sizeof(kClose) - 1);
+    return;
+  }
+  buffer->Append(kKeepAlive, sizeof(kKeepAlive) - 1);
+  if (timeout <= 0 && max <= 0) {
+    return;
+  }
+  buffer->Append("Keep-Alive: ", 12);
+  if (timeout > 0) {
+    buffer->Append("timeout=", 8);
+    Number(static_cast<size_t>(timeout), buffer);
+  }
+  if (max > 0) {
+    buffer->Append(timeout > 0 ? ", max=" : "max=", timeout > 0 ? 6 : 4);
+    Number(static_cast<size_t>(max), buffer);
+  }
+  buffer->Append("\r\n", 2);
+}
+
+void HttpHeaderWriter::ServerAndDate(Buffer *buffer) {
+  buffer->Append(kServer, sizeof(kServer) - 1);
+  time_t now = time(nullptr);
+  if (now != t_date_seconds) {
+    memcpy(t_date_line, "Date: ", 6);
+    size_t len = 6 + Timestamp::FormatHttpDate(now, t_date_line + 6);
+    memcpy(t_date_line + len, "\r\n", 2);
+    t_date_len = len + 2;
+    t_date_seconds = now;
+  }
+  buffer->Append(t_date_line, t_date_len);
+}
+
+StringPiece HttpHeaderWriter::MimeType(const StringPiece &path) {
+  return FindMime(path).type;
+}
+
+void HttpHeaderWriter::ContentTypeOf(const StringPiece &path, Buffer *buffer) {
+  const Mime &mime = FindMime(path);
+  buffer->Append(mime.line.data(), mime.line.size());
+}
+
+void HttpHeaderWriter::ContentType(const StringPiece &mime, Buffer *buffer) {
+  Header("Content-Type", mime, buffer);
+}
+
+void HttpHeaderWriter::ContentLength(size_t length, Buffer *buffer) {
+  buffer->Append("Content-Length: ", 16);
+  Number(length, buffer);
+  buffer->Append("\r\n", 2);
+}
+
+void HttpHeaderWriter::Header(const StringPiece &name, const StringPiece &value, Buffer *buffer) {
+  buffer->Append(name.data(), name.size());
+  buffer->Append(": ", 2);
+  buffer->Append(value.data(), value.size());
+  buffer->Append("\r\n", 2);
+}
+
+void HttpHeaderWriter::Validators(const StringPiece &etag, time_t last_modified, Buffer *buffer) {
+  Header("ETag", etag, buffer);
+  char date[Timestamp::kHttpDateSize];
+  size_t len = Timestamp::FormatHttpDate(last_modified, date);
+  Header("Last-Modified", StringPiece(date, len), buffer);
+}
+
+void HttpHeaderWriter::Number(size_t value, Buffer *buffer) {
+  char digits[24];
+  char *p = digits + sizeof(digits);
+  do {
+    *--p = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  buffer->Append(p, digits + sizeof(digits) - p);
+}
+
+NAMESPACE_END
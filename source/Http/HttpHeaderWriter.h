@@ -0,0 +1,61 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-30 10:12:45
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpHeaderWriter
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <ctime>
+
+NAMESPACE_BEGIN
+class Buffer;
+/**
+ * @brief 响应头部写入器，所有片段直接追加到输出缓冲区，不产生堆分配。
+ * (1) 状态行、连接头部及Content-Type行均为预先生成的静态字符串；
+ * (2) Date头部每个线程(即每个loop)每秒只格式化一次；
+ * (3) 数字直接格式化到缓冲区的可写区域。
+ */
+class API HttpHeaderWriter {
+public:
+  static const size_t kMaxETagSize = 64;
+
+  /// @brief 状态码对应的原因短语，未知状态码返回空
+  static StringPiece StatusMessage(int code);
+
+  /// @brief 追加状态行，如"HTTP/1.1 200 OK\r\n"
+  /// @return 未知状态码时不写入并返回false
+  static bool StatusLine(int code, Buffer *buffer);
+
+  /// @brief 追加Connection头部，长连接时追加Keep-Alive头部，如"Keep-Alive: timeout=60, max=99"
+  /// @param timeout 空闲超时(秒)，不大于0时省略
+  /// @param max 该连接上还可发送的请求数，不大于0时省略
+  static void Connection(bool keep_alive, int timeout, int max, Buffer *buffer);
+
+  /// @brief 追加Server及当前Date头部
+  static void ServerAndDate(Buffer *buffer);
+
+  /// @brief 根据文件后缀得到MIME类型，指向静态表
+  static StringPiece MimeType(const StringPiece &path);
+
+  /// @brief 按文件后缀追加Content-Type头部
+  static void ContentTypeOf(const StringPiece &path, Buffer *buffer);
+
+  /// @brief 追加指定MIME类型的Content-Type头部
+  static void ContentType(const StringPiece &mime, Buffer *buffer);
+
+  static void ContentLength(size_t length, Buffer *buffer);
+
+  /// @brief 追加"name: value\r\n"
+  static void Header(const StringPiece &name, const StringPiece &value, Buffer *buffer);
+
+  /// @brief 追加ETag及Last-Modified头部
+  static void Validators(const StringPiece &etag, time_t last_modified, Buffer *buffer);
+
+  /// @brief 追加十进制数字
+  static void Number(size_t value, Buffer *buffer);
+};
+
+NAMESPACE_END
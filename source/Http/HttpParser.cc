@@ -0,0 +1,209 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-21 10:40:20
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpParser
+ */
+#include "Http/HttpParser.h"
+#include "Base/ByteScan.h"
+
+NAMESPACE_BEGIN
+HttpParser::HttpParser() :
+  base_(nullptr),
+  state_(kStart),
+  offset_(0),
+  mark_(0) {
+  headers_.reserve(16);
+}
+
+void HttpParser::Reset() {
+  base_ = nullptr;
+  state_ = kStart;
+  offset_ = 0;
+  mark_ = 0;
+  method_ = path_ = query_ = version_ = name_ = Span();
+  headers_.clear();
+}
+
+HttpParser::Status HttpParser::Parse(const char *data, size_t len) {
+  base_ = data;
+  if (state_ == kDone) {
+    return kComplete;
+  }
+  if (state_ == kFailed) {
+    return kError;
+  }
+
+  const char *p = data + offset_;
+  const char *end = data + len;
+  while (p < end) {
+    switch (state_) {
+      case kStart: {
+        // 1.忽略请求前的空行(部分客户端在POST请求体后多发送CRLF)
+        while (p < end && (*p == '\r' || *p == '\n')) {
+          ++p;
+        }
+        mark_ = p - data;
+        if (p < end) {
+          state_ = kMethod;
+        }
+        break;
+      }
+      case kMethod: {
+        const char *q = ByteScan::FindNonToken(p, end);
+        p = q;
+        if (q == end) {
+          break;
+        }
+        if (*q != ' ' || q == data + mark_) {
+          return Fail();
+        }
+        method_ = Span(mark_, q - data - mark_);
+        ++p;
+        mark_ = p - data;
+        state_ = kPath;
+        break;
+      }
+      case kPath: {
+        // 2.请求目标，'?'之后为查询串
+        const char *q = ByteScan::FindUriEnd(p, end, true);
+        p = q;
+        if (q == end) {
+          break;
+        }
+        if (q == data + mark_ || (*q != '?' && *q != ' ')) {
+          return Fail();
+        }
+        path_ = Span(mark_, q - data - mark_);
+        query_ = Span();
+        state_ = (*q == '?') ? kQuery : kVersion;
+        ++p;
+        mark_ = p - data;
+        break;
+      }
+      case kQuery: {
+        const char *q = ByteScan::FindUriEnd(p, end, false);
+        p = q;
+        if (q == end) {
+          break;
+        }
+        if (*q != ' ') {
+          return Fail();
+        }
+        query_ = Span(mark_, q - data - mark_);
+        ++p;
+        mark_ = p - data;
+        state_ = kVersion;
+        break;
+      }
+      case kVersion: {
+        // 3.形如HTTP/1.1，只保存版本号部分
+        const char *q = ByteScan::FindLineEnd(p, end);
+        p = q;
+        if (q == end) {
+          break;
+        }
+        StringPiece ver(data + mark_, q - data - mark_);
+        if (ver.size() < 6 || !ver.StartsWith("HTTP/")) {
+          return Fail();
+        }
+        for (size_t i = 5; i < ver.size(); ++i) {
+          if ((ver[i] < '0' || ver[i] > '9') && ver[i] != '.') {
+            return Fail();
+          }
+        }
+        version_ = Span(mark_ + 5, ver.size() - 5);
+        state_ = (*q == '\r') ? kRequestLineLF : kHeaderStart;
+        ++p;
+        break;
+      }
+      case kRequestLineLF:
+      case kHeaderLF: {
+        if (*p != '\n') {
+          return Fail();
+        }
+        ++p;
+        state_ = kHeaderStart;
+        break;
+      }
+      case kHeaderStart: {
+        // 4.空行表示头部结束
+        if (*p == '\r') {
+          ++p;
+          state_ = kHeadersEndLF;
+        } else if (*p == '\n') {
+          ++p;
+          state_ = kDone;
+          offset_ = p - data;
+          return kComplete;
+        } else {
+          mark_ = p - data;
+          state_ = kHeaderName;
+        }
+        break;
+      }
+      case kHeaderName: {
+        const char *q = ByteScan::FindNonToken(p, end);
+        p = q;
+        if (q == end) {
+          break;
+        }
+        if (*q != ':' || q == data + mark_) {
+          return Fail();
+        }
+        name_ = Span(mark_, q - data - mark_);
+        ++p;
+        state_ = kHeaderValueStart;
+        break;
+      }
+      case kHeaderValueStart: {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+          ++p;
+        }
+        if (p < end) {
+          mark_ = p - data;
+          state_ = kHeaderValue;
+        }
+        break;
+      }
+      case kHeaderValue: {
+        const char *q = ByteScan::FindLineEnd(p, end);
+        p = q;
+        if (q == end) {
+          break;
+        }
+        // 5.去除字段值尾部空白
+        const char *value_end = q;
+        while (value_end > data + mark_ && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+          --value_end;
+        }
+        if (headers_.size() >= kMaxHeaders) {
+          return Fail();
+        }
+        headers_.push_back(std::make_pair(name_, Span(mark_, value_end - data - mark_)));
+        state_ = (*q == '\r') ? kHeaderLF : kHeaderStart;
+        ++p;
+        break;
+      }
+      case kHeadersEndLF: {
+        if (*p != '\n') {
+          return Fail();
+        }
+        ++p;
+        state_ = kDone;
+        offset_ = p - data;
+        return kComplete;
+      }
+      default:
+        return Fail();
+    }
+  }
+
+  offset_ = p - data;
+  if (offset_ > kMaxHeadSize) {
+    return Fail();
+  }
+  return kNeedMore;
+}
+
+NAMESPACE_END
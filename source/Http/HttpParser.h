@@ -0,0 +1,117 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-21 10:40:12
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpParser
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <vector>
+
+NAMESPACE_BEGIN
+/**
+ * @brief 可恢复的Http请求行及头部解析状态机，直接在接收缓冲区上扫描，不拷贝数据。
+ * 每次调用Parse传入从请求起始位置开始的全部可读数据，解析器从上次停止的字节处继续，
+ * 因此请求可在任意字节处被TCP分段截断。内部只记录相对请求起始位置的偏移量，
+ * 缓冲区扩容搬移数据后仍然有效；返回的StringPiece指向最近一次Parse传入的内存，
+ * 在缓冲区被Retrieve或追加写入前有效。
+ */
+class API HttpParser {
+public:
+  enum Status {
+    kNeedMore,    // 数据不完整，等待后续数据
+    kComplete,    // 请求行及头部解析完成
+    kError,       // 请求格式错误
+  };
+
+  /// @brief 请求行及头部总长度上限，超出视为错误，防止恶意客户端无限占用内存
+  static const constexpr size_t kMaxHeadSize = 64 * 1024;
+  /// @brief 头部字段个数上限
+  static const constexpr size_t kMaxHeaders = 100;
+
+  HttpParser();
+
+  /// @brief 解析请求行及头部
+  /// @param data 请求起始地址(缓冲区可读数据起始地址)
+  /// @param len 可读数据长度
+  /// @return 解析状态
+  Status Parse(const char *data, size_t len);
+
+  /// @brief 重置状态，准备解析下一个请求
+  void Reset();
+
+  /// @brief 请求行及头部(含结尾空行)占用的字节数，解析完成后有效
+  size_t headSize() const {
+    return offset_;
+  }
+
+  StringPiece method() const { return View(method_); }
+  StringPiece path() const { return View(path_); }
+  StringPiece query() const { return View(query_); }
+  StringPiece version() const { return View(version_); }
+
+  size_t headerCount() const {
+    return headers_.size();
+  }
+
+  StringPiece headerName(size_t i) const {
+    return View(headers_[i].first);
+  }
+
+  StringPiece headerValue(size_t i) const {
+    return View(headers_[i].second);
+  }
+
+private:
+  enum State {
+    kStart,              // 跳过请求前多余的空行
+    kMethod,
+    kPath,
+    kQuery,
+    kVersion,
+    kRequestLineLF,
+    kHeaderStart,
+    kHeaderName,
+    kHeaderValueStart,
+    kHeaderValue,
+    kHeaderLF,
+    kHeadersEndLF,
+    kDone,
+    kFailed,
+  };
+
+  /// @brief 相对请求起始位置的区间
+  struct Span {
+    Span() : off(0), len(0) {}
+    Span(size_t o, size_t l) : off(o), len(l) {}
+    size_t off;
+    size_t len;
+  };
+
+  StringPiece View(const Span &span) const {
+    return StringPiece(base_ + span.off, span.len);
+  }
+
+  Status Fail() {
+    state_ = kFailed;
+    return kError;
+  }
+
+private:
+  const char *base_;
+  State state_;
+  /// @brief 下一个待扫描字节偏移
+  size_t offset_;
+  /// @brief 当前字段起始偏移
+  size_t mark_;
+  Span method_;
+  Span path_;
+  Span query_;
+  Span version_;
+  Span name_;
+  std::vector<std::pair<Span, Span>> headers_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,109 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-23 10:05:26
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpPipeline
+ */
+#include "Http/HttpPipeline.h"
+#include "Core/TcpConnection.h"
+
+NAMESPACE_BEGIN
+HttpPipeline::HttpPipeline() : next_seq_(0), closing_(false), paused_(false) {
+
+}
+
+size_t HttpPipeline::bytes() const {
+  size_t total = 0;
+  for (const Entry &entry : entries_) {
+    total += entry.head.ReadableBytes();
+    if (entry.response.headOnly()) {
+      continue;
+    }
+    if (entry.response.body()) {
+      total += entry.response.bodySize();
+    }
+    for (const StringPiece &part : entry.response.bodyParts()) {
+      total += part.size();
+    }
+  }
+  return total;
+}
+
+uint64_t HttpPipeline::Push() {
+  uint64_t seq = next_seq_++;
+  entries_.emplace_back(seq);
+  return seq;
+}
+
+HttpPipeline::Entry *HttpPipeline::Find(uint64_t seq) {
+  if (entries_.empty() || seq < entries_.front().seq) {
+    return nullptr;
+  }
+  size_t idx = seq - entries_.front().seq;
+  return idx < entries_.size() ? &entries_[idx] : nullptr;
+}
+
+void HttpPipeline::Complete(uint64_t seq) {
+  Entry *entry = Find(seq);
+  if (entry) {
+    entry->done = true;
+  }
+}
+
+void HttpPipeline::Flush(const TcpConnectionPtr &conn) {
+  // 1.收集队首连续已完成的响应
+  iov_.clear();
+  size_t count = 0;
+  bool close_after = false;
+  for (Entry &entry : entries_) {
+    if (!entry.done) {
+      break;
+    }
+    ++count;
+    if (entry.head.ReadableBytes() > 0) {
+      struct iovec head;
+      head.iov_base = const_cast<char *>(entry.head.peek());
+      head.iov_len = entry.head.ReadableBytes();
+      iov_.push_back(head);
+    }
+    // HEAD响应的Content-Length与GET相同，但不发送响应体
+    if (!entry.response.headOnly()) {
+      if (entry.response.body() && entry.response.bodySize() > 0) {
+        struct iovec body;
+        body.iov_base = const_cast<char *>(entry.response.body());
+        body.iov_len = entry.response.bodySize();
+        iov_.push_back(body);
+      }
+      for (const StringPiece &part : entry.response.bodyParts()) {
+        struct iovec body;
+        body.iov_base = const_cast<char *>(part.data());
+        body.iov_len = part.size();
+        iov_.push_back(body);
+      }
+    }
+    if (entry.close_after) {
+      close_after = true;
+      break;
+    }
+  }
+  if (count == 0) {
+    return;
+  }
+
+  // 2.一次聚集写发出，未写完部分已拷贝进连接发送缓冲区，可立即释放
+  if (!iov_.empty()) {
+    conn->SendV(iov_.data(), static_cast<int>(iov_.size()));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    entries_.pop_front();
+  }
+
+  // 3.非长连接响应发送后半关闭连接，丢弃其后的响应
+  if (close_after) {
+    closing_ = true;
+    entries_.clear();
+    conn->Shutdown();
+  }
+}
+
+NAMESPACE_END
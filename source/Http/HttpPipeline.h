@@ -0,0 +1,87 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-23 10:05:18
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpPipeline
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/Buffer.h"
+#include "Core/Callbacks.h"
+#include "Http/HttpResponse.h"
+#include <deque>
+#include <vector>
+#include <sys/uio.h>
+
+NAMESPACE_BEGIN
+/**
+ * @brief HTTP/1.1管线化响应队列，每个连接一个。
+ * 同一连接上的请求按到达顺序分配序号，响应可以乱序完成(如异步处理器)，
+ * 但只按序号顺序发送：Flush时将队首连续已完成的响应用一次writev聚集写出。
+ */
+class API HttpPipeline {
+public:
+  /// @brief 一个待发送的响应
+  struct Entry {
+    explicit Entry(uint64_t s) : seq(s), done(false), close_after(false) {}
+
+    uint64_t seq;
+    /// @brief 响应是否已生成完毕
+    bool done;
+    /// @brief 发送该响应后关闭连接
+    bool close_after;
+    /// @brief 状态行、头部及内联响应体
+    Buffer head;
+    /// @brief 持有文件映射或缓存的响应体，直接作为聚集写的一段
+    HttpResponse response;
+  };
+
+  HttpPipeline();
+
+  /// @brief 队列中所有响应占用的字节数(头部及内联响应体、映射或缓存的响应体)，
+  /// 这些数据尚未进入连接发送缓冲区，不受其高水位及服务器总量限制
+  size_t bytes() const;
+
+  /// @brief 为新请求追加一个待完成的响应
+  /// @return 响应序号
+  uint64_t Push();
+
+  /// @brief 查找尚未发送的响应
+  /// @return 已发送或连接已关闭时返回nullptr
+  Entry *Find(uint64_t seq);
+
+  /// @brief 标记响应已生成完毕
+  void Complete(uint64_t seq);
+
+  /// @brief 按序发送队首所有已完成的响应
+  void Flush(const TcpConnectionPtr &conn);
+
+  /// @brief 是否已有响应要求关闭连接，之后的请求不再处理
+  bool closing() const {
+    return closing_;
+  }
+
+  /// @brief 等待发送的响应个数
+  size_t size() const {
+    return entries_.size();
+  }
+
+  /// @brief 是否因队列超限暂停了解析及读取
+  bool paused() const {
+    return paused_;
+  }
+
+  void setPaused(bool paused) {
+    paused_ = paused;
+  }
+
+private:
+  std::deque<Entry> entries_;
+  uint64_t next_seq_;
+  bool closing_;
+  bool paused_;
+  std::vector<struct iovec> iov_;
+};
+
+NAMESPACE_END
@@ -0,0 +1,117 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-29 09:40:18
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpRange
+ */
+#include "Http/HttpRange.h"
+#include <algorithm>
+
+NAMESPACE_BEGIN
+static void TrimSpace(StringPiece *str) {
+  while (!str->empty() && ((*str)[0] == ' ' || (*str)[0] == '\t')) {
+    str->RemovePrefix(1);
+  }
+  while (!str->empty() && ((*str)[str->size() - 1] == ' ' || (*str)[str->size() - 1] == '\t')) {
+    str->RemoveSuffix(1);
+  }
+}
+
+/// @brief 解析非负整数，溢出时按最大值处理
+static bool ParseNumber(const StringPiece &str, size_t *value) {
+  if (str.empty()) {
+    return false;
+  }
+  size_t result = 0;
+  for (char ch : str) {
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+    size_t digit = ch - '0';
+    result = result > (static_cast<size_t>(-1) - digit) / 10 ? static_cast<size_t>(-1) : result * 10 + digit;
+  }
+  *value = result;
+  return true;
+}
+
+HttpRange::Result HttpRange::Parse(const StringPiece &range, size_t size, std::vector<ByteRange> *ranges) {
+  ranges->clear();
+  StringPiece specs = range;
+  TrimSpace(&specs);
+  if (specs.size() < 6 || !specs.substr(0, 6).EqualsIgnoreCase("bytes=")) {
+    return kIgnore;
+  }
+  specs.RemovePrefix(6);
+
+  // 1.逐个解析区间，任何一个语法错误则忽略整个头部
+  size_t count = 0;
+  while (!specs.empty()) {
+    size_t comma = specs.find(",");
+    StringPiece spec = specs.substr(0, comma);
+    specs = comma == StringPiece::npos ? StringPiece() : specs.substr(comma + 1);
+    TrimSpace(&spec);
+    if (spec.empty()) {
+      // 允许空元素，如"bytes=0-1,,2-3"
+      continue;
+    }
+    if (++count > kMaxRanges) {
+      return kIgnore;
+    }
+    size_t dash = spec.find("-");
+    if (dash == StringPiece::npos) {
+      return kIgnore;
+    }
+    StringPiece first_str = spec.substr(0, dash);
+    StringPiece last_str = spec.substr(dash + 1);
+    size_t first = 0;
+    size_t last = 0;
+    if (first_str.empty()) {
+      // 后缀区间"-N"：最后N个字节
+      if (!ParseNumber(last_str, &last)) {
+        return kIgnore;
+      }
+      if (last > 0 && size > 0) {
+        size_t length = std::min(last, size);
+        ranges->push_back({ size - length, length });
+      }
+      continue;
+    }
+    if (!ParseNumber(first_str, &first)) {
+      return kIgnore;
+    }
+    if (last_str.empty()) {
+      last = static_cast<size_t>(-1);
+    } else if (!ParseNumber(last_str, &last) || last < first) {
+      return kIgnore;
+    }
+    if (first < size) {
+      last = std::min(last, size - 1);
+      ranges->push_back({ first, last - first + 1 });
+    }
+  }
+  if (count == 0) {
+    return kIgnore;
+  }
+  if (ranges->empty()) {
+    return kUnsatisfiable;
+  }
+
+  // 2.排序并合并重叠或相邻的区间
+  std::sort(ranges->begin(), ranges->end(), [](const ByteRange &a, const ByteRange &b) {
+    return a.offset < b.offset;
+  });
+  size_t n = 0;
+  for (size_t i = 1; i < ranges->size(); ++i) {
+    ByteRange &prev = (*ranges)[n];
+    const ByteRange &cur = (*ranges)[i];
+    if (cur.offset <= prev.offset + prev.length) {
+      prev.length = std::max(prev.offset + prev.length, cur.offset + cur.length) - prev.offset;
+    } else {
+      (*ranges)[++n] = cur;
+    }
+  }
+  ranges->resize(n + 1);
+  return kSatisfiable;
+}
+
+NAMESPACE_END
@@ -0,0 +1,42 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-29 09:40:11
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpRange
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include <vector>
+
+NAMESPACE_BEGIN
+/**
+ * @brief Range请求头部解析(RFC 7233)，只支持bytes单位。
+ * 区间按起始位置排序，重叠或相邻的区间合并为一个。
+ */
+class API HttpRange {
+public:
+  struct ByteRange {
+    size_t offset;
+    size_t length;
+  };
+
+  enum Result {
+    /// @brief 非bytes单位、语法错误或区间过多，忽略Range发送完整内容(200)
+    kIgnore,
+    /// @brief 至少一个区间可以满足(206)
+    kSatisfiable,
+    /// @brief 所有区间都超出内容长度(416)
+    kUnsatisfiable,
+  };
+
+  /// @brief 单个请求允许的区间个数上限，防止大量小区间放大响应
+  static const size_t kMaxRanges = 16;
+
+  /// @param range Range头部，如"bytes=0-499,-500"
+  /// @param size 完整内容的长度
+  static Result Parse(const StringPiece &range, size_t size, std::vector<ByteRange> *ranges);
+};
+
+NAMESPACE_END
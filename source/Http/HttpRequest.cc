@@ -8,66 +8,88 @@
 #include "Base/Logger.h"
 
 NAMESPACE_BEGIN
-const std::unordered_map<std::string, HttpRequest::Method> StringToMethod = {
-  {"GET", HttpRequest::kGet},
-  {"POST", HttpRequest::kPost},
-  {"HEAD", HttpRequest::kHead},
-  {"PUT", HttpRequest::kPut},
-  {"DELETE", HttpRequest::kDelete}
+static const char *const kMethodNames[] = {
+  "GET", "POST", "HEAD", "PUT", "DELETE"
 };
 
-const std::unordered_map<HttpRequest::Method, std::string> MethodToString = {
-  {HttpRequest::kGet, "GET"},
-  {HttpRequest::kPost, "POST"},
-  {HttpRequest::kHead, "HEAD"},
-  {HttpRequest::kPut, "PUT"},
-  {HttpRequest::kDelete, "DELETE"}
-};
+HttpRequest::HttpRequest() : method_(kInvalid), version_("Unknown"), param_count_(0) {
 
-HttpRequest::HttpRequest() : method_(kInvalid), version_("Unknown") {
+}
 
+HttpRequest::HttpRequest(const HttpRequest &other) :
+  method_(other.method_),
+  version_(other.version_),
+  path_(other.path_),
+  query_(other.query_),
+  recv_time_(other.recv_time_),
+  headers_(other.headers_),
+  posts_(other.posts_),
+  param_count_(other.param_count_),
+  body_storage_(other.body_.data(), other.body_.size()) {
+  // 1.头部统一拷贝到storage_，预留空间后追加，指针不会失效
+  size_t total = 0;
+  for (const Header &header : headers_) {
+    total += header.first.size() + header.second.size();
+  }
+  storage_.reserve(total);
+  auto copy = [this](StringPiece *piece) {
+    const char *data = storage_.data() + storage_.size();
+    storage_.append(piece->data(), piece->size());
+    piece->set(data, piece->size());
+  };
+  for (Header &header : headers_) {
+    copy(&header.first);
+    copy(&header.second);
+  }
+  body_ = StringPiece(body_storage_);
+
+  // 2.参数名指向路由表，参数值指向path_
+  for (size_t i = 0; i < param_count_; ++i) {
+    params_[i].first = other.params_[i].first;
+    const StringPiece &value = other.params_[i].second;
+    params_[i].second.set(path_.data() + (value.data() - other.path_.data()), value.size());
+  }
 }
 
 HttpRequest::~HttpRequest() = default;
 
-bool HttpRequest::setMethod(const std::string &method_str) {
-  auto iter = StringToMethod.find(method_str);
-  if (iter != StringToMethod.end()) {
-    method_ = iter->second;
-    return true;
-  } else {
-    method_ = kInvalid;
-    return false;
+bool HttpRequest::setMethod(const StringPiece &method_str) {
+  for (int i = kGet; i <= kDelete; ++i) {
+    if (method_str == kMethodNames[i]) {
+      method_ = static_cast<Method>(i);
+      return true;
+    }
   }
+  method_ = kInvalid;
+  return false;
 }
 
 const char *HttpRequest::methodString() const {
-  auto iter = MethodToString.find(method_);
-  if (iter != MethodToString.end()) {
-    return iter->second.data();
-  } else {
-    return "UNKNOWN";
+  if (method_ >= kGet && method_ <= kDelete) {
+    return kMethodNames[method_];
   }
+  return "UNKNOWN";
 }
 
-void HttpRequest::setPath(const std::string &path) {
-  path_ = path;
+void HttpRequest::setPath(const StringPiece &path) {
+  path_.assign(path.data(), path.size());
 }
 
-void HttpRequest::setQuery(const std::string &query) {
-  query_ = query;
+void HttpRequest::setQuery(const StringPiece &query) {
+  query_.assign(query.data(), query.size());
 }
 
-void HttpRequest::AddHeader(const std::string &key, const std::string &value) {
-  headers_[key] = value;
+void HttpRequest::AddHeader(const StringPiece &key, const StringPiece &value) {
+  headers_.push_back(Header(key, value));
 }
 
-const std::string HttpRequest::getHeader(const std::string &field) const {
-  auto iter = headers_.find(field);
-  if (iter != headers_.end()) {
-    return iter->second;
+StringPiece HttpRequest::getHeader(const StringPiece &field) const {
+  for (const Header &header : headers_) {
+    if (header.first.EqualsIgnoreCase(field)) {
+      return header.second;
+    }
   }
-  return "";
+  return StringPiece();
 }
 
 void HttpRequest::AddPost(const std::string &key, const std::string &value) {
@@ -82,6 +104,22 @@ const std::string HttpRequest::getPost(const std::string &field) const {
   return "";
 }
 
+void HttpRequest::setParams(const Param *params, size_t count) {
+  param_count_ = count < kMaxParams ? count : kMaxParams;
+  for (size_t i = 0; i < param_count_; ++i) {
+    params_[i] = params[i];
+  }
+}
+
+StringPiece HttpRequest::param(const StringPiece &name) const {
+  for (size_t i = 0; i < param_count_; ++i) {
+    if (params_[i].first == name) {
+      return params_[i].second;
+    }
+  }
+  return StringPiece();
+}
+
 void HttpRequest::Reset() {
   method_ = kInvalid;
   version_ = "Unknown";
@@ -90,13 +128,58 @@ void HttpRequest::Reset() {
   query_.clear();
   recv_time_ = Timestamp::invalid();
   headers_.clear();
+  posts_.clear();
+  param_count_ = 0;
+  storage_.clear();
+  body_storage_.clear();
+}
+
+void HttpRequest::Detach(const char *begin, size_t len) {
+  storage_.assign(begin, len);
+  const char *end = begin + len;
+  const char *base = storage_.data();
+  auto rebase = [begin, end, base](StringPiece *piece) {
+    if (piece->data() >= begin && piece->data() < end) {
+      piece->set(base + (piece->data() - begin), piece->size());
+    }
+  };
+  for (Header &header : headers_) {
+    rebase(&header.first);
+    rebase(&header.second);
+  }
+  rebase(&body_);
+}
+
+static StringPiece Trim(StringPiece str) {
+  while (!str.empty() && (str[0] == ' ' || str[0] == '\t')) {
+    str.RemovePrefix(1);
+  }
+  while (!str.empty() && (str[str.size() - 1] == ' ' || str[str.size() - 1] == '\t')) {
+    str.RemoveSuffix(1);
+  }
+  return str;
 }
 
 const bool HttpRequest::IsKeepAlive() const {
-  if (getHeader("Connection") == "keep-alive" && version() == "1.1") {
-    return true;
+  // Connection是逗号分隔、不区分大小写的选项列表，如"Keep-Alive, Upgrade"
+  bool close = false;
+  bool keep_alive = false;
+  StringPiece rest = getHeader("Connection");
+  while (!rest.empty()) {
+    size_t comma = rest.find(",");
+    StringPiece token = Trim(rest.substr(0, comma));
+    rest = (comma == StringPiece::npos) ? StringPiece() : rest.substr(comma + 1);
+    close = close || token.EqualsIgnoreCase("close");
+    keep_alive = keep_alive || token.EqualsIgnoreCase("keep-alive");
   }
-  return false;
+  if (close) {
+    return false;
+  }
+  // HTTP/1.1起默认为持久连接，HTTP/1.0须显式携带keep-alive，更早的版本不支持
+  if (version_ == "1.0") {
+    return keep_alive;
+  }
+  return !version_.empty() && version_[0] >= '1';
 }
 
 NAMESPACE_END
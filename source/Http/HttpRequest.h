@@ -8,11 +8,25 @@
 
 #include "Api.h"
 #include "Base/Timestamp.h"
+#include "Base/StringPiece.h"
 #include <unordered_map>
+#include <vector>
 
 NAMESPACE_BEGIN
+/**
+ * @brief Http请求，头部字段以StringPiece形式直接指向接收缓冲区，
+ * 在请求处理完毕、缓冲区Retrieve之前有效
+ */
 class API HttpRequest {
 public:
+  using Header = std::pair<StringPiece, StringPiece>;
+  using HeaderList = std::vector<Header>;
+  /// @brief 路由参数，名称指向路由表，值指向path()
+  using Param = std::pair<StringPiece, StringPiece>;
+
+  /// @brief 单个路由允许的参数个数上限
+  static const size_t kMaxParams = 8;
+
   enum Method {
     kInvalid = -1,
     kGet = 0,
@@ -23,12 +37,16 @@ public:
   };
 
   HttpRequest();
+  /// @brief 深拷贝，头部、请求体及路由参数改为指向副本自身的存储，
+  /// 副本可脱离接收缓冲区使用(如交给工作线程)
+  HttpRequest(const HttpRequest &other);
+  HttpRequest &operator=(const HttpRequest &) = delete;
   ~HttpRequest();
 
   /// @brief 设置版本
   /// @param version 版本
-  void setVersion(const std::string &version) {
-    version_ = version;
+  void setVersion(const StringPiece &version) {
+    version_.assign(version.data(), version.size());
   }
 
   /// @brief 获取版本
@@ -38,10 +56,9 @@ public:
   }
 
   /// @brief 设置请求方法
-  /// @param start 请求方法字符串起始位置
-  /// @param end 请求方法字符串终止位置
+  /// @param method 请求方法字符串
   /// @return 是否设置成功
-  bool setMethod(const std::string &method);
+  bool setMethod(const StringPiece &method);
 
   /// @brief 获取请求方法
   /// @return 请求方法
@@ -54,7 +71,7 @@ public:
   const char *methodString() const;
 
   /// @brief 设置路径
-  void setPath(const std::string &path);
+  void setPath(const StringPiece &path);
 
   /// @brief 获取路径
   /// @return 路径
@@ -62,16 +79,23 @@ public:
     return path_;
   }
 
-  void setBody(const std::string &body) {
+  /// @brief 设置请求体，不拷贝数据(Content-Length请求体直接指向接收缓冲区)
+  void setBody(const StringPiece &body) {
     body_ = body;
   }
 
-  const std::string &body() const {
+  /// @brief 追加请求体数据到请求自身的存储(chunked请求体解码后不连续，须拷贝)
+  void AppendBody(const char *data, size_t len) {
+    body_storage_.append(data, len);
+    body_ = StringPiece(body_storage_);
+  }
+
+  const StringPiece &body() const {
     return body_;
   }
 
   /// @brief 设置请求
-  void setQuery(const std::string &query);
+  void setQuery(const StringPiece &query);
 
   /// @brief 获取请求字符串
   /// @return 请求字符串
@@ -91,13 +115,13 @@ public:
     return recv_time_;
   }
 
-  /// @brief 添加请求头信息
-  void AddHeader(const std::string &key, const std::string &value);
+  /// @brief 添加请求头信息，不拷贝数据
+  void AddHeader(const StringPiece &key, const StringPiece &value);
   
-  /// @brief 获取头信息
+  /// @brief 获取头信息，字段名不区分大小写
   /// @param field 头信息的键
-  /// @return 头信息的值
-  const std::string getHeader(const std::string &field) const;
+  /// @return 头信息的值，不存在时为空
+  StringPiece getHeader(const StringPiece &field) const;
 
   /// @brief 添加post请求信息
   /// @param key 请求的键
@@ -109,9 +133,19 @@ public:
   /// @return 对应值
   const std::string getPost(const std::string &field) const;
 
+  /// @brief 设置路由匹配得到的参数，由HttpRouter调用
+  void setParams(const Param *params, size_t count);
+
+  /// @brief 获取路由参数，如"/user/:id"中的id，不存在时为空
+  StringPiece param(const StringPiece &name) const;
+
+  size_t paramCount() const {
+    return param_count_;
+  }
+
   /// @brief 获取所有存储的头信息
   /// @return 所有存储的头信息
-  const std::unordered_map<std::string, std::string> &headers() const {
+  const HeaderList &headers() const {
     return headers_;
   }
 
@@ -123,17 +157,29 @@ public:
 
   void Reset();
 
+  /// @brief 将[begin, begin + len)内的数据拷贝到请求自身存储，并使指向该区间的
+  /// 头部及请求体视图改为指向拷贝，之后该区间对应的缓冲区即可释放
+  void Detach(const char *begin, size_t len);
+
+  /// @brief 请求是否允许持久连接(RFC 7230 6.3)：Connection含close时否，
+  /// HTTP/1.1默认是，HTTP/1.0须含keep-alive
   const bool IsKeepAlive() const;
 
 private:
   Method method_;
   std::string version_;
   std::string path_;
-  std::string body_;
+  StringPiece body_;
   std::string query_;
   Timestamp recv_time_;
-  std::unordered_map<std::string, std::string> headers_;
+  HeaderList headers_;
   std::unordered_map<std::string, std::string> posts_;
+  Param params_[kMaxParams];
+  size_t param_count_;
+  /// @brief Detach后头部等数据的存储
+  std::string storage_;
+  /// @brief chunked请求体的存储
+  std::string body_storage_;
 };
 
 NAMESPACE_END
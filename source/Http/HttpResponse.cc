@@ -7,41 +7,19 @@
 #include "Http/HttpResponse.h"
 #include "Base/Buffer.h"
 #include "Base/Logger.h"
+#include "Http/Gzip.h"
+#include "Http/HttpRequest.h"
+#include "Http/HttpRange.h"
+#include "Http/HttpHeaderWriter.h"
+#include "Base/Hash.h"
+#include "Base/Timestamp.h"
+#include <atomic>
+#include <stdio.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <unordered_map>
 
 NAMESPACE_BEGIN
-const std::unordered_map<std::string, std::string> SuffixToType = {
-  { ".html",  "text/html" },
-  { ".xml",   "text/xml" },
-  { ".xhtml", "application/xhtml+xml" },
-  { ".txt",   "text/plain" },
-  { ".rtf",   "application/rtf" },
-  { ".pdf",   "application/pdf" },
-  { ".word",  "application/nsword" },
-  { ".png",   "image/png" },
-  { ".gif",   "image/gif" },
-  { ".jpg",   "image/jpeg" },
-  { ".jpeg",  "image/jpeg" },
-  { ".au",    "audio/basic" },
-  { ".mpeg",  "video/mpeg" },
-  { ".mpg",   "video/mpeg" },
-  { ".avi",   "video/x-msvideo" },
-  { ".gz",    "application/x-gzip" },
-  { ".tar",   "application/x-tar" },
-  { ".css",   "text/css "},
-  { ".js",    "text/javascript "},
-};
-
-const std::unordered_map<int, std::string> CodeToMessage = {
-  { 200, "OK" },
-  { 400, "Bad Request" },
-  { 403, "Forbidden" },
-  { 404, "Not Found" },
-  { 405, "Method Not Allowed" },
-};
-
 const std::unordered_map<int, std::string> CodeToPath = {
   { 400, "/400.html" },
   { 403, "/403.html" },
@@ -49,6 +27,10 @@ const std::unordered_map<int, std::string> CodeToPath = {
   { 405, "/405.html" },
 };
 
+StringPiece HttpResponse::StatusMessage(int code) {
+  return HttpHeaderWriter::StatusMessage(code);
+}
+
 HttpResponse::HttpResponse() = default;
 HttpResponse::~HttpResponse() {
   UnmapFile();
@@ -57,46 +39,282 @@ HttpResponse::~HttpResponse() {
 void HttpResponse::Init(const std::string &root_path, const std::string &path, bool is_keep_alive, int code) {
   code_ = code;
   is_keep_alive_ = is_keep_alive;
+  keep_alive_timeout_ = 0;
+  keep_alive_max_ = 0;
+  accept_gzip_ = false;
+  head_only_ = false;
+  if_none_match_.clear();
+  if_modified_since_ = -1;
+  extra_headers_.clear();
+  headers_.clear();
+  range_.clear();
+  if_range_.clear();
   if (mm_file) {
     UnmapFile();
   }
   path_ = path;
   root_path_ = root_path;
   file_stat_ = { 0 };
+  body_owner_.reset();
+  body_ = nullptr;
+  body_size_ = 0;
+  part_heads_.reset();
+  body_parts_.clear();
 }
 
 void HttpResponse::AddStateLine(Buffer *buffer) {
-  std::string code_msg;
-  if (CodeToMessage.find(code_) != CodeToMessage.end()) {
-    code_msg = CodeToMessage.at(code_);
-  } else {
+  if (!HttpHeaderWriter::StatusLine(code_, buffer)) {
     code_ = 400;
-    code_msg = CodeToMessage.at(400);
+    HttpHeaderWriter::StatusLine(code_, buffer);
   }
-  buffer->Append("HTTP/1.1 " + std::to_string(code_) + " " + code_msg + "\r\n");
 }
 
 void HttpResponse::AddHeaders(Buffer *buffer) {
-  buffer->Append("Connection: ");
-  if (is_keep_alive_) {
-    buffer->Append("keep-alive\r\n");
-    buffer->Append("Keep-Alive: timeout=120, max=6\r\n");
-  } else {
-    buffer->Append("close\r\n");
+  HttpHeaderWriter::Connection(is_keep_alive_, keep_alive_timeout_, keep_alive_max_, buffer);
+  HttpHeaderWriter::ServerAndDate(buffer);
+  if ((code_ == 200 || code_ == 206 || code_ == 304) && !extra_headers_.empty()) {
+    buffer->Append(extra_headers_.data(), extra_headers_.size());
+  }
+  buffer->Append(headers_.data(), headers_.size());
+}
+
+void HttpResponse::AddHeader(const StringPiece &field, const StringPiece &value) {
+  headers_.append(field.data(), field.size());
+  headers_.append(": ", 2);
+  headers_.append(value.data(), value.size());
+  headers_.append("\r\n", 2);
+}
+
+void HttpResponse::setConditional(const HttpRequest &req) {
+  if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead) {
+    return;
+  }
+  StringPiece if_none_match = req.getHeader("If-None-Match");
+  if_none_match_.assign(if_none_match.data(), if_none_match.size());
+  StringPiece if_modified_since = req.getHeader("If-Modified-Since");
+  time_t seconds;
+  if (!if_modified_since.empty() && Timestamp::ParseHttpDate(if_modified_since.ToString(), &seconds)) {
+    if_modified_since_ = seconds;
+  }
+  if (req.method() == HttpRequest::kGet) {
+    StringPiece range = req.getHeader("Range");
+    range_.assign(range.data(), range.size());
+    StringPiece if_range = req.getHeader("If-Range");
+    if_range_.assign(if_range.data(), if_range.size());
+  }
+}
+
+/// @brief If-None-Match为逗号分隔的ETag列表或*，GET/HEAD使用弱比较
+static bool MatchETag(StringPiece list, const StringPiece &etag) {
+  while (!list.empty()) {
+    size_t comma = list.find(",");
+    StringPiece tag = list.substr(0, comma);
+    list = comma == StringPiece::npos ? StringPiece() : list.substr(comma + 1);
+    while (!tag.empty() && (tag[0] == ' ' || tag[0] == '\t')) {
+      tag.RemovePrefix(1);
+    }
+    while (!tag.empty() && (tag[tag.size() - 1] == ' ' || tag[tag.size() - 1] == '\t')) {
+      tag.RemoveSuffix(1);
+    }
+    if (tag.StartsWith("W/")) {
+      tag.RemovePrefix(2);
+    }
+    if (tag == "*" || tag == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HttpResponse::NotModified(const StringPiece &etag, time_t last_modified) const {
+  if (!if_none_match_.empty()) {
+    return MatchETag(if_none_match_, etag);
+  }
+  return if_modified_since_ >= 0 && last_modified <= if_modified_since_;
+}
+
+void HttpResponse::MakeNotModified(const StringPiece &etag, time_t last_modified, Buffer *buffer) {
+  code_ = 304;
+  AddStateLine(buffer);
+  AddHeaders(buffer);
+  HttpHeaderWriter::Validators(etag, last_modified, buffer);
+  buffer->Append("\r\n", 2);
+}
+
+/// @brief If-Range为ETag时须强匹配，为日期时须与Last-Modified完全相同
+static bool MatchIfRange(const std::string &if_range, const StringPiece &etag, time_t last_modified) {
+  if (if_range.empty()) {
+    return true;
+  }
+  if (if_range[0] == '"' || if_range.compare(0, 2, "W/") == 0) {
+    return StringPiece(if_range) == etag;
+  }
+  time_t seconds;
+  return Timestamp::ParseHttpDate(if_range, &seconds) && seconds == last_modified;
+}
+
+static void AddContentRange(size_t offset, size_t length, size_t size, Buffer *buffer) {
+  buffer->Append("Content-Range: bytes ");
+  HttpHeaderWriter::Number(offset, buffer);
+  buffer->Append("-", 1);
+  HttpHeaderWriter::Number(offset + length - 1, buffer);
+  buffer->Append("/", 1);
+  HttpHeaderWriter::Number(size, buffer);
+  buffer->Append("\r\n", 2);
+}
+
+/// @brief 分隔符不必保密，只需不与内容冲突，以计数器和时间生成
+static StringPiece MakeBoundary(char *boundary, size_t len) {
+  static std::atomic<uint64_t> counter(0);
+  uint64_t seed[2] = { counter++, static_cast<uint64_t>(Timestamp::Now().microSecondsSinceEpoch()) };
+  int n = snprintf(boundary, len, "%016llx", static_cast<unsigned long long>(Hash::Fnv1a64(seed, sizeof(seed))));
+  return StringPiece(boundary, n);
+}
+
+bool HttpResponse::MakeRange(const char *data, size_t size, const StringPiece &mime,
+                             const StringPiece &etag, time_t last_modified, Buffer *buffer) {
+  if (range_.empty() || !MatchIfRange(if_range_, etag, last_modified)) {
+    return false;
+  }
+  std::vector<HttpRange::ByteRange> ranges;
+  HttpRange::Result result = HttpRange::Parse(range_, size, &ranges);
+  if (result == HttpRange::kIgnore) {
+    return false;
+  }
+  body_ = nullptr;
+  body_size_ = 0;
+  if (result == HttpRange::kUnsatisfiable) {
+    code_ = 416;
+    AddStateLine(buffer);
+    AddHeaders(buffer);
+    buffer->Append("Content-Range: bytes */");
+    HttpHeaderWriter::Number(size, buffer);
+    buffer->Append("\r\nContent-Length: 0\r\n\r\n");
+    return true;
+  }
+
+  code_ = 206;
+  AddStateLine(buffer);
+  AddHeaders(buffer);
+  HttpHeaderWriter::Validators(etag, last_modified, buffer);
+  if (ranges.size() == 1) {
+    // 1.单区间：响应体直接引用内容片段
+    const HttpRange::ByteRange &range = ranges[0];
+    HttpHeaderWriter::ContentType(mime, buffer);
+    AddContentRange(range.offset, range.length, size, buffer);
+    HttpHeaderWriter::ContentLength(range.length, buffer);
+    buffer->Append("\r\n", 2);
+    body_ = data + range.offset;
+    body_size_ = range.length;
+    return true;
+  }
+
+  // 2.多区间：先生成所有分隔头部，再与内容片段交替组成响应体
+  char boundary_buf[24];
+  StringPiece boundary = MakeBoundary(boundary_buf, sizeof(boundary_buf));
+  part_heads_.reset(new Buffer);
+  Buffer &heads = *part_heads_;
+  std::vector<size_t> offsets;
+  size_t length = 0;
+  for (const HttpRange::ByteRange &range : ranges) {
+    offsets.push_back(heads.ReadableBytes());
+    heads.Append("\r\n--", 4);
+    heads.Append(boundary.data(), boundary.size());
+    heads.Append("\r\n", 2);
+    HttpHeaderWriter::ContentType(mime, &heads);
+    AddContentRange(range.offset, range.length, size, &heads);
+    heads.Append("\r\n", 2);
+    length += range.length;
   }
+  offsets.push_back(heads.ReadableBytes());
+  heads.Append("\r\n--", 4);
+  heads.Append(boundary.data(), boundary.size());
+  heads.Append("--\r\n", 4);
+  offsets.push_back(heads.ReadableBytes());
+  length += heads.ReadableBytes();
+  // 分隔头部全部写入后缓冲区不再搬移，片段指针保持有效
+  const char *base = heads.peek();
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    body_parts_.emplace_back(base + offsets[i], offsets[i + 1] - offsets[i]);
+    body_parts_.emplace_back(data + ranges[i].offset, ranges[i].length);
+  }
+  body_parts_.emplace_back(base + offsets[ranges.size()], offsets.back() - offsets[ranges.size()]);
+  buffer->Append("Content-Type: multipart/byteranges; boundary=");
+  buffer->Append(boundary.data(), boundary.size());
+  buffer->Append("\r\n", 2);
+  HttpHeaderWriter::ContentLength(length, buffer);
+  buffer->Append("\r\n", 2);
+  return true;
+}
+
+StringPiece HttpResponse::FormatETag(const struct stat &st, char *buf) {
+  int n = snprintf(buf, HttpHeaderWriter::kMaxETagSize, "\"%lx-%lx-%lx\"", static_cast<unsigned long>(st.st_ino),
+                   static_cast<unsigned long>(st.st_size), static_cast<unsigned long>(st.st_mtime));
+  return StringPiece(buf, n);
 }
 
-void HttpResponse::AddContentType(const std::string &type, Buffer *buffer) {
-  buffer->Append("Content-Type: " + type + "\r\n");
+std::string HttpResponse::MakeETag(const struct stat &st) {
+  char etag[HttpHeaderWriter::kMaxETagSize];
+  return FormatETag(st, etag).ToString();
+}
+
+std::string HttpResponse::MakeETag(const StringPiece &content, bool gzip) {
+  char etag[32];
+  snprintf(etag, sizeof(etag), gzip ? "\"%016llx-gz\"" : "\"%016llx\"",
+           static_cast<unsigned long long>(Hash::Fnv1a64(content.data(), content.size())));
+  return etag;
+}
+
+std::string HttpResponse::ValidatorHeaders(const StringPiece &etag, time_t last_modified) {
+  Buffer buffer(128);
+  HttpHeaderWriter::Validators(etag, last_modified, &buffer);
+  return buffer.RetrieveAllAsString();
 }
 
 void HttpResponse::MakeResponse(const std::string &body, const std::string &type, Buffer *buffer) {
+  if (!buffer) {
+    buffer = output_;
+  }
+  if (code_ == -1) {
+    code_ = 200;
+  }
+  AddStateLine(buffer);
+  AddHeaders(buffer);
+  HttpHeaderWriter::ContentType(type, buffer);
+  if (Gzip::Compressible(type) && body.size() >= Gzip::kMinSize) {
+    buffer->Append("Vary: Accept-Encoding\r\n");
+    Buffer compressed;
+    Gzip::Stream stream;
+    if (accept_gzip_ && stream.Write(body.data(), body.size(), &compressed) && stream.Finish(&compressed)) {
+      buffer->Append("Content-Encoding: gzip\r\n");
+      HttpHeaderWriter::ContentLength(compressed.ReadableBytes(), buffer);
+      buffer->Append("\r\n", 2);
+      if (!head_only_) {
+        buffer->Append(compressed.peek(), compressed.ReadableBytes());
+      }
+      return;
+    }
+  }
+  HttpHeaderWriter::ContentLength(body.size(), buffer);
+  buffer->Append("\r\n", 2);
+  if (!head_only_) {
+    buffer->Append(body);
+  }
+}
+
+void HttpResponse::MakeHead(size_t content_length, Buffer *buffer) {
+  AddStateLine(buffer);
+  AddHeaders(buffer);
+  HttpHeaderWriter::ContentTypeOf(path_, buffer);
+  HttpHeaderWriter::ContentLength(content_length, buffer);
+  buffer->Append("\r\n", 2);
+}
+
+void HttpResponse::MakeHead(const StringPiece &headers, Buffer *buffer) {
   AddStateLine(buffer);
   AddHeaders(buffer);
-  AddContentType(type, buffer);
-  buffer->Append("Content-Length: " + std::to_string(body.size()) + "\r\n");
-  buffer->Append("\r\n");
-  buffer->Append(body);
+  buffer->Append(headers.data(), headers.size());
+  buffer->Append("\r\n", 2);
 }
 
 void HttpResponse::UnmapFile() {
@@ -108,7 +326,8 @@ void HttpResponse::UnmapFile() {
 
 void HttpResponse::MakeResponse(Buffer *buffer) {
   // 1.请求资源文件检查
-  if(stat((root_path_ + path_).data(), &file_stat_) < 0 || S_ISDIR(file_stat_.st_mode)) {
+  std::string full_path = root_path_ + path_;
+  if(stat(full_path.c_str(), &file_stat_) < 0 || S_ISDIR(file_stat_.st_mode)) {
     code_ = 404;
   } else if(!(file_stat_.st_mode & S_IROTH)) {
     code_ = 403;
@@ -116,69 +335,94 @@ void HttpResponse::MakeResponse(Buffer *buffer) {
     code_ = 200; 
   }
 
-  // 2.错误资源文件检查
-  AddErrorHtml();
-
-  // 3.添加相应状态行
-  AddStateLine(buffer);
-
-  // 4.添加头部信息
-  AddHeaders(buffer);
-
-  // 5.添加文件类型
-  AddContentType(getFileType(path_), buffer);
+  // 2.客户端缓存仍有效则回复304，否则检查错误资源文件
+  char etag_buf[HttpHeaderWriter::kMaxETagSize];
+  StringPiece etag;
+  if (code_ == 200) {
+    etag = FormatETag(file_stat_, etag_buf);
+    if (NotModified(etag, file_stat_.st_mtime)) {
+      MakeNotModified(etag, file_stat_.st_mtime, buffer);
+      return;
+    }
+  }
+  if (AddErrorHtml()) {
+    full_path = root_path_ + path_;
+  }
 
-  // 6.添加文件内容
-  LogInfo("add body: {}.", root_path_ + path_);
-  int fd = open((root_path_ + path_).c_str(), O_RDONLY);
+  // 3.映射文件内容
+  LogInfo("add body: {}.", full_path);
+  int fd = open(full_path.c_str(), O_RDONLY);
   if (fd < 0) {
+    AddStateLine(buffer);
+    AddHeaders(buffer);
+    HttpHeaderWriter::ContentTypeOf(path_, buffer);
     AddErrorBody("File not found!", buffer);
     return;
   }
-  void *mm_ret = mmap(0, file_stat_.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-  if (mm_ret == MAP_FAILED) {
-    AddErrorBody("File not found!", buffer);
+  if (file_stat_.st_size > 0) {
+    void *mm_ret = mmap(0, file_stat_.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mm_ret == MAP_FAILED) {
+      AddStateLine(buffer);
+      AddHeaders(buffer);
+      HttpHeaderWriter::ContentTypeOf(path_, buffer);
+      AddErrorBody("File not found!", buffer);
+      return;
+    }
+    mm_file = static_cast<char *>(mm_ret);
+    body_ = mm_file;
+    body_size_ = file_stat_.st_size;
+  } else {
+    close(fd);
+  }
+
+  // 4.区间请求只发送请求的片段，仍然直接引用文件映射
+  if (code_ == 200 && MakeRange(mm_file, file_stat_.st_size, HttpHeaderWriter::MimeType(path_), etag,
+                                file_stat_.st_mtime, buffer)) {
     return;
   }
-  mm_file = static_cast<char *>(mm_ret);
-  close(fd);
-  buffer->Append("Content-Length: " + std::to_string(file_stat_.st_size) + "\r\n\r\n");
-}
 
-void HttpResponse::AddErrorHtml() {
-  if (CodeToPath.find(code_) != CodeToPath.end()) {
-    path_ = CodeToPath.at(code_);
-    stat((root_path_ + path_).data(), &file_stat_);
+  // 5.添加状态行、头部信息及文件类型
+  AddStateLine(buffer);
+  AddHeaders(buffer);
+  HttpHeaderWriter::ContentTypeOf(path_, buffer);
+  if (code_ == 200) {
+    HttpHeaderWriter::Validators(etag, file_stat_.st_mtime, buffer);
+    buffer->Append("Accept-Ranges: bytes\r\n");
   }
+  HttpHeaderWriter::ContentLength(file_stat_.st_size, buffer);
+  buffer->Append("\r\n", 2);
 }
 
-const std::string HttpResponse::getFileType(const std::string &path) const {
-  auto idx = path.find_last_of(".");
-  if (idx == std::string::npos) {
-    return "text/plain";
-  }
-  std::string suffix = path.substr(idx);
-  if (SuffixToType.find(suffix) != SuffixToType.end()) {
-    return SuffixToType.at(suffix);
-  } else {
-    return "text/plain";
+bool HttpResponse::AddErrorHtml() {
+  auto it = CodeToPath.find(code_);
+  if (it == CodeToPath.end()) {
+    return false;
   }
+  path_ = it->second;
+  stat((root_path_ + path_).data(), &file_stat_);
+  return true;
+}
+
+std::string HttpResponse::MimeType(const std::string &path) {
+  return HttpHeaderWriter::MimeType(path).ToString();
 }
 
 void HttpResponse::AddErrorBody(const std::string &err_msg, Buffer *buffer) {
   std::string body = "<html><title>Error</title><body bgcolor=\"ffffff\">";
-  std::string code_msg;
-  if (CodeToMessage.find(code_) != CodeToMessage.end()) {
-    code_msg = CodeToMessage.at(code_);
-  } else {
+  StringPiece code_msg = StatusMessage(code_);
+  if (code_msg.empty()) {
     code_msg = "Bad Request";
   }
-  body += std::to_string(code_) + " : " + code_msg  + "\n";
+  body += std::to_string(code_) + " : " + code_msg.ToString() + "\n";
   body += "<p>" + err_msg + "</p>";
   body += "<hr><em>HttpServer</em></body></html>";
 
-  buffer->Append("Content-length: " + std::to_string(body.size()) + "\r\n\r\n");
-  buffer->Append(body);
+  HttpHeaderWriter::ContentLength(body.size(), buffer);
+  buffer->Append("\r\n", 2);
+  if (!head_only_) {
+    buffer->Append(body);
+  }
 }
 
 NAMESPACE_END
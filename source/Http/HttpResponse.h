@@ -7,22 +7,151 @@
 #pragma once
 
 #include "Api.h"
+#include "Base/StringPiece.h"
+#include <ctime>
 #include <string>
 #include <sys/stat.h>
 #include <unordered_map>
 #include <memory>
+#include <vector>
 
 NAMESPACE_BEGIN
 class Buffer;
+class HttpRequest;
 class API HttpResponse {
 public:
   HttpResponse();
   ~HttpResponse();
 
   void Init(const std::string &root_path, const std::string &path, bool is_keep_alive = false, int code = -1);
+  /// @brief 生成完整的动态响应
+  /// @param buffer 为空时写入setOutput设置的输出缓冲区
   void MakeResponse(const std::string &str, const std::string &type, Buffer *buffer = nullptr);
+
+  /// @brief 路由处理函数生成响应时写入的缓冲区，由HttpServer设置
+  void setOutput(Buffer *buffer) {
+    output_ = buffer;
+  }
+
+  /// @brief 重写要发送的文件路径，路由处理函数未生成响应时由HttpServer按该路径发送文件
+  void setPath(const std::string &path) {
+    path_ = path;
+  }
+
+  const std::string &path() const {
+    return path_;
+  }
+
+  /// @brief 重写文件所在的根目录，用于静态目录挂载
+  void setRoot(const std::string &root_path) {
+    root_path_ = root_path;
+  }
+
+  const std::string &root() const {
+    return root_path_;
+  }
+
+  /// @brief 设置状态码，用于头部由调用方预先生成的响应
+  void setCode(int code) {
+    code_ = code;
+  }
+
+  /// @brief 状态码，尚未确定时为-1
+  int code() const {
+    return code_;
+  }
+
+  /// @brief 客户端是否接受gzip，为真时较大的文本类动态响应体压缩后发送
+  void setAcceptGzip(bool accept) {
+    accept_gzip_ = accept;
+  }
+
+  bool acceptGzip() const {
+    return accept_gzip_;
+  }
+
+  /// @brief HEAD请求只发送头部：Content-Length等与GET相同，不写入也不发送响应体，Init时清除
+  void setHeadOnly(bool head_only) {
+    head_only_ = head_only;
+  }
+
+  bool headOnly() const {
+    return head_only_;
+  }
+
+  bool keepAlive() const {
+    return is_keep_alive_;
+  }
+
+  /// @brief 长连接在Keep-Alive头部中公布的空闲超时(秒)及剩余请求数，Init时清零
+  void setKeepAliveLimits(int timeout, int max) {
+    keep_alive_timeout_ = timeout;
+    keep_alive_max_ = max;
+  }
+
+  int keepAliveTimeout() const {
+    return keep_alive_timeout_;
+  }
+
+  int keepAliveMax() const {
+    return keep_alive_max_;
+  }
   void MakeResponse(Buffer *buffer);
 
+  /// @brief 记录GET/HEAD请求的If-None-Match及If-Modified-Since，供NotModified判断，
+  /// 以及GET请求的Range及If-Range，供MakeRange使用
+  void setConditional(const HttpRequest &req);
+
+  /// @brief 请求是否带有Range头部，此时应发送未压缩的原始表示
+  bool rangeRequested() const {
+    return !range_.empty();
+  }
+
+  /// @brief 按记录的Range生成206(单区间或multipart/byteranges)或416响应，
+  /// 响应体直接引用data中的片段，data须由setBody的owner或文件映射保证有效
+  /// @param data 完整内容
+  /// @return 不是区间请求、If-Range不匹配或Range被忽略时返回false，由调用方发送完整内容
+  bool MakeRange(const char *data, size_t size, const StringPiece &mime,
+                 const StringPiece &etag, time_t last_modified, Buffer *buffer);
+
+  /// @brief 客户端缓存的表示是否仍然有效，If-None-Match存在时忽略If-Modified-Since
+  bool NotModified(const StringPiece &etag, time_t last_modified) const;
+
+  /// @brief 附加头部(如Cache-Control)，以\r\n结尾，只加到200及304响应中，
+  /// headers须在响应生成前保持有效
+  void setExtraHeaders(const StringPiece &headers) {
+    extra_headers_ = headers;
+  }
+
+  /// @brief 附加本响应独有的头部(如Set-Cookie)，加到所有状态码的响应中
+  void AddHeader(const StringPiece &field, const StringPiece &value);
+
+  /// @brief AddHeader累积的头部，每行以\r\n结尾
+  const std::string &headers() const {
+    return headers_;
+  }
+
+  void setHeaders(const std::string &headers) {
+    headers_ = headers;
+  }
+
+  /// @brief 生成状态行及头部(不含响应体)，用于预先构建缓存的响应
+  void MakeHead(size_t content_length, Buffer *buffer);
+
+  /// @brief 生成状态行、连接、Server、Date及附加头部，其余头部由调用方预先生成，
+  /// 最后补充结尾空行
+  void MakeHead(const StringPiece &headers, Buffer *buffer);
+
+  /// @brief 生成无响应体的304响应
+  void MakeNotModified(const StringPiece &etag, time_t last_modified, Buffer *buffer);
+
+  /// @brief 使用外部数据作为响应体(如文件缓存)，owner保证发送完成前数据有效
+  void setBody(const std::shared_ptr<const void> &owner, const char *data, size_t len) {
+    body_owner_ = owner;
+    body_ = data;
+    body_size_ = len;
+  }
+
   char *file() {
     return mm_file;
   }
@@ -31,14 +160,44 @@ public:
     return file_stat_.st_size;
   }
 
+  /// @brief 不在头部缓冲区中的响应体：文件映射、外部数据或其中的一个区间
+  const char *body() const {
+    return body_;
+  }
+
+  size_t bodySize() const {
+    return body_size_;
+  }
+
+  /// @brief multipart/byteranges响应体，各部分的分隔头部与内容片段交替，非空时body()为空
+  const std::vector<StringPiece> &bodyParts() const {
+    return body_parts_;
+  }
+
+  /// @brief 根据文件后缀得到MIME类型
+  static std::string MimeType(const std::string &path);
+
+  /// @brief 状态码对应的原因短语，未知状态码返回空串
+  static StringPiece StatusMessage(int code);
+
+  /// @brief 由inode、大小及修改时间生成强ETag，文件未缓存时使用
+  static std::string MakeETag(const struct stat &st);
+  /// @param buf 至少HttpHeaderWriter::kMaxETagSize字节
+  static StringPiece FormatETag(const struct stat &st, char *buf);
+
+  /// @brief 由内容哈希生成强ETag，gzip版本附加后缀以区别于原始表示
+  static std::string MakeETag(const StringPiece &content, bool gzip = false);
+
+  /// @brief 生成ETag及Last-Modified头部
+  static std::string ValidatorHeaders(const StringPiece &etag, time_t last_modified);
+
 private:
   void AddStateLine(Buffer *buffer);
   void AddHeaders(Buffer *buffer);
 
-  void AddErrorHtml();
-  const std::string getFileType(const std::string &path) const;
+  /// @return 是否替换为错误页面
+  bool AddErrorHtml();
   void AddErrorBody(const std::string &err_msg, Buffer *buffer);
-  void AddContentType(const std::string &type, Buffer *buffer);
 
   void UnmapFile();
 
@@ -46,9 +205,26 @@ private:
   std::string root_path_ {};
   std::string path_ {};
   int code_ {-1};
+  Buffer *output_ {nullptr};
   bool is_keep_alive_ {false};
+  int keep_alive_timeout_ {0};
+  int keep_alive_max_ {0};
+  bool accept_gzip_ {false};
+  bool head_only_ {false};
+  std::string if_none_match_ {};
+  time_t if_modified_since_ {-1};
+  StringPiece extra_headers_ {};
+  std::string headers_ {};
+  std::string range_ {};
+  std::string if_range_ {};
   char *mm_file {nullptr};
   struct stat file_stat_{0};
+  std::shared_ptr<const void> body_owner_ {};
+  const char *body_ {nullptr};
+  size_t body_size_ {0};
+  /// @brief 多区间响应的分隔头部，只在需要时创建
+  std::unique_ptr<Buffer> part_heads_ {};
+  std::vector<StringPiece> body_parts_ {};
 };
 
 NAMESPACE_END
@@ -0,0 +1,177 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-31 09:26:22
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpRouter
+ */
+#include "Http/HttpRouter.h"
+#include "Base/Logger.h"
+#include <algorithm>
+#include <string.h>
+
+NAMESPACE_BEGIN
+HttpRouter::HttpRouter() : root_(new Node), size_(0) {
+
+}
+
+HttpRouter::~HttpRouter() = default;
+
+HttpRouter::Node *HttpRouter::InsertStatic(Node *node, StringPiece literal) {
+  while (!literal.empty()) {
+    size_t index = node->indices.find(literal[0]);
+    if (index == std::string::npos) {
+      std::unique_ptr<Node> child(new Node);
+      child->label.assign(literal.data(), literal.size());
+      node->indices.push_back(literal[0]);
+      node->children.push_back(std::move(child));
+      return node->children.back().get();
+    }
+    Node *child = node->children[index].get();
+    // 1.求与已有边的公共前缀
+    size_t common = 0;
+    size_t limit = std::min(child->label.size(), literal.size());
+    while (common < limit && child->label[common] == literal[common]) {
+      ++common;
+    }
+    // 2.只匹配了边的一部分，在公共前缀处拆分
+    if (common < child->label.size()) {
+      std::unique_ptr<Node> split(new Node);
+      split->label = child->label.substr(0, common);
+      child->label.erase(0, common);
+      split->indices.push_back(child->label[0]);
+      split->children.push_back(std::move(node->children[index]));
+      node->children[index] = std::move(split);
+      child = node->children[index].get();
+    }
+    node = child;
+    literal.RemovePrefix(common);
+  }
+  return node;
+}
+
+bool HttpRouter::Add(HttpRequest::Method method, const std::string &pattern, const Handler &handler,
+                     bool blocking) {
+  if (method < HttpRequest::kGet || method >= kMethods || pattern.empty() || pattern[0] != '/' || !handler) {
+    LogError("Invalid route [{}].", pattern);
+    return false;
+  }
+  Node *node = root_.get();
+  StringPiece rest(pattern);
+  size_t params = 0;
+  while (!rest.empty()) {
+    if (rest[0] == ':' || rest[0] == '*') {
+      // 参数名到下一个'/'为止，通配片段须位于末尾
+      bool catch_all = rest[0] == '*';
+      const char *slash = static_cast<const char *>(memchr(rest.data(), '/', rest.size()));
+      size_t len = slash ? slash - rest.data() : rest.size();
+      std::string name(rest.data() + 1, len - 1);
+      if (name.empty() || (catch_all && slash) || ++params > HttpRequest::kMaxParams) {
+        LogError("Invalid route [{}].", pattern);
+        return false;
+      }
+      std::unique_ptr<Node> &child = catch_all ? node->catch_all : node->param;
+      if (!child) {
+        child.reset(new Node);
+        child->type = catch_all ? kCatchAll : kParam;
+        child->label = name;
+      } else if (child->label != name) {
+        LogError("Route [{}] conflicts with parameter [{}].", pattern, child->label);
+        return false;
+      }
+      node = child.get();
+      rest.RemovePrefix(len);
+      continue;
+    }
+    size_t len = 0;
+    while (len < rest.size() && rest[len] != ':' && rest[len] != '*') {
+      ++len;
+    }
+    node = InsertStatic(node, rest.substr(0, len));
+    rest.RemovePrefix(len);
+  }
+  Route &route = node->routes[method];
+  if (route.handler) {
+    LogError("Duplicate route [{} {}].", method, pattern);
+    return false;
+  }
+  route.handler = handler;
+  route.blocking = blocking;
+  node->has_handler = true;
+  ++size_;
+  return true;
+}
+
+const HttpRouter::Node *HttpRouter::Match(const Node *node, StringPiece path, int method,
+                                          HttpRequest::Param *params, size_t *count) {
+  // 1.静态子节点优先，按首字节直接定位唯一的候选边
+  if (!path.empty()) {
+    size_t index = node->indices.find(path[0]);
+    if (index != std::string::npos) {
+      const Node *child = node->children[index].get();
+      if (path.StartsWith(child->label)) {
+        StringPiece rest = path.substr(child->label.size());
+        const Node *found = rest.empty() && child->Accepts(method)
+                              ? child : Match(child, rest, method, params, count);
+        if (found) {
+          return found;
+        }
+      }
+    }
+  }
+
+  // 2.参数节点匹配到下一个'/'，值不能为空
+  if (node->param && !path.empty() && path[0] != '/') {
+    const char *slash = static_cast<const char *>(memchr(path.data(), '/', path.size()));
+    size_t len = slash ? slash - path.data() : path.size();
+    const Node *child = node->param.get();
+    size_t saved = *count;
+    params[(*count)++] = HttpRequest::Param(child->label, path.substr(0, len));
+    StringPiece rest = path.substr(len);
+    const Node *found = rest.empty() && child->Accepts(method)
+                          ? child : Match(child, rest, method, params, count);
+    if (found) {
+      return found;
+    }
+    *count = saved;
+  }
+
+  // 3.通配节点匹配剩余全部路径(可以为空)
+  if (node->catch_all) {
+    const Node *child = node->catch_all.get();
+    if (child->Accepts(method)) {
+      params[(*count)++] = HttpRequest::Param(child->label, path);
+      return child;
+    }
+  }
+  return nullptr;
+}
+
+const HttpRouter::Route *HttpRouter::Find(HttpRequest::Method method, const StringPiece &path,
+                                          HttpRequest *req, bool *path_matched) const {
+  HttpRequest::Param params[HttpRequest::kMaxParams];
+  size_t count = 0;
+  if (path_matched) {
+    *path_matched = false;
+  }
+  if (method < HttpRequest::kGet || method >= kMethods || size_ == 0) {
+    return nullptr;
+  }
+  const Node *node = Match(root_.get(), path, method, params, &count);
+  if (!node) {
+    if (path_matched) {
+      count = 0;
+      *path_matched = Match(root_.get(), path, -1, params, &count) != nullptr;
+    }
+    return nullptr;
+  }
+  if (req) {
+    req->setParams(params, count);
+  }
+  const Route *route = &node->routes[method];
+  if (!route->handler) {
+    route = &node->routes[HttpRequest::kGet];
+  }
+  return route;
+}
+
+NAMESPACE_END
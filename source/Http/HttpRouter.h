@@ -0,0 +1,104 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-31 09:26:14
+ * @Contact: 2458006466@qq.com
+ * @Description: HttpRouter
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/StringPiece.h"
+#include "Http/HttpRequest.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN
+class HttpResponse;
+/**
+ * @brief 基于压缩前缀树(radix tree)的路由表，按方法及路径分发请求。
+ * (1) 静态片段："/user/list"，公共前缀合并为一条边，子节点按首字节索引；
+ * (2) 参数片段：":name"匹配到下一个'/'为止，如"/user/:id/posts"；
+ * (3) 通配片段："*name"匹配剩余全部路径，只能位于末尾，如挂载在"/static"下的"*filepath"。
+ * 匹配优先级为静态 > 参数 > 通配，查找只遍历路径一次(回溯只发生在静态与参数冲突处)，
+ * 参数直接指向请求路径，查找过程不产生堆分配。路由须在服务启动前注册完毕。
+ */
+class API HttpRouter {
+public:
+  using Handler = std::function<void(const HttpRequest &, HttpResponse *)>;
+
+  struct Route {
+    Handler handler;
+    /// @brief 处理函数会阻塞(如同步访问数据库)，须在工作线程中执行
+    bool blocking {false};
+  };
+
+  HttpRouter();
+  ~HttpRouter();
+
+  /// @brief 注册路由，pattern须以'/'开头
+  /// @return 模式非法、参数过多或与已有路由冲突时返回false
+  bool Add(HttpRequest::Method method, const std::string &pattern, const Handler &handler,
+           bool blocking = false);
+
+  /// @brief 查找请求对应的路由，HEAD请求未注册时使用GET的路由
+  /// @param req 匹配成功时写入路由参数，参数指向path
+  /// @param path_matched 非空时返回路径是否匹配了任意方法的路由，用于区分404与405
+  /// @return 未找到时返回nullptr
+  const Route *Find(HttpRequest::Method method, const StringPiece &path, HttpRequest *req,
+                    bool *path_matched = nullptr) const;
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  static const int kMethods = HttpRequest::kDelete + 1;
+
+  enum NodeType {
+    kStatic,
+    kParam,
+    kCatchAll,
+  };
+
+  struct Node {
+    NodeType type {kStatic};
+    /// @brief 静态节点为边上的字符串，参数及通配节点为参数名
+    std::string label;
+    /// @brief 静态子节点的首字节，与children一一对应
+    std::string indices;
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;
+    std::unique_ptr<Node> catch_all;
+    Route routes[kMethods];
+    bool has_handler {false};
+
+    /// @param method 为-1时表示任意方法，HEAD可由GET处理
+    bool Accepts(int method) const {
+      if (method < 0) {
+        return has_handler;
+      }
+      return routes[method].handler || (method == HttpRequest::kHead && routes[HttpRequest::kGet].handler);
+    }
+  };
+
+  /// @brief 在node下插入静态片段，返回片段末尾对应的节点
+  static Node *InsertStatic(Node *node, StringPiece literal);
+
+  /// @param method 为-1时匹配任意方法
+  static const Node *Match(const Node *node, StringPiece path, int method,
+                           HttpRequest::Param *params, size_t *count);
+
+  NOT_ALLOWED_COPY(HttpRouter)
+
+private:
+  std::unique_ptr<Node> root_;
+  size_t size_;
+};
+
+NAMESPACE_END
@@ -6,14 +6,38 @@
  */
 #include "Http/HttpServer.h"
 #include "Http/HttpContext.h"
+#include "Http/Gzip.h"
+#include "Http/HttpHeaderWriter.h"
+#include "Core/TcpConnection.h"
 #include "Database/ConnectionPool.h"
+#include "Database/DatabaseRouter.h"
+#include <algorithm>
 #include <memory>
 
 NAMESPACE_BEGIN
+/// @brief 长连接默认的空闲超时(秒)及请求数上限
+static const int kKeepAliveTimeout = 60;
+static const int kKeepAliveMax = 1000;
+/// @brief 单个连接管线化队列默认的响应个数及字节数上限
+static const size_t kPipelineMaxRequests = 64;
+static const size_t kPipelineMaxBytes = 4 * 1024 * 1024;
+
 HttpServer::HttpServer(EventLoop *loop, const InetAddress &listen_addr,
                        const std::string &name, const std::string &root_path, 
                        TcpServer::Option option)
-    : server_(loop, listen_addr, name, option), root_path_(root_path) {
+    : server_(loop, listen_addr, name, option),
+      root_path_(root_path),
+      max_body_size_(HttpContext::kDefaultMaxBodySize),
+      keep_alive_timeout_(kKeepAliveTimeout),
+      keep_alive_max_(kKeepAliveMax),
+      max_pipeline_requests_(kPipelineMaxRequests),
+      max_pipeline_bytes_(kPipelineMaxBytes),
+      worker_threads_(2),
+      worker_pool_(name + "-worker"),
+      has_blocking_(false),
+      blocking_threads_(4),
+      blocking_pool_(name + "-blocking") {
+  blocking_pool_.setMaxQueueSize(1024);
   server_.setConnectionCallback(
     std::bind(&HttpServer::onConnection, this, std::placeholders::_1)
   );
@@ -36,50 +60,384 @@ void HttpServer::InitDatabase(const std::string &url,
   ConnectionPool::getInstance()->Init(url, user, passwd, dbname, port, max_conn);
 }
 
+void HttpServer::AddReplica(const std::string &name,
+  const std::string &url,
+  const std::string &user,
+  const std::string &passwd,
+  const std::string &dbname,
+  unsigned int port,
+  int max_conn
+) {
+  ConnectionPool *replica = ConnectionPool::getInstance(name);
+  replica->Init(url, user, passwd, dbname, port, max_conn);
+  DatabaseRouter::getInstance()->AddReplica(replica);
+}
+
 void HttpServer::Start() {
   LogInfo("HttpServer [{}] starts listening on {}.", server_.name(), server_.ipPort());
+  if (file_cache_) {
+    worker_pool_.Start(worker_threads_);
+    file_cache_->setWorkerPool(&worker_pool_);
+    file_cache_->Watch(server_.getLoop());
+  }
+  if (has_blocking_) {
+    blocking_pool_.Start(blocking_threads_);
+  }
   server_.Start();
 }
 
 void HttpServer::onConnection(const TcpConnectionPtr &conn) {
   if (conn->connected()) {
     LogInfo("new Connection arrived");
+    // 每个连接持有一个解析上下文，请求跨多个TCP分段到达时保留解析进度
+    auto context = std::make_shared<HttpContext>();
+    context->setMaxBodySize(max_body_size_);
+    if (!body_callbacks_.empty()) {
+      context->setBodySelector(std::bind(&HttpServer::SelectBody, this, std::placeholders::_1));
+    }
+    conn->setContext(context);
+    context->setLastActive(Timestamp::Now());
+    if (keep_alive_timeout_ > 0) {
+      ArmIdleTimer(conn, context.get(), keep_alive_timeout_);
+    }
   } else {
     LogInfo("Connection closed");
+    HttpContext *context = conn->getContext<HttpContext>();
+    if (context && context->idleTimer() != 0) {
+      conn->getLoop()->Cancel(context->idleTimer());
+    }
   }
 }
+
+void HttpServer::ArmIdleTimer(const TcpConnectionPtr &conn, HttpContext *context, double delay) {
+  std::weak_ptr<TcpConnection> weak_conn(conn);
+  context->setIdleTimer(conn->getLoop()->RunAfter(delay, [this, weak_conn]() {
+    onIdle(weak_conn);
+  }));
+}
+
+void HttpServer::onIdle(const std::weak_ptr<TcpConnection> &weak_conn) {
+  TcpConnectionPtr conn = weak_conn.lock();
+  HttpContext *context = conn ? conn->getContext<HttpContext>() : nullptr;
+  if (!context || !conn->connected()) {
+    return;
+  }
+  // 收到数据时只更新时间戳，到期时才按剩余时间重新计时，每个请求不必增删定时器
+  int64_t timeout_us = static_cast<int64_t>(keep_alive_timeout_) * Timestamp::kMicroSecondsPerSecond;
+  int64_t idle_us = Timestamp::Now().microSecondsSinceEpoch() - context->lastActive().microSecondsSinceEpoch();
+  if (context->pipeline().size() > 0) {
+    // 阻塞处理函数仍在执行，不算空闲
+    ArmIdleTimer(conn, context, keep_alive_timeout_);
+    return;
+  }
+  if (idle_us < timeout_us) {
+    ArmIdleTimer(conn, context, static_cast<double>(timeout_us - idle_us) / Timestamp::kMicroSecondsPerSecond);
+    return;
+  }
+  LogInfo("Connection [{}] idle for {}s, shutdown.", conn->name(), keep_alive_timeout_);
+  context->setIdleTimer(0);
+  conn->Shutdown();
+}
+
 void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
                            Timestamp recv_time) {
-  std::unique_ptr<HttpContext> context(new HttpContext);
-  // 进行状态机解析
-  // 错误则发送 BAD REQUEST 半关闭
-  if (!context->ParseRequest(buf, recv_time)) {
-    LogInfo("ParseRequest failed!");
-    conn->Send("HTTP/1.1 400 Bad Request\r\n\r\n");
-    conn->Shutdown();
+  HttpContext *context = conn->getContext<HttpContext>();
+  if (!context) {
+    onConnection(conn);
+    context = conn->getContext<HttpContext>();
   }
+  HttpPipeline &pipeline = context->pipeline();
+  context->setLastActive(recv_time);
+
+  // 1.解析缓冲区中所有完整的请求(HTTP/1.1管线化)，按到达顺序生成响应
+  while (buf->ReadableBytes() > 0 && !pipeline.closing()) {
+    if (PipelineFull(pipeline)) {
+      // 先发出队首已完成的响应；仍超限(如队首阻塞处理函数未完成)时停止解析并暂停读取，
+      // 其余请求留在接收缓冲区，Flush回落后再继续
+      pipeline.Flush(conn);
+      if (pipeline.closing()) {
+        break;
+      }
+      if (PipelineFull(pipeline)) {
+        LogDebug("Connection [{}] pipeline full: {} responses, {} bytes.", conn->name(),
+                 pipeline.size(), pipeline.bytes());
+        pipeline.setPaused(true);
+        conn->StopRead();
+        break;
+      }
+    }
+    // 错误则回复对应状态码(400/413/500/501)后半关闭
+    if (!context->ParseRequest(buf, recv_time)) {
+      int code = context->errorCode();
+      LogInfo("ParseRequest failed: {}!", code);
+      uint64_t seq = pipeline.Push();
+      HttpPipeline::Entry *entry = pipeline.Find(seq);
+      entry->response.Init(root_path_, "", false, code);
+      entry->response.MakeHead(StringPiece("Content-Length: 0\r\n"), &entry->head);
+      entry->close_after = true;
+      pipeline.Complete(seq);
+      buf->RetrieveAll();
+      context->Reset();
+      break;
+    }
+    if (!context->gotAll()) {
+      // 请求不完整，保留解析进度等待后续数据
+      break;
+    }
 
-  // 如果成功解析
-  if (context->gotAll()) {
     LogInfo("ParseRequest success!");
-    onRequest(conn, context->request());
+    HttpRequest &req = context->request();
+    // 达到请求数上限时，该请求的响应带Connection: close，发送后关闭连接
+    int served = context->CountRequest();
+    bool keep_alive = req.IsKeepAlive() && (keep_alive_max_ <= 0 || served < keep_alive_max_);
+    uint64_t seq = pipeline.Push();
+    HttpPipeline::Entry *entry = pipeline.Find(seq);
+    entry->close_after = !keep_alive;
+    entry->response.Init(root_path_, req.path(), keep_alive);
+    if (keep_alive) {
+      entry->response.setKeepAliveLimits(keep_alive_timeout_, keep_alive_max_ > 0 ? keep_alive_max_ - served : 0);
+    }
+    if (onRequest(conn, req, seq, entry)) {
+      pipeline.Complete(seq);
+    }
+    // 请求头部及请求体直接引用缓冲区数据，处理完毕后才能释放
+    buf->Retrieve(context->requestSize());
     context->Reset();
+    if (!keep_alive) {
+      // 非长连接，忽略其后的数据
+      buf->RetrieveAll();
+      break;
+    }
+  }
+
+  // 2.本次读事件产生的所有响应一次聚集写发出
+  Flush(conn, context);
+}
+
+void HttpServer::Flush(const TcpConnectionPtr &conn, HttpContext *context) {
+  HttpPipeline &pipeline = context->pipeline();
+  pipeline.Flush(conn);
+  // 客户端等待100 Continue后才发送请求体，须在此前的响应全部发出后回复
+  if (!pipeline.closing() && pipeline.size() == 0 && context->TakeContinue()) {
+    conn->Send("HTTP/1.1 100 Continue\r\n\r\n");
+  }
+  if (pipeline.paused() && !pipeline.closing() && PipelineDrained(pipeline)) {
+    pipeline.setPaused(false);
+    conn->StartRead();
+    // 暂停期间已读入的请求不会再触发读事件，投递回loop继续解析，避免在onMessage中重入
+    std::weak_ptr<TcpConnection> weak_conn(conn);
+    conn->getLoop()->QueueInLoop([this, weak_conn]() {
+      TcpConnectionPtr conn = weak_conn.lock();
+      if (conn && conn->connected() && conn->inputBuffer()->ReadableBytes() > 0) {
+        onMessage(conn, conn->inputBuffer(), Timestamp::Now());
+      }
+    });
+  }
+}
+
+bool HttpServer::PipelineFull(const HttpPipeline &pipeline) const {
+  return (max_pipeline_requests_ > 0 && pipeline.size() >= max_pipeline_requests_) ||
+         (max_pipeline_bytes_ > 0 && pipeline.bytes() >= max_pipeline_bytes_);
+}
+
+bool HttpServer::PipelineDrained(const HttpPipeline &pipeline) const {
+  return (max_pipeline_requests_ == 0 || pipeline.size() <= max_pipeline_requests_ / 2) &&
+         (max_pipeline_bytes_ == 0 || pipeline.bytes() <= max_pipeline_bytes_ / 2);
+}
+
+const HttpContext::BodyCallback *HttpServer::SelectBody(const HttpRequest &req) const {
+  auto it = body_callbacks_.find(req.path());
+  return it != body_callbacks_.end() ? &it->second : nullptr;
+}
+
+bool HttpServer::Static(const std::string &prefix, const std::string &dir) {
+  std::string pattern = prefix;
+  if (pattern.empty() || pattern.back() != '/') {
+    pattern += '/';
+  }
+  pattern += "*filepath";
+  return Get(pattern, [dir](const HttpRequest &req, HttpResponse *resp) {
+    StringPiece file = req.param("filepath");
+    // 拒绝包含".."的路径，防止越出挂载目录
+    if (file.find("..") != StringPiece::npos) {
+      resp->setCode(404);
+      resp->setPath("/404.html");
+      return;
+    }
+    resp->setRoot(dir);
+    resp->setPath("/" + file.ToString());
+  });
+}
+
+void HttpServer::setCacheControl(const std::string &prefix, const std::string &value) {
+  std::string header = "Cache-Control: " + value + "\r\n";
+  for (auto &item : cache_controls_) {
+    if (item.first == prefix) {
+      item.second = header;
+      return;
+    }
   }
+  cache_controls_.emplace_back(prefix, header);
+  std::stable_sort(cache_controls_.begin(), cache_controls_.end(),
+                   [](const std::pair<std::string, std::string> &a, const std::pair<std::string, std::string> &b) {
+                     return a.first.size() > b.first.size();
+                   });
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr &conn,
-                           const HttpRequest &req) {
-  HttpResponse resp;
-  resp.Init(root_path_, req.path(), req.IsKeepAlive());
+StringPiece HttpServer::CacheControl(const std::string &path) const {
+  for (const auto &item : cache_controls_) {
+    if (path.compare(0, item.first.size(), item.first) == 0) {
+      return item.second;
+    }
+  }
+  return StringPiece();
+}
+
+bool HttpServer::onRequest(const TcpConnectionPtr &conn, HttpRequest &req, uint64_t seq,
+                           HttpPipeline::Entry *entry) {
+  HttpResponse &resp = entry->response;
   LogInfo("Path: {}.", req.path());
-  Buffer buffer;
-  resp.MakeResponse(&buffer);
-  buffer.Append(std::string(resp.file(), resp.fileSize()));
-  std::string str = buffer.RetrieveAllAsString();
-  conn->Send(str);
-  if (!req.IsKeepAlive()) {
-    conn->Shutdown();
+  resp.setConditional(req);
+  resp.setAcceptGzip(Gzip::Accepted(req.getHeader("Accept-Encoding")));
+  resp.setHeadOnly(req.method() == HttpRequest::kHead);
+
+  // 1.路由分发，处理函数生成了响应则结束，否则按其重写后的路径发送文件
+  bool path_matched = false;
+  const HttpRouter::Route *route = router_.Find(req.method(), req.path(), &req, &path_matched);
+  if (route && route->blocking) {
+    return RunBlocking(conn, req, seq, route->handler, entry);
+  }
+  if (route) {
+    resp.setOutput(&entry->head);
+    route->handler(req, &resp);
+    resp.setOutput(nullptr);
+    if (entry->head.ReadableBytes() > 0) {
+      return true;
+    }
+  } else if (path_matched && req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead) {
+    // 路径存在但不支持该方法；GET及HEAD仍可按路径发送文件
+    resp.setCode(405);
+    resp.setPath("/405.html");
+  }
+  ServeFile(entry);
+  return true;
+}
+
+bool HttpServer::RunBlocking(const TcpConnectionPtr &conn, const HttpRequest &req, uint64_t seq,
+                             const HttpCallback &handler, HttpPipeline::Entry *entry) {
+  // 1.请求及响应拷贝到句柄中，工作线程不接触连接的任何状态
+  std::weak_ptr<TcpConnection> weak_conn(conn);
+  auto async = std::make_shared<HttpAsyncResponse>(conn->getLoop(),
+    [this, weak_conn, seq](HttpAsyncResponse *result) {
+      TcpConnectionPtr conn = weak_conn.lock();
+      if (conn) {
+        FinishBlocking(conn, seq, result);
+      }
+    });
+  HttpResponse *resp = async->response();
+  resp->Init(root_path_, req.path(), entry->response.keepAlive());
+  resp->setKeepAliveLimits(entry->response.keepAliveTimeout(), entry->response.keepAliveMax());
+  resp->setAcceptGzip(entry->response.acceptGzip());
+  resp->setHeadOnly(entry->response.headOnly());
+  std::shared_ptr<HttpRequest> copy = std::make_shared<HttpRequest>(req);
+  bool queued = blocking_pool_.Run([handler, copy, async]() {
+    handler(*copy, async->response());
+    async->Done();
+  });
+  if (queued) {
+    return false;
+  }
+
+  // 2.队列已满，立即回复503
+  LogError("Blocking queue is full, reject [{}].", req.path());
+  entry->response.setCode(503);
+  entry->response.MakeResponse("<html><title>Error</title><body>503 : Service Unavailable</body></html>",
+                               "text/html", &entry->head);
+  return true;
+}
+
+void HttpServer::FinishBlocking(const TcpConnectionPtr &conn, uint64_t seq, HttpAsyncResponse *result) {
+  HttpContext *context = conn->getContext<HttpContext>();
+  HttpPipeline::Entry *entry = context ? context->pipeline().Find(seq) : nullptr;
+  if (!entry || entry->done) {
+    return;
+  }
+  Buffer *output = result->output();
+  if (output->ReadableBytes() > 0) {
+    entry->head.Append(output->peek(), output->ReadableBytes());
+  } else {
+    // 处理函数只重写了路径，在loop中发送文件以使用资源包及文件缓存
+    const HttpResponse &resp = *result->response();
+    entry->response.setRoot(resp.root());
+    entry->response.setPath(resp.path());
+    entry->response.setCode(resp.code());
+    entry->response.setHeaders(resp.headers());
+    ServeFile(entry);
+  }
+  context->pipeline().Complete(seq);
+  Flush(conn, context);
+}
+
+void HttpServer::ServeFile(HttpPipeline::Entry *entry) {
+  HttpResponse &resp = entry->response;
+  if (!resp.path().empty() && resp.path().back() == '/') {
+    // 目录请求发送其中的index.html
+    resp.setPath(resp.path() + "index.html");
+  }
+  const std::string &path = resp.path();
+  resp.setExtraHeaders(CacheControl(path));
+  if (resp.code() != -1 || resp.root() != root_path_) {
+    // 错误响应及挂载目录中的文件不经过资源包和文件缓存
+    resp.MakeResponse(&entry->head);
+    return;
+  }
+  // 区间请求总是针对未压缩的原始表示
+  bool use_gzip = resp.acceptGzip() && !resp.rangeRequested();
+
+  AssetBundle::Asset asset;
+  if (bundle_ && bundle_->Find(path, &asset)) {
+    // 资源包中的实体头部和内容均已预先生成，只需写入状态行及连接等头部
+    bool gzip = use_gzip && !asset.gzip_body.empty();
+    const StringPiece &etag = gzip ? asset.gzip_etag : asset.etag;
+    if (resp.NotModified(etag, asset.last_modified)) {
+      resp.MakeNotModified(etag, asset.last_modified, &entry->head);
+      return;
+    }
+    const StringPiece &body = gzip ? asset.gzip_body : asset.body;
+    resp.setBody(bundle_, body.data(), body.size());
+    if (!gzip && resp.MakeRange(body.data(), body.size(), asset.mime, etag, asset.last_modified, &entry->head)) {
+      return;
+    }
+    resp.setCode(200);
+    resp.MakeHead(gzip ? asset.gzip_headers : asset.headers, &entry->head);
+    return;
+  }
+  if (file_cache_) {
+    // 缓存命中时直接引用预先构建的实体头部及文件内容
+    FileCache::EntryPtr cached = file_cache_->Get(path);
+    if (cached) {
+      FileCache::VariantPtr gzip = use_gzip ? file_cache_->Compressed(cached) : nullptr;
+      const FileCache::Variant &variant = gzip ? *gzip : *cached;
+      if (resp.NotModified(variant.etag, cached->last_modified)) {
+        resp.MakeNotModified(variant.etag, cached->last_modified, &entry->head);
+        return;
+      }
+      if (gzip) {
+        resp.setBody(gzip, gzip->body.data(), gzip->body.size());
+      } else {
+        resp.setBody(cached, cached->body.data(), cached->body.size());
+        if (resp.MakeRange(cached->body.data(), cached->body.size(), HttpHeaderWriter::MimeType(cached->path),
+                           cached->etag, cached->last_modified, &entry->head)) {
+          return;
+        }
+      }
+      resp.setCode(200);
+      resp.MakeHead(variant.headers, &entry->head);
+      return;
+    }
   }
+  // 响应头写入entry->head，文件内容保持映射，发送时作为聚集写的一段
+  resp.MakeResponse(&entry->head);
 }
 
 NAMESPACE_END
@@ -11,13 +11,26 @@
 #include "Core/TcpServer.h"
 #include "Http/HttpRequest.h"
 #include "Http/HttpResponse.h"
+#include "Http/HttpPipeline.h"
+#include "Http/HttpContext.h"
+#include "Http/HttpRouter.h"
+#include "Http/HttpAsyncResponse.h"
+#include "Http/FileCache.h"
+#include "Http/AssetBundle.h"
+#include "Base/ThreadPool.h"
 #include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 NAMESPACE_BEGIN
 class API HttpServer {
 public:
-  using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+  /// @brief 路由处理函数，调用resp->MakeResponse(str, type)生成动态响应；
+  /// 未生成响应时按resp->path()(及resp->root())发送文件，可用于路径重写
+  using HttpCallback = HttpRouter::Handler;
   HttpServer(EventLoop *loop, const InetAddress &listen_addr,
              const std::string &name, const std::string &root_path,
              TcpServer::Option option = TcpServer::kNoReusePort);
@@ -30,20 +43,145 @@ public:
     int max_conn
   );
 
+  /// @brief 添加名为name的只读副本，登录等读操作由DatabaseRouter分配到负载最低的副本，
+  /// 须在InitDatabase之后、AccountHandler::Install之前调用
+  void AddReplica(const std::string &name,
+    const std::string &url,
+    const std::string &user,
+    const std::string &passwd,
+    const std::string &dbname,
+    unsigned int port,
+    int max_conn
+  );
+
   EventLoop *getLoop() const { return server_.getLoop(); }
 
+  /// @brief 设置所有连接待发送数据总字节数上限，防止慢速客户端耗尽内存
+  void setMaxOutputBytes(size_t max_bytes) { server_.setMaxOutputBytes(max_bytes); }
+
+  /// @brief 加载AssetPacker生成的资源包，包中存在的路径直接从映射内存发送，
+  /// 其余路径仍走文件系统，须在Start之前调用
+  bool LoadAssetBundle(const std::string &bundle_path) {
+    bundle_ = AssetBundle::Open(bundle_path);
+    return bundle_ != nullptr;
+  }
+
+  /// @brief 启用静态文件响应缓存，文档根目录变化时自动失效，须在Start之前调用
+  /// @param max_bytes 缓存总字节数上限
+  /// @param max_file_size 可缓存的单个文件大小上限
+  void EnableFileCache(size_t max_bytes, size_t max_file_size = 1024 * 1024) {
+    file_cache_.reset(new FileCache(root_path_, max_bytes, max_file_size));
+  }
+
+  /// @brief 为路径前缀设置Cache-Control策略，如("/static/", "public, max-age=86400")，
+  /// 多个前缀匹配时取最长者，须在Start之前调用
+  void setCacheControl(const std::string &prefix, const std::string &value);
+
+  /// @brief 设置工作线程数，工作线程执行压缩等不应占用IO线程的任务
+  void setWorkerThreadNum(int num_threads) { worker_threads_ = num_threads; }
+
+  /// @brief 设置执行阻塞处理函数的线程数及等待队列上限，须在Start之前调用
+  void setBlockingThreadNum(int num_threads, size_t max_queue_size = 1024) {
+    blocking_threads_ = num_threads;
+    blocking_pool_.setMaxQueueSize(max_queue_size);
+  }
+
+  /// @brief 阻塞任务的队列深度、执行中个数及排队等待时间
+  ThreadPool::Stats blockingStats() {
+    return blocking_pool_.stats();
+  }
+
+  /// @brief 设置长连接的空闲超时及单个连接的请求数上限，通过Keep-Alive头部告知客户端，须在Start之前调用
+  /// @param timeout 空闲超过该秒数(期间没有收到数据且没有处理中的请求)时关闭连接，不大于0时不限
+  /// @param max_requests 第max_requests个请求的响应带Connection: close，随后关闭连接，不大于0时不限
+  void setKeepAlive(int timeout, int max_requests) {
+    keep_alive_timeout_ = timeout;
+    keep_alive_max_ = max_requests;
+  }
+
+  /// @brief 设置整体缓存的请求体上限，超出时回复413
+  void setMaxBodySize(size_t max_size) { max_body_size_ = max_size; }
+
+  /// @brief 设置单个连接管线化队列中待发送响应的个数及字节数上限，达到任一上限时停止解析并暂停读取，
+  /// 发送后回落到上限的一半以下再恢复，防止队首阻塞处理函数未完成时客户端不断堆积请求，为0时不限
+  void setMaxPipeline(size_t max_requests, size_t max_bytes) {
+    max_pipeline_requests_ = max_requests;
+    max_pipeline_bytes_ = max_bytes;
+  }
+
+  /// @brief 指定路径的请求体以流式方式交给回调(如大文件上传直接写盘)，须在Start之前设置
+  void setBodyStreamCallback(const std::string &path, const HttpContext::BodyCallback &cb) {
+    body_callbacks_[path] = cb;
+  }
+
+  /// @brief 注册路由，如Route(HttpRequest::kGet, "/user/:id", cb)，参数通过req.param读取，
+  /// "*name"匹配剩余路径，须在Start之前调用。未匹配任何路由的请求按路径发送文件
+  /// @param blocking 处理函数会阻塞(如同步访问数据库)时为true，此时在阻塞任务线程池中执行，
+  /// 完成后投递回连接所属的loop发送，不会阻塞该loop上的其他连接；队列满时回复503
+  bool Route(HttpRequest::Method method, const std::string &pattern, const HttpCallback &cb,
+             bool blocking = false) {
+    has_blocking_ = has_blocking_ || blocking;
+    return router_.Add(method, pattern, cb, blocking);
+  }
+
+  bool Get(const std::string &pattern, const HttpCallback &cb) {
+    return Route(HttpRequest::kGet, pattern, cb);
+  }
+
+  bool Post(const std::string &pattern, const HttpCallback &cb) {
+    return Route(HttpRequest::kPost, pattern, cb);
+  }
+
+  /// @brief 将目录挂载到路径前缀下，如Static("/static/", "/var/www")使/static/a.css对应/var/www/a.css
+  bool Static(const std::string &prefix, const std::string &dir);
+
   void Start();
 
 private:
   void onConnection(const TcpConnectionPtr &conn_ptr);
   void onMessage(const TcpConnectionPtr &conn_ptr, Buffer *buffer, Timestamp recv_time);
-  void onRequest(const TcpConnectionPtr &conn_ptr, const HttpRequest &req);
+  /// @brief 在delay秒后检查连接是否空闲
+  void ArmIdleTimer(const TcpConnectionPtr &conn, HttpContext *context, double delay);
+  /// @brief 空闲超时则关闭连接，否则按最近一次收到数据的时间重新计时
+  void onIdle(const std::weak_ptr<TcpConnection> &weak_conn);
+  /// @return 响应是否已生成，阻塞处理函数异步完成时返回false
+  bool onRequest(const TcpConnectionPtr &conn, HttpRequest &req, uint64_t seq, HttpPipeline::Entry *entry);
+  bool RunBlocking(const TcpConnectionPtr &conn, const HttpRequest &req, uint64_t seq,
+                   const HttpCallback &handler, HttpPipeline::Entry *entry);
+  void FinishBlocking(const TcpConnectionPtr &conn, uint64_t seq, HttpAsyncResponse *result);
+  /// @brief 按响应路径发送文件：资源包、文件缓存或文件映射
+  void ServeFile(HttpPipeline::Entry *entry);
+  void Flush(const TcpConnectionPtr &conn, HttpContext *context);
+  /// @brief 管线化队列是否达到上限
+  bool PipelineFull(const HttpPipeline &pipeline) const;
+  /// @brief 管线化队列是否回落到上限的一半以下
+  bool PipelineDrained(const HttpPipeline &pipeline) const;
+  const HttpContext::BodyCallback *SelectBody(const HttpRequest &req) const;
+  StringPiece CacheControl(const std::string &path) const;
 
   NOT_ALLOWED_COPY(HttpServer)
 
 private:
   TcpServer server_;
   const std::string root_path_;
+  size_t max_body_size_;
+  int keep_alive_timeout_;
+  int keep_alive_max_;
+  size_t max_pipeline_requests_;
+  size_t max_pipeline_bytes_;
+  std::unordered_map<std::string, HttpContext::BodyCallback> body_callbacks_;
+  HttpRouter router_;
+  /// @brief 路径前缀及完整的Cache-Control头部，按前缀长度降序
+  std::vector<std::pair<std::string, std::string>> cache_controls_;
+  std::unique_ptr<FileCache> file_cache_;
+  std::shared_ptr<AssetBundle> bundle_;
+  int worker_threads_;
+  /// @brief 声明在file_cache_之后，先于其析构并等待压缩任务结束
+  ThreadPool worker_pool_;
+  bool has_blocking_;
+  int blocking_threads_;
+  /// @brief 与压缩任务分开，慢查询不会拖慢压缩，反之亦然
+  ThreadPool blocking_pool_;
 };
 
 NAMESPACE_END
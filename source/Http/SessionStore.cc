@@ -0,0 +1,241 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-11 09:38:02
+ * @Contact: 2458006466@qq.com
+ * @Description: SessionStore
+ */
+#include "Http/SessionStore.h"
+#include "Http/HttpRequest.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <chrono>
+#include <fstream>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NAMESPACE_BEGIN
+static const char kHex[] = "0123456789abcdef";
+/// @brief 会话ID的随机字节数，编码为32个十六进制字符
+static const size_t kIdBytes = 16;
+
+static std::string HexEncode(const StringPiece &data) {
+  std::string hex;
+  hex.reserve(data.size() * 2);
+  for (size_t i = 0; i < data.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+    hex += kHex[c >> 4];
+    hex += kHex[c & 0x0f];
+  }
+  return hex;
+}
+
+static int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+static bool HexDecode(const std::string &hex, std::string *data) {
+  if (hex.size() % 2 != 0) {
+    return false;
+  }
+  data->clear();
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    int hi = HexValue(hex[i]);
+    int lo = HexValue(hex[i + 1]);
+    if (hi < 0 || lo < 0) {
+      return false;
+    }
+    *data += static_cast<char>(hi << 4 | lo);
+  }
+  return true;
+}
+
+static int64_t NowUs() {
+  return Timestamp::Now().microSecondsSinceEpoch();
+}
+
+SessionStore::SessionStore(const Options &options) :
+  options_(options),
+  sessions_(options.capacity, options.shards),
+  version_(0),
+  saved_version_(0),
+  running_(true) {
+  if (!options_.snapshot.empty()) {
+    Load();
+    writer_.reset(new Thread(std::bind(&SessionStore::SnapshotLoop, this), "SessionSnapshot"));
+    writer_->Start();
+  }
+}
+
+SessionStore::~SessionStore() {
+  if (writer_) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      running_ = false;
+    }
+    cond_.notify_all();
+    writer_->Join();
+    if (version_ != saved_version_) {
+      Snapshot();
+    }
+  }
+}
+
+std::string SessionStore::Create(const std::string &username) {
+  char random[kIdBytes];
+  CHECK_EQ(getrandom(random, sizeof(random), 0), static_cast<ssize_t>(sizeof(random)));
+  std::string id = HexEncode(StringPiece(random, sizeof(random)));
+  sessions_.Put(id, Session{ username, NowUs() + options_.ttl_ms * 500 }, options_.ttl_ms);
+  ++version_;
+  return id;
+}
+
+bool SessionStore::Find(const std::string &id, std::string *username) {
+  if (id.size() != kIdBytes * 2) {
+    return false;
+  }
+  Session session;
+  if (!sessions_.Get(id, &session)) {
+    return false;
+  }
+  int64_t now = NowUs();
+  if (now >= session.refresh_us) {
+    // 存活时间过半后续期，避免每次访问都写入
+    session.refresh_us = now + options_.ttl_ms * 500;
+    sessions_.Put(id, session, options_.ttl_ms);
+    ++version_;
+  }
+  *username = std::move(session.username);
+  return true;
+}
+
+bool SessionStore::Find(const HttpRequest &req, std::string *username) {
+  return Find(SessionId(req), username);
+}
+
+void SessionStore::Remove(const std::string &id) {
+  if (sessions_.Erase(id)) {
+    ++version_;
+  }
+}
+
+std::string SessionStore::SessionId(const HttpRequest &req) const {
+  // Cookie: a=1; SID=...
+  StringPiece cookie = req.getHeader("Cookie");
+  size_t pos = 0;
+  while (pos < cookie.size()) {
+    size_t end = cookie.find(";", pos);
+    if (end == std::string::npos) {
+      end = cookie.size();
+    }
+    StringPiece pair = cookie.substr(pos, end - pos);
+    while (!pair.empty() && pair[0] == ' ') {
+      pair = pair.substr(1);
+    }
+    size_t eq = pair.find("=");
+    if (eq != std::string::npos && pair.substr(0, eq) == StringPiece(options_.cookie_name)) {
+      return pair.substr(eq + 1).ToString();
+    }
+    pos = end + 1;
+  }
+  return std::string();
+}
+
+std::string SessionStore::SetCookie(const std::string &id) const {
+  return options_.cookie_name + "=" + id + "; Path=/; Max-Age=" + std::to_string(options_.ttl_ms / 1000) +
+         "; HttpOnly; SameSite=Lax";
+}
+
+std::string SessionStore::ClearCookie() const {
+  return options_.cookie_name + "=; Path=/; Max-Age=0; HttpOnly; SameSite=Lax";
+}
+
+size_t SessionStore::Load() {
+  // 每行一个会话：<id> <过期时间(us)> u<十六进制用户名>，前缀使空用户名也占一个字段
+  std::ifstream in(options_.snapshot);
+  if (!in) {
+    return 0;
+  }
+  int64_t now = NowUs();
+  size_t loaded = 0;
+  std::string id;
+  int64_t expire_us = 0;
+  std::string hex;
+  std::string username;
+  while (in >> id >> expire_us >> hex) {
+    if (expire_us <= now || id.size() != kIdBytes * 2 || hex[0] != 'u' || !HexDecode(hex.substr(1), &username)) {
+      continue;
+    }
+    int64_t ttl_ms = (expire_us - now) / 1000;
+    sessions_.Put(id, Session{ username, now + ttl_ms * 500 }, ttl_ms);
+    ++loaded;
+  }
+  LogInfo("loaded {} sessions from {}.", loaded, options_.snapshot);
+  return loaded;
+}
+
+bool SessionStore::Snapshot() {
+  if (options_.snapshot.empty()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  uint64_t version = version_;
+  std::string tmp = options_.snapshot + ".tmp";
+  {
+    // 会话ID即登录凭证，快照只允许属主读写；fchmod覆盖残留临时文件原有的权限
+    int fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0600);
+    if (fd < 0 || ::fchmod(fd, 0600) != 0) {
+      LogError("open session snapshot {} failed.", tmp);
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      return false;
+    }
+    FILE *out = ::fdopen(fd, "w");
+    if (!out) {
+      LogError("open session snapshot {} failed.", tmp);
+      ::close(fd);
+      return false;
+    }
+    bool ok = true;
+    sessions_.ForEach([out, &ok](const std::string &id, const Session &session, int64_t expire_us) {
+      std::string username = HexEncode(session.username);
+      ok = ok && fprintf(out, "%s %lld u%s\n", id.c_str(), static_cast<long long>(expire_us), username.c_str()) > 0;
+    });
+    ok = (fflush(out) == 0) && ok;
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+      LogError("write session snapshot {} failed.", tmp);
+      return false;
+    }
+  }
+  if (::rename(tmp.c_str(), options_.snapshot.c_str()) != 0) {
+    LogError("rename session snapshot {} failed.", tmp);
+    return false;
+  }
+  saved_version_ = version;
+  return true;
+}
+
+void SessionStore::SnapshotLoop() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (running_) {
+    cond_.wait_for(lock, std::chrono::milliseconds(options_.snapshot_interval_ms));
+    if (!running_ || version_ == saved_version_) {
+      continue;
+    }
+    lock.unlock();
+    Snapshot();
+    lock.lock();
+  }
+}
+
+NAMESPACE_END
@@ -0,0 +1,106 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-11 09:37:48
+ * @Contact: 2458006466@qq.com
+ * @Description: SessionStore
+ */
+#pragma once
+
+#include "Api.h"
+#include "Base/LruCache.h"
+#include "Base/StringPiece.h"
+#include "Base/Thread.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+NAMESPACE_BEGIN
+class HttpRequest;
+/**
+ * @brief 基于Cookie的会话表。
+ * (1) 会话ID为128位随机数(getrandom)，通过Set-Cookie下发；
+ * (2) 会话存放在分片的过期哈希表中，查找只锁会话ID所在的分片；
+ * (3) 访问时间过半后自动续期(滑动过期)；
+ * (4) 设置snapshot时，后台线程定期把变化后的会话表写入快照文件(先写临时文件再rename)，
+ *     启动时载入，重启后已登录的用户不必重新登录。
+ */
+class API SessionStore {
+public:
+  struct Options {
+    std::string cookie_name {"SID"};
+    /// @brief 会话的存活时间
+    int64_t ttl_ms {30 * 60 * 1000};
+    size_t capacity {1 << 20};
+    size_t shards {64};
+    /// @brief 快照文件路径，为空时不写快照
+    std::string snapshot;
+    int snapshot_interval_ms {5000};
+  };
+
+  explicit SessionStore(const Options &options);
+  /// @brief 有变化时写入最后一次快照
+  ~SessionStore();
+
+  /// @brief 为用户创建会话
+  /// @return 会话ID
+  std::string Create(const std::string &username);
+
+  /// @brief 查找会话，命中时返回用户名
+  bool Find(const std::string &id, std::string *username);
+
+  /// @brief 从请求的Cookie头部中取出会话ID并查找
+  bool Find(const HttpRequest &req, std::string *username);
+
+  void Remove(const std::string &id);
+
+  /// @brief 请求Cookie中的会话ID，没有时返回空串
+  std::string SessionId(const HttpRequest &req) const;
+
+  /// @brief 下发会话ID的Set-Cookie头部的值
+  std::string SetCookie(const std::string &id) const;
+
+  /// @brief 使浏览器删除会话Cookie的Set-Cookie头部的值
+  std::string ClearCookie() const;
+
+  /// @brief 载入快照文件中未过期的会话
+  /// @return 载入的会话个数，文件不存在时为0
+  size_t Load();
+
+  /// @brief 立即写入快照
+  bool Snapshot();
+
+  size_t size() {
+    return sessions_.size();
+  }
+
+  LruCacheStats stats() const {
+    return sessions_.stats();
+  }
+
+  NOT_ALLOWED_COPY(SessionStore)
+
+private:
+  struct Session {
+    std::string username;
+    /// @brief 超过该时间后访问时续期
+    int64_t refresh_us;
+  };
+
+  void SnapshotLoop();
+
+private:
+  const Options options_;
+  ShardedLruCache<Session> sessions_;
+  /// @brief 会话表的修改次数，与上次快照时不同则需要写入
+  std::atomic<uint64_t> version_;
+  uint64_t saved_version_;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  bool running_;
+  std::unique_ptr<Thread> writer_;
+};
+
+NAMESPACE_END
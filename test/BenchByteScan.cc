@@ -0,0 +1,161 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-22 14:16:31
+ * @Contact: 2458006466@qq.com
+ * @Description: BenchByteScan
+ */
+#include "Base/ByteScan.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include "Http/HttpParser.h"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace NAMESPACE;
+
+/// @brief 典型浏览器请求
+static std::string BrowserRequest() {
+  return
+    "GET /video.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/129.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Referer: http://127.0.0.1:8080/welcome.html\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+}
+
+/// @brief 携带大量统计/追踪Cookie的请求(约4KB)
+static std::string CookieRequest() {
+  std::string cookie = "Cookie: sid=8c1f0e2b7d4a4b9a8c1f0e2b7d4a4b9a";
+  for (int i = 0; cookie.size() < 4000; ++i) {
+    cookie += "; _ga_" + std::to_string(i) + "=GS1.1.1729488000.12.1.1729488123.0.0.0";
+  }
+  std::string req = BrowserRequest();
+  req.insert(req.size() - 2, cookie + "\r\n");
+  return req;
+}
+
+/// @brief 登录表单请求体
+static std::string FormBody() {
+  std::string body;
+  for (int i = 0; i < 16; ++i) {
+    body += "username=mirror%40example.com&password=p%26ss+w%3Drd&remember=on&";
+  }
+  return body;
+}
+
+/// @brief 随机数据上各指令集实现的结果须与标量实现一致
+static void CrossCheck() {
+  std::vector<ByteScan::Isa> isas = { ByteScan::kSse2, ByteScan::kAvx2 };
+  const char alphabet[] = "aZ09 \r\n:%+?&=\"(),/;<>@[]{}\t\x7f\x80\xff\x01";
+  srand(2024);
+  for (int round = 0; round < 2000; ++round) {
+    std::string data(rand() % 100, 'x');
+    for (char &ch : data) {
+      ch = (rand() % 4 == 0) ? alphabet[rand() % (sizeof(alphabet) - 1)] : 'a' + rand() % 26;
+    }
+    const char *b = data.data();
+    const char *e = b + data.size();
+    CHECK(ByteScan::setIsa(ByteScan::kScalar));
+    const char *expect[] = {
+      ByteScan::FindByte(b, e, ':'), ByteScan::FindCRLF(b, e), ByteScan::FindHeaderEnd(b, e),
+      ByteScan::FindUrlEscape(b, e), ByteScan::FindNonToken(b, e),
+      ByteScan::FindUriEnd(b, e, true), ByteScan::FindUriEnd(b, e, false),
+    };
+    for (ByteScan::Isa isa : isas) {
+      if (!ByteScan::setIsa(isa)) {
+        continue;
+      }
+      const char *got[] = {
+        ByteScan::FindByte(b, e, ':'), ByteScan::FindCRLF(b, e), ByteScan::FindHeaderEnd(b, e),
+        ByteScan::FindUrlEscape(b, e), ByteScan::FindNonToken(b, e),
+        ByteScan::FindUriEnd(b, e, true), ByteScan::FindUriEnd(b, e, false),
+      };
+      for (size_t i = 0; i < sizeof(got) / sizeof(got[0]); ++i) {
+        CHECK(got[i] == expect[i]) << ByteScan::isaName(isa) << " primitive " << i;
+      }
+    }
+  }
+}
+
+static double Elapsed(Timestamp start) {
+  return (Timestamp::Now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+}
+
+static void BenchPrimitives(const std::string &name, const std::string &data, int iterations) {
+  const char *b = data.data();
+  const char *e = b + data.size();
+  size_t sink = 0;
+
+  Timestamp start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    // 逐行查找CRLF
+    for (const char *p = b; p < e;) {
+      const char *crlf = ByteScan::FindCRLF(p, e);
+      sink += crlf - p;
+      p = crlf + 2;
+    }
+  }
+  double crlf_secs = Elapsed(start);
+
+  start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    sink += ByteScan::FindHeaderEnd(b, e) - b;
+  }
+  double end_secs = Elapsed(start);
+
+  start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    // 逐行校验行首token(头部字段名)并查找转义字符
+    for (const char *p = b; p < e;) {
+      const char *eol = ByteScan::FindLineEnd(p, e);
+      sink += ByteScan::FindNonToken(p, eol) - p;
+      sink += ByteScan::FindUrlEscape(p, eol) - p;
+      p = eol + 1;
+    }
+  }
+  double token_secs = Elapsed(start);
+
+  double mb = static_cast<double>(data.size()) * iterations / (1024 * 1024);
+  LogInfo("[{}] {}: CRLF lines {:.0f} MB/s, CRLFCRLF {:.0f} MB/s, line tokens+escapes {:.0f} MB/s (sink {})",
+    ByteScan::isaName(ByteScan::activeIsa()), name, mb / crlf_secs, mb / end_secs, mb / token_secs, sink % 10);
+}
+
+static void BenchParser(const std::string &name, const std::string &data, int iterations) {
+  HttpParser parser;
+  Timestamp start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    CHECK_EQ(parser.Parse(data.data(), data.size()), HttpParser::kComplete);
+    parser.Reset();
+  }
+  LogInfo("[{}] {}: HttpParser {:.0f} requests/sec",
+    ByteScan::isaName(ByteScan::activeIsa()), name, iterations / Elapsed(start));
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+  ByteScan::Isa detected = ByteScan::activeIsa();
+  CrossCheck();
+  LogInfo("cross check passed, detected isa: {}.", ByteScan::isaName(detected));
+
+  std::string browser = BrowserRequest();
+  std::string cookie = CookieRequest();
+  std::string form = FormBody();
+  ByteScan::Isa isas[] = { ByteScan::kScalar, ByteScan::kSse2, ByteScan::kAvx2 };
+  for (ByteScan::Isa isa : isas) {
+    if (!ByteScan::setIsa(isa)) {
+      LogInfo("{} not supported, skipped.", ByteScan::isaName(isa));
+      continue;
+    }
+    BenchPrimitives("browser request", browser, iterations);
+    BenchPrimitives("4KB cookie request", cookie, iterations / 8);
+    BenchPrimitives("form body", form, iterations / 2);
+    BenchParser("browser request", browser, iterations);
+    BenchParser("4KB cookie request", cookie, iterations / 8);
+  }
+  return 0;
+}
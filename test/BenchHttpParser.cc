@@ -0,0 +1,133 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-21 15:02:44
+ * @Contact: 2458006466@qq.com
+ * @Description: BenchHttpParser
+ */
+#include "Http/HttpParser.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+using namespace NAMESPACE;
+
+static const std::string kRequest =
+  "GET /image.html HTTP/1.1\r\n"
+  "Host: 127.0.0.1:8080\r\n"
+  "Connection: keep-alive\r\n"
+  "Cache-Control: max-age=0\r\n"
+  "Upgrade-Insecure-Requests: 1\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/129.0.0.0 Safari/537.36\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+  "Referer: http://127.0.0.1:8080/welcome.html\r\n"
+  "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+  "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+  "Cookie: sid=8c1f0e2b7d4a4b9a; theme=dark; lang=zh-CN\r\n"
+  "\r\n";
+
+/// @brief 原HttpContext基于std::regex的逐行解析实现，作为对照
+class LegacyParser {
+public:
+  bool Parse(Buffer *buffer) {
+    int state = 0;
+    while (buffer->ReadableBytes() > 0) {
+      const char *crlf = buffer->FindCRLF();
+      std::string line(buffer->peek(), crlf);
+      if (state == 0) {
+        std::regex pattern("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+        std::smatch match;
+        if (!std::regex_match(line, match, pattern)) {
+          return false;
+        }
+        method_ = match[1].str();
+        path_ = match[2].str();
+        version_ = match[3].str();
+        state = 1;
+      } else {
+        std::regex pattern("^([^:]*): ?(.*)$");
+        std::smatch match;
+        if (!std::regex_match(line, match, pattern)) {
+          buffer->RetrieveUtil(crlf + 2);
+          break;
+        }
+        headers_[match[1].str()] = match[2].str();
+      }
+      buffer->RetrieveUtil(crlf + 2);
+    }
+    return true;
+  }
+
+  void Reset() {
+    method_.clear();
+    path_.clear();
+    version_.clear();
+    headers_.clear();
+  }
+
+private:
+  std::string method_;
+  std::string path_;
+  std::string version_;
+  std::unordered_map<std::string, std::string> headers_;
+};
+
+static double RequestsPerSecond(int64_t requests, Timestamp start) {
+  double seconds = (Timestamp::Now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+  return requests / seconds;
+}
+
+static void BenchLegacy(int iterations) {
+  LegacyParser parser;
+  Buffer buffer;
+  Timestamp start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    buffer.Append(kRequest);
+    CHECK(parser.Parse(&buffer));
+    parser.Reset();
+  }
+  LogInfo("legacy regex parser: {:.0f} requests/sec", RequestsPerSecond(iterations, start));
+}
+
+static void BenchStateMachine(int iterations) {
+  HttpParser parser;
+  Buffer buffer;
+  Timestamp start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    buffer.Append(kRequest);
+    CHECK_EQ(parser.Parse(buffer.peek(), buffer.ReadableBytes()), HttpParser::kComplete);
+    buffer.Retrieve(parser.headSize());
+    parser.Reset();
+  }
+  LogInfo("state machine parser: {:.0f} requests/sec", RequestsPerSecond(iterations, start));
+}
+
+/// @brief 每个请求拆成多段到达，衡量断点续解析的开销
+static void BenchFragmented(int iterations, size_t segment) {
+  HttpParser parser;
+  Buffer buffer;
+  Timestamp start = Timestamp::Now();
+  for (int i = 0; i < iterations; ++i) {
+    HttpParser::Status status = HttpParser::kNeedMore;
+    for (size_t off = 0; off < kRequest.size(); off += segment) {
+      buffer.Append(kRequest.data() + off, std::min(segment, kRequest.size() - off));
+      status = parser.Parse(buffer.peek(), buffer.ReadableBytes());
+    }
+    CHECK_EQ(status, HttpParser::kComplete);
+    buffer.Retrieve(parser.headSize());
+    parser.Reset();
+  }
+  LogInfo("state machine parser, {}-byte segments: {:.0f} requests/sec", segment, RequestsPerSecond(iterations, start));
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+  LogInfo("request size {} bytes, {} iterations, single core.", kRequest.size(), iterations);
+  BenchLegacy(iterations / 20);
+  BenchStateMachine(iterations);
+  BenchFragmented(iterations, 64);
+  BenchFragmented(iterations, 7);
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-14 17:08:36
+ * @Contact: 2458006466@qq.com
+ * @Description: BenchKeepAlive
+ */
+#include "Http/HttpServer.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kPort = 18183;
+static const std::string kRequest = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+static const std::string kLastRequest = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+
+static int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(fd >= 0);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < 100; ++i) {
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+      return fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  CHECK(false) << "connect failed";
+  return -1;
+}
+
+/// @brief 读取一个完整的响应(头部及Content-Length指定的响应体)
+static void ReadResponse(int fd, std::string *pending) {
+  char buf[4096];
+  size_t head_end = std::string::npos;
+  size_t total = 0;
+  while (true) {
+    if (head_end == std::string::npos) {
+      head_end = pending->find("\r\n\r\n");
+      if (head_end != std::string::npos) {
+        size_t pos = pending->find("Content-Length: ");
+        CHECK(pos != std::string::npos && pos < head_end);
+        total = head_end + 4 + static_cast<size_t>(atol(pending->c_str() + pos + 16));
+      }
+    }
+    if (head_end != std::string::npos && pending->size() >= total) {
+      pending->erase(0, total);
+      return;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf));
+    CHECK_GT(n, 0) << "connection closed before the response completed";
+    pending->append(buf, n);
+  }
+}
+
+/// @brief 每个客户端线程顺序发送请求，每条连接的第per_conn个请求带Connection: close，
+/// 读完响应后重新连接；per_conn为0时只使用一条连接
+static void RunClient(int per_conn, int requests, std::atomic<int64_t> *connections) {
+  std::string pending;
+  int fd = -1;
+  for (int i = 0; i < requests; ++i) {
+    if (fd < 0) {
+      fd = Connect();
+      ++*connections;
+    }
+    bool last = per_conn > 0 && i % per_conn == per_conn - 1;
+    const std::string &request = last ? kLastRequest : kRequest;
+    CHECK_EQ(write(fd, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+    ReadResponse(fd, &pending);
+    if (last) {
+      close(fd);
+      fd = -1;
+      pending.clear();
+    }
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+static void Bench(int per_conn, int threads, int requests) {
+  std::atomic<int64_t> connections(0);
+  std::vector<std::thread> clients;
+  // 服务端每个请求都有info日志，计时期间关闭
+  setLogLevel(3);
+  Timestamp start = Timestamp::Now();
+  for (int i = 0; i < threads; ++i) {
+    clients.emplace_back(RunClient, per_conn, requests / threads, &connections);
+  }
+  for (std::thread &client : clients) {
+    client.join();
+  }
+  double seconds = (Timestamp::Now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+  setLogLevel(2);
+  std::string label = per_conn > 0 ? std::to_string(per_conn) : "unlimited";
+  LogInfo("{:>9} requests/connection: {:>8.0f} requests/sec, {} connections", label, requests / seconds,
+          connections.load());
+}
+
+int main(int argc, char *argv[]) {
+  int requests = argc > 1 ? atoi(argv[1]) : 40000;
+  int threads = argc > 2 ? atoi(argv[2]) : 4;
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress("127.0.0.1", kPort), "bench-keep-alive", "/nonexistent");
+  // 连接的请求数由客户端控制，服务端不限
+  server.setKeepAlive(60, 0);
+  server.Get("/hello", [](const HttpRequest &, HttpResponse *resp) {
+    resp->MakeResponse("hello", "text/plain");
+  });
+  server.Start();
+
+  std::thread bench([&loop, requests, threads]() {
+    LogInfo("{} requests per round, {} client threads, 4 IO threads.", requests, threads);
+    for (int per_conn : { 1, 2, 4, 16, 64, 256, 0 }) {
+      Bench(per_conn, threads, requests);
+    }
+    loop.QueueInLoop(std::bind(&EventLoop::Quit, &loop));
+  });
+  loop.Loop();
+  bench.join();
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-19 09:36:52
+ * @Contact: 2458006466@qq.com
+ * @Description: TestAccountHandler
+ */
+#include "Http/AccountHandler.h"
+#include "Http/HttpServer.h"
+#include "Database/MappedUserStore.h"
+#include "Base/Logger.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace NAMESPACE;
+
+static const int kPort = 18185;
+static const char *const kLoginPage = "<html>login page</html>";
+static const char *const kWelcomePage = "<html>welcome page</html>";
+
+static int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(fd >= 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < 100; ++i) {
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+      return fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  CHECK(false) << "connect failed";
+  return -1;
+}
+
+/// @brief 发送一个请求并读取到服务端关闭连接为止
+static std::string Request(const std::string &request) {
+  int fd = Connect();
+  CHECK_EQ(write(fd, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+  std::string data;
+  char buf[4096];
+  ssize_t n = 0;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    data.append(buf, n);
+  }
+  close(fd);
+  return data;
+}
+
+static std::string Get(const std::string &path, const std::string &cookie = "") {
+  std::string request = "GET " + path + " HTTP/1.1\r\nConnection: close\r\n";
+  if (!cookie.empty()) {
+    request += "Cookie: " + cookie + "\r\n";
+  }
+  return Request(request + "\r\n");
+}
+
+static std::string Body(const std::string &response) {
+  size_t pos = response.find("\r\n\r\n");
+  return pos == std::string::npos ? std::string() : response.substr(pos + 4);
+}
+
+static void WriteFile(const std::string &path, const char *content) {
+  FILE *fp = fopen(path.c_str(), "w");
+  CHECK(fp != nullptr) << path;
+  fputs(content, fp);
+  fclose(fp);
+}
+
+static void RunClient(EventLoop *loop) {
+  // 1.没有会话时，会员页面的各种路径写法都返回登录页面
+  const char *paths[] = {
+    "/welcome", "/welcome.html", "//welcome.html", "/./welcome.html",
+    "/x/../welcome.html", "/x/..//./welcome.html", "//welcome",
+  };
+  for (const char *path : paths) {
+    std::string response = Get(path);
+    CHECK_EQ(Body(response), kLoginPage) << path << "\n" << response;
+  }
+  // 越过根目录的路径直接拒绝
+  CHECK(Get("/../welcome.html").find("HTTP/1.1 400") == 0);
+
+  // 2.注册后持有会话，同样的路径返回会员页面
+  std::string form = "username=alice&password=secret";
+  std::string response = Request("POST /register HTTP/1.1\r\nConnection: close\r\n"
+                                  "Content-Type: application/x-www-form-urlencoded\r\n"
+                                  "Content-Length: " + std::to_string(form.size()) + "\r\n\r\n" + form);
+  size_t pos = response.find("Set-Cookie: ");
+  CHECK(pos != std::string::npos) << response;
+  std::string cookie = response.substr(pos + 12, response.find(';', pos) - pos - 12);
+  for (const char *path : paths) {
+    CHECK_EQ(Body(Get(path, cookie)), kWelcomePage) << path;
+  }
+  loop->QueueInLoop(std::bind(&EventLoop::Quit, loop));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  char dir[] = "/tmp/TestAccountHandler.XXXXXX";
+  CHECK(mkdtemp(dir) != nullptr);
+  std::string root = dir;
+  WriteFile(root + "/login.html", kLoginPage);
+  WriteFile(root + "/welcome.html", kWelcomePage);
+
+  MappedUserStore::Options options;
+  options.path = root + "/users.log";
+  AccountHandler::setUserStore(std::unique_ptr<UserStore>(new MappedUserStore(options)));
+
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress("127.0.0.1", kPort), "account-test", root);
+  AccountHandler::Install(&server);
+  server.Start();
+  std::thread client(RunClient, &loop);
+  loop.Loop();
+  client.join();
+
+  AccountHandler::setUserStore(nullptr);
+  unlink((root + "/login.html").c_str());
+  unlink((root + "/welcome.html").c_str());
+  unlink(options.path.c_str());
+  rmdir(dir);
+  LogInfo("TestAccountHandler passed.");
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-25 15:12:08
+ * @Contact: 2458006466@qq.com
+ * @Description: TestAssetBundle
+ */
+#include "Http/AssetBundle.h"
+#include "Base/Logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <zlib.h>
+
+using namespace NAMESPACE;
+
+static void WriteFile(const std::string &path, const std::string &content) {
+  FILE *fp = fopen(path.c_str(), "w");
+  CHECK(fp) << path;
+  fwrite(content.data(), 1, content.size(), fp);
+  fclose(fp);
+}
+
+static std::string Gunzip(const StringPiece &data) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  CHECK_EQ(inflateInit2(&zs, 15 + 16), Z_OK);
+  std::string out(1 << 20, '\0');
+  zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+  zs.avail_out = static_cast<uInt>(out.size());
+  CHECK_EQ(inflate(&zs, Z_FINISH), Z_STREAM_END);
+  out.resize(zs.total_out);
+  inflateEnd(&zs);
+  return out;
+}
+
+int main(int argc, char *argv[]) {
+  char dir[] = "/tmp/TestAssetBundleXXXXXX";
+  CHECK(mkdtemp(dir));
+  std::string root = dir;
+  mkdir((root + "/sub").c_str(), 0755);
+
+  // 1.足够多的文件以覆盖含多个路径的哈希桶
+  std::map<std::string, std::string> files;
+  for (int i = 0; i < 300; ++i) {
+    files["/page" + std::to_string(i) + ".html"] = "<html>" + std::string(i * 7, 'a' + i % 26) + "</html>";
+  }
+  files["/sub/app.js"] = "var x = 1;";
+  files["/sub/logo.png"] = std::string(1000, '\x89');
+  files["/empty.txt"] = "";
+  for (const auto &file : files) {
+    WriteFile(root + file.first, file.second);
+  }
+  WriteFile(root + "/.hidden", "secret");
+  std::string bundle_path = root + ".bundle";
+  CHECK(AssetBundle::Pack(root, bundle_path));
+
+  // 2.所有文件均可找到且内容一致，gzip版本可解压还原
+  std::shared_ptr<AssetBundle> bundle = AssetBundle::Open(bundle_path);
+  CHECK(bundle);
+  CHECK_EQ(bundle->size(), files.size());
+  for (const auto &file : files) {
+    AssetBundle::Asset asset;
+    CHECK(bundle->Find(file.first, &asset)) << file.first;
+    CHECK_EQ(asset.path.ToString(), file.first);
+    CHECK_EQ(asset.body.ToString(), file.second);
+    CHECK_EQ(reinterpret_cast<uintptr_t>(asset.body.data()) % AssetBundle::kAlignment, 0u);
+    std::string length = "Content-Length: " + std::to_string(file.second.size()) + "\r\n";
+    CHECK_EQ(asset.headers.ToString().rfind(length), asset.headers.size() - length.size());
+    CHECK(asset.headers.ToString().find("ETag: " + asset.etag.ToString()) != std::string::npos);
+    CHECK(asset.headers.ToString().find("Last-Modified: ") != std::string::npos);
+    CHECK(asset.last_modified > 0);
+    if (!asset.gzip_body.empty()) {
+      CHECK_EQ(Gunzip(asset.gzip_body), file.second);
+      CHECK(asset.gzip_headers.ToString().find("Content-Encoding: gzip\r\n") != std::string::npos);
+      CHECK(asset.gzip_etag != asset.etag);
+      CHECK(asset.gzip_headers.ToString().find("ETag: " + asset.gzip_etag.ToString()) != std::string::npos);
+    }
+  }
+  AssetBundle::Asset asset;
+  CHECK(bundle->Find("/page299.html", &asset) && !asset.gzip_body.empty());
+  CHECK(bundle->Find("/sub/logo.png", &asset) && asset.gzip_body.empty());
+  CHECK_EQ(asset.mime.ToString(), "image/png");
+  CHECK(!bundle->Find("/.hidden", &asset));
+  CHECK(!bundle->Find("/missing.html", &asset));
+  CHECK(!bundle->Find("/page1.htm", &asset));
+
+  // 3.损坏的包拒绝加载
+  WriteFile(root + ".bad", "MIRRORAB garbage");
+  CHECK(!AssetBundle::Open(root + ".bad"));
+
+  unlink((root + ".bad").c_str());
+  unlink(bundle_path.c_str());
+  LogInfo("TestAssetBundle passed.");
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-04 16:41:09
+ * @Contact: 2458006466@qq.com
+ * @Description: TestAsyncMysql
+ */
+#include "Database/AsyncMysqlClient.h"
+#include "Core/EventLoop.h"
+#include "Base/CurrentThread.h"
+#include "Base/Logger.h"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NAMESPACE;
+
+/// @brief 设置环境变量MIRROR_MYSQL="host:port:user:passwd:dbname"时连接本地MariaDB/MySQL
+/// 执行真实查询，否则连接一个不可用的端口，校验失败同样在loop中回调
+static bool ParseEnv(AsyncMysqlClient::Options *options) {
+  const char *env = getenv("MIRROR_MYSQL");
+  if (!env) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(env);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  CHECK_EQ(fields.size(), 5u) << "MIRROR_MYSQL=host:port:user:passwd:dbname";
+  options->host = fields[0];
+  options->port = static_cast<unsigned int>(atoi(fields[1].c_str()));
+  options->user = fields[2];
+  options->passwd = fields[3];
+  options->dbname = fields[4];
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  AsyncMysqlClient::Options options;
+  options.host = "127.0.0.1";
+  options.port = 1;
+  options.max_connections = 32;
+  bool live = ParseEnv(&options);
+  LogInfo("AsyncMysqlClient non-blocking: {}, live database: {}.", AsyncMysqlClient::NonBlocking(), live);
+
+  const int kQueries = 2000;
+  EventLoop loop;
+  int loop_tid = CurrentThread::tid();
+  int completed = 0;
+  int failed = 0;
+  size_t max_in_flight = 0;
+  AsyncMysqlClient client(&loop, options);
+  auto on_result = [&](int n, const AsyncMysqlClient::Result &result) {
+    CHECK_EQ(CurrentThread::tid(), loop_tid);
+    if (live) {
+      CHECK(result.ok()) << result.message;
+      MYSQL_ROW row = mysql_fetch_row(result.rows);
+      CHECK(row && atoi(row[0]) == n);
+    } else {
+      CHECK(!result.ok() && !result.rows);
+    }
+    ++completed;
+    failed += result.ok() ? 0 : 1;
+    if (completed == kQueries) {
+      loop.Quit();
+    }
+  };
+
+  // 一半在loop线程中提交，一半从其他线程提交
+  loop.RunInLoop([&]() {
+    for (int i = 0; i < kQueries / 2; ++i) {
+      client.Query("SELECT " + std::to_string(i), std::bind(on_result, i, std::placeholders::_1));
+      max_in_flight = std::max(max_in_flight, client.inFlight());
+    }
+  });
+  std::thread producer([&]() {
+    for (int i = kQueries / 2; i < kQueries; ++i) {
+      client.Query("SELECT " + std::to_string(i), std::bind(on_result, i, std::placeholders::_1));
+    }
+  });
+  loop.Loop();
+  producer.join();
+
+  CHECK_EQ(completed, kQueries);
+  CHECK_EQ(client.inFlight(), 0u);
+  int expected_failed = live ? 0 : kQueries;
+  CHECK_EQ(failed, expected_failed);
+  LogInfo("completed {} queries, max in flight {}.", completed, max_in_flight);
+  LogInfo("TestAsyncMysql passed.");
+  return 0;
+}
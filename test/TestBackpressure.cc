@@ -0,0 +1,288 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-18 10:42:17
+ * @Contact: 2458006466@qq.com
+ * @Description: TestBackpressure
+ */
+#include "Core/TcpServer.h"
+#include "Http/HttpServer.h"
+#include "Base/Logger.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace NAMESPACE;
+
+static const int kPort = 18183;
+static const int kBudgetPort = 18184;
+static const int kPipelinePort = 18186;
+/// @brief 远大于内核收发缓冲区，慢速对端不读取时大部分留在连接的发送缓冲区中
+static const size_t kBlob = 16 * 1024 * 1024;
+static const size_t kHighWater = 1024 * 1024;
+static const size_t kLowWater = 256 * 1024;
+static const size_t kMaxOutput = 1024 * 1024;
+/// @brief 暂停读取期间等待的时间，其间发来的命令不应被处理
+static const int kPausedMs = 300;
+/// @brief 管线化队列的响应个数及字节数上限，/big的响应体大小
+static const size_t kMaxPipeline = 4;
+static const size_t kMaxPipelineBytes = 256 * 1024;
+static const size_t kBigBody = 100 * 1024;
+
+/// @brief 按行处理命令：big回复kBlob字节，ping回复pong并计数
+class BlobServer {
+public:
+  BlobServer(EventLoop *loop, int port, const std::string &name, size_t high_water) :
+    server_(loop, InetAddress("127.0.0.1", port), name),
+    high_water_(high_water),
+    pings_(0) {
+    server_.setConnectionCallback(std::bind(&BlobServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&BlobServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+  }
+
+  TcpServer &server() {
+    return server_;
+  }
+
+  int pings() const {
+    return pings_;
+  }
+
+private:
+  void onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected() && high_water_ > 0) {
+      conn->setHighWaterMarkCallback(HighWaterMarkCallback(), high_water_);
+      conn->setLowWaterMark(kLowWater);
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    const char *eol = nullptr;
+    while ((eol = std::find(buf->peek(), static_cast<const char *>(buf->beginWrite()), '\n')) != buf->beginWrite()) {
+      std::string cmd(buf->peek(), eol);
+      buf->Retrieve(eol - buf->peek() + 1);
+      if (cmd == "big") {
+        conn->Send(std::string(kBlob, 'x'));
+      } else if (cmd == "ping") {
+        ++pings_;
+        conn->Send("pong");
+      }
+    }
+  }
+
+  TcpServer server_;
+  size_t high_water_;
+  std::atomic<int> pings_;
+};
+
+/// @brief /block在阻塞线程中等待放行，/small及/big同步处理并计数
+class PipelineServer {
+public:
+  PipelineServer(EventLoop *loop) :
+    server_(loop, InetAddress("127.0.0.1", kPipelinePort), "pipeline-test", "/tmp"),
+    released_(false),
+    handled_(0) {
+    server_.setMaxPipeline(kMaxPipeline, kMaxPipelineBytes);
+    server_.Route(HttpRequest::kGet, "/block", [this](const HttpRequest &, HttpResponse *resp) {
+      while (!released_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+      resp->MakeResponse("block", "text/plain");
+    }, true);
+    server_.Get("/small", [this](const HttpRequest &, HttpResponse *resp) {
+      ++handled_;
+      resp->MakeResponse("small", "text/plain");
+    });
+    server_.Get("/big", [this](const HttpRequest &, HttpResponse *resp) {
+      ++handled_;
+      resp->MakeResponse(std::string(kBigBody, 'b'), "text/plain");
+    });
+  }
+
+  HttpServer &server() {
+    return server_;
+  }
+
+  void setReleased(bool released) {
+    released_ = released;
+  }
+
+  int handled() const {
+    return handled_;
+  }
+
+private:
+  HttpServer server_;
+  std::atomic<bool> released_;
+  std::atomic<int> handled_;
+};
+
+/// @brief 以很小的接收缓冲区连接，模拟慢速对端
+static int Connect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(fd >= 0);
+  int rcvbuf = 4096;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  struct timeval timeout = { 10, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < 100; ++i) {
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+      return fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  CHECK(false) << "connect failed";
+  return -1;
+}
+
+static void SendAll(int fd, const std::string &data) {
+  CHECK_EQ(write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+}
+
+/// @brief 读取恰好n字节
+static std::string ReadN(int fd, size_t n) {
+  std::string data;
+  char buf[65536];
+  while (data.size() < n) {
+    ssize_t len = read(fd, buf, std::min(sizeof(buf), n - data.size()));
+    CHECK_GT(len, 0) << "read " << data.size() << " of " << n << " bytes";
+    data.append(buf, len);
+  }
+  return data;
+}
+
+/// @brief 读取n个响应，返回响应体总字节数
+static size_t ReadResponses(int fd, int n) {
+  std::string data;
+  size_t body_bytes = 0;
+  char buf[65536];
+  for (int i = 0; i < n; ++i) {
+    size_t end = std::string::npos;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t len = read(fd, buf, sizeof(buf));
+      CHECK_GT(len, 0) << "read response " << i << " of " << n;
+      data.append(buf, len);
+    }
+    size_t pos = data.find("Content-Length: ");
+    CHECK(pos != std::string::npos && pos < end) << data.substr(0, end);
+    size_t length = std::stoul(data.substr(pos + 16));
+    data.erase(0, end + 4);
+    if (data.size() < length) {
+      data += ReadN(fd, length - data.size());
+    }
+    data.erase(0, length);
+    body_bytes += length;
+  }
+  CHECK(data.empty());
+  return body_bytes;
+}
+
+/// @brief 发送count个管线化请求
+static std::string Pipelined(const std::string &path, int count) {
+  std::string requests;
+  for (int i = 0; i < count; ++i) {
+    requests += "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  }
+  return requests;
+}
+
+/// @brief 等待服务器发送缓冲区总量满足条件
+static bool WaitOutput(TcpServer &server, size_t min_bytes, size_t max_bytes) {
+  for (int i = 0; i < 500; ++i) {
+    size_t bytes = server.outputBytes();
+    if (bytes >= min_bytes && bytes <= max_bytes) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+static void RunClient(EventLoop *loop, BlobServer *watermark, BlobServer *budget,
+                      PipelineServer *pipeline) {
+  // 1.单连接积压超过高水位后暂停读取，期间的命令留在内核中
+  int fd = Connect(kPort);
+  SendAll(fd, "big\n");
+  CHECK(WaitOutput(watermark->server(), kHighWater, kBlob));
+  SendAll(fd, "ping\n");
+  std::this_thread::sleep_for(std::chrono::milliseconds(kPausedMs));
+  CHECK_EQ(watermark->pings(), 0);
+
+  // 2.对端取走数据，积压回落到低水位后恢复读取，处理暂停期间的命令
+  std::string blob = ReadN(fd, kBlob);
+  CHECK_EQ(static_cast<size_t>(std::count(blob.begin(), blob.end(), 'x')), kBlob);
+  CHECK_EQ(ReadN(fd, 4), "pong");
+  CHECK_EQ(watermark->pings(), 1);
+  CHECK(WaitOutput(watermark->server(), 0, 0));
+  close(fd);
+
+  // 3.服务器总量超限时只暂停有积压的连接，其他连接照常读取
+  int slow = Connect(kBudgetPort);
+  int fast = Connect(kBudgetPort);
+  SendAll(slow, "big\n");
+  CHECK(WaitOutput(budget->server(), kMaxOutput, kBlob));
+  SendAll(slow, "ping\n");
+  SendAll(fast, "ping\n");
+  CHECK_EQ(ReadN(fast, 4), "pong");
+  std::this_thread::sleep_for(std::chrono::milliseconds(kPausedMs));
+  CHECK_EQ(budget->pings(), 1);
+
+  // 4.总量回落到上限以下后积压连接恢复读取
+  ReadN(slow, kBlob);
+  CHECK_EQ(ReadN(slow, 4), "pong");
+  CHECK_EQ(budget->pings(), 2);
+  CHECK(WaitOutput(budget->server(), 0, 0));
+  close(slow);
+  close(fast);
+
+  // 5.队首阻塞处理函数未完成时，管线化队列达到响应个数上限后停止解析
+  fd = Connect(kPipelinePort);
+  SendAll(fd, Pipelined("/block", 1) + Pipelined("/small", 10));
+  std::this_thread::sleep_for(std::chrono::milliseconds(kPausedMs));
+  CHECK_EQ(pipeline->handled(), static_cast<int>(kMaxPipeline) - 1);
+
+  // 6.放行后队列发出并回落，继续解析接收缓冲区中剩余的请求
+  pipeline->setReleased(true);
+  CHECK_EQ(ReadResponses(fd, 11), 5 + 10 * 5);
+  CHECK_EQ(pipeline->handled(), 10);
+
+  // 7.队列中响应字节数达到上限后同样停止解析
+  pipeline->setReleased(false);
+  SendAll(fd, Pipelined("/block", 1) + Pipelined("/big", 5));
+  std::this_thread::sleep_for(std::chrono::milliseconds(kPausedMs));
+  CHECK_EQ(pipeline->handled(), 10 + static_cast<int>(kMaxPipelineBytes / kBigBody) + 1);
+  pipeline->setReleased(true);
+  CHECK_EQ(ReadResponses(fd, 6), 5 + 5 * kBigBody);
+  CHECK_EQ(pipeline->handled(), 15);
+  close(fd);
+  loop->QueueInLoop(std::bind(&EventLoop::Quit, loop));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  EventLoop loop;
+  // 单连接高低水位，服务器总量不限
+  BlobServer watermark(&loop, kPort, "watermark-test", kHighWater);
+  // 单连接水位保持默认(远大于kBlob)，只由服务器总量限制
+  BlobServer budget(&loop, kBudgetPort, "budget-test", 0);
+  budget.server().setMaxOutputBytes(kMaxOutput);
+  watermark.server().Start();
+  budget.server().Start();
+  PipelineServer pipeline(&loop);
+  pipeline.server().Start();
+  std::thread client(RunClient, &loop, &watermark, &budget, &pipeline);
+  loop.Loop();
+  client.join();
+  LogInfo("TestBackpressure passed.");
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-01 15:36:52
+ * @Contact: 2458006466@qq.com
+ * @Description: TestBlockingHandler
+ */
+#include "Http/HttpServer.h"
+#include "Base/Logger.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kPort = 18181;
+static const int kSlowMs = 200;
+
+static int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(fd >= 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < 100; ++i) {
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+      return fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  CHECK(false) << "connect failed";
+  return -1;
+}
+
+static void SendAll(int fd, const std::string &data) {
+  CHECK_EQ(write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+}
+
+/// @brief 读取到服务端关闭连接为止
+static std::string ReadAll(int fd) {
+  std::string data;
+  char buf[4096];
+  ssize_t n = 0;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    data.append(buf, n);
+  }
+  close(fd);
+  return data;
+}
+
+static int64_t ElapsedMs(const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunClient(HttpServer *server, EventLoop *loop) {
+  // 1.阻塞处理函数不影响其他连接，同一连接上的响应保持请求顺序
+  auto start = std::chrono::steady_clock::now();
+  int slow = Connect();
+  SendAll(slow, "GET /slow HTTP/1.1\r\n\r\nGET /fast HTTP/1.1\r\nConnection: close\r\n\r\n");
+  std::vector<int> fast;
+  for (int i = 0; i < 8; ++i) {
+    fast.push_back(Connect());
+    SendAll(fast.back(), "GET /fast HTTP/1.1\r\nConnection: close\r\n\r\n");
+  }
+  for (int fd : fast) {
+    CHECK(ReadAll(fd).find("\r\n\r\nfast") != std::string::npos);
+  }
+  CHECK_LT(ElapsedMs(start), kSlowMs);
+  std::string pipelined = ReadAll(slow);
+  size_t slow_pos = pipelined.find("\r\n\r\nslow");
+  size_t fast_pos = pipelined.find("\r\n\r\nfast");
+  CHECK(slow_pos != std::string::npos && fast_pos != std::string::npos && slow_pos < fast_pos) << pipelined;
+  CHECK_GE(ElapsedMs(start), kSlowMs);
+
+  // 2.只重写路径的阻塞处理函数，由loop发送文件
+  int rewrite = Connect();
+  SendAll(rewrite, "GET /rewrite HTTP/1.1\r\nConnection: close\r\n\r\n");
+  std::string response = ReadAll(rewrite);
+  CHECK(response.find("HTTP/1.1 404 Not Found\r\n") == 0) << response;
+
+  // 3.队列已满时回复503
+  std::vector<int> fds;
+  for (int i = 0; i < 3; ++i) {
+    fds.push_back(Connect());
+    SendAll(fds.back(), "GET /slow HTTP/1.1\r\nConnection: close\r\n\r\n");
+  }
+  int rejected = 0;
+  for (int fd : fds) {
+    response = ReadAll(fd);
+    if (response.find("HTTP/1.1 503 Service Unavailable\r\n") == 0) {
+      ++rejected;
+    } else {
+      CHECK(response.find("HTTP/1.1 200 OK\r\n") == 0) << response;
+    }
+  }
+  CHECK_GE(rejected, 1);
+
+  ThreadPool::Stats stats = server->blockingStats();
+  CHECK_EQ(stats.queue_size, 0u);
+  CHECK_GE(stats.executed, 4u - rejected);
+  CHECK_GE(stats.rejected, static_cast<uint64_t>(rejected));
+  LogInfo("blocking stats: executed {}, rejected {}, total wait {}us, max wait {}us.",
+          stats.executed, stats.rejected, stats.total_wait_us, stats.max_wait_us);
+  loop->QueueInLoop(std::bind(&EventLoop::Quit, loop));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress("127.0.0.1", kPort), "blocking-test", "/nonexistent");
+  server.setBlockingThreadNum(1, 1);
+  server.Route(HttpRequest::kGet, "/slow", [](const HttpRequest &, HttpResponse *resp) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSlowMs));
+    resp->MakeResponse("slow", "text/plain");
+  }, true);
+  server.Get("/fast", [](const HttpRequest &, HttpResponse *resp) {
+    resp->MakeResponse("fast", "text/plain");
+  });
+  server.Route(HttpRequest::kGet, "/rewrite", [](const HttpRequest &, HttpResponse *resp) {
+    resp->setPath("/missing.html");
+  }, true);
+  server.Start();
+  std::thread client(RunClient, &server, &loop);
+  loop.Loop();
+  client.join();
+  LogInfo("TestBlockingHandler passed.");
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-08 11:06:45
+ * @Contact: 2458006466@qq.com
+ * @Description: TestBloomFilter
+ */
+#include "Base/BloomFilter.h"
+#include "Base/Logger.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kItems = 20000;
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  BloomFilter filter(kItems, 0.01);
+  CHECK(!filter.MightContain("user0"));
+
+  // 1.写入的同时读取，已添加的元素一定命中
+  std::thread writer([&filter]() {
+    for (int i = 0; i < kItems; ++i) {
+      filter.Add("user" + std::to_string(i));
+    }
+  });
+  std::thread reader([&filter]() {
+    for (int i = 0; i < kItems; ++i) {
+      filter.MightContain("user" + std::to_string(i));
+    }
+  });
+  writer.join();
+  reader.join();
+  CHECK_EQ(filter.size(), static_cast<size_t>(kItems));
+  for (int i = 0; i < kItems; ++i) {
+    CHECK(filter.MightContain("user" + std::to_string(i)));
+  }
+
+  // 2.未添加的元素误判率接近设定值
+  int false_positives = 0;
+  for (int i = 0; i < 10 * kItems; ++i) {
+    false_positives += filter.MightContain("guest" + std::to_string(i)) ? 1 : 0;
+  }
+  double rate = static_cast<double>(false_positives) / (10 * kItems);
+  CHECK_LT(rate, 0.02);
+  LogInfo("bits {}, hashes {}, false positive rate {}.", filter.bits(), filter.hashes(), rate);
+  LogInfo("TestBloomFilter passed.");
+  return 0;
+}
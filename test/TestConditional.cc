@@ -0,0 +1,134 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-28 10:16:42
+ * @Contact: 2458006466@qq.com
+ * @Description: TestConditional
+ */
+#include "Http/HttpResponse.h"
+#include "Http/HttpContext.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+using namespace NAMESPACE;
+
+static void TestHttpDate() {
+  char date[Timestamp::kHttpDateSize];
+  size_t len = Timestamp::FormatHttpDate(784111777, date);
+  CHECK_EQ(std::string(date, len), "Sun, 06 Nov 1994 08:49:37 GMT");
+  for (const char *str : { "Sun, 06 Nov 1994 08:49:37 GMT", "Sunday, 06-Nov-94 08:49:37 GMT",
+                           "Sun Nov  6 08:49:37 1994" }) {
+    time_t seconds = 0;
+    CHECK(Timestamp::ParseHttpDate(str, &seconds)) << str;
+    CHECK_EQ(seconds, 784111777) << str;
+  }
+  time_t seconds = 0;
+  CHECK(!Timestamp::ParseHttpDate("yesterday", &seconds));
+  CHECK(!Timestamp::ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT trailing", &seconds));
+}
+
+/// @brief 解析请求并设置到resp的条件头部
+static void SetConditional(HttpResponse *resp, const std::string &headers, const char *method = "GET") {
+  HttpContext context;
+  Buffer buffer;
+  buffer.Append(std::string(method) + " /a.html HTTP/1.1\r\n" + headers + "\r\n");
+  CHECK(context.ParseRequest(&buffer, Timestamp::Now()) && context.gotAll());
+  resp->Init("", "/a.html", true);
+  resp->setConditional(context.request());
+}
+
+static void TestNotModified() {
+  const std::string etag = "\"abc\"";
+  HttpResponse resp;
+  SetConditional(&resp, "");
+  CHECK(!resp.NotModified(etag, 100));
+  SetConditional(&resp, "If-None-Match: \"abc\"\r\n");
+  CHECK(resp.NotModified(etag, 100));
+  SetConditional(&resp, "If-None-Match: \"x\", W/\"abc\"\r\n");
+  CHECK(resp.NotModified(etag, 100));
+  SetConditional(&resp, "If-None-Match: *\r\n");
+  CHECK(resp.NotModified(etag, 100));
+  SetConditional(&resp, "If-None-Match: \"abcd\"\r\n");
+  CHECK(!resp.NotModified(etag, 100));
+
+  // If-None-Match存在时忽略If-Modified-Since
+  SetConditional(&resp, "If-None-Match: \"x\"\r\nIf-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+  CHECK(!resp.NotModified(etag, 100));
+  SetConditional(&resp, "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+  CHECK(resp.NotModified(etag, 784111777));
+  CHECK(!resp.NotModified(etag, 784111778));
+  SetConditional(&resp, "If-Modified-Since: garbage\r\n");
+  CHECK(!resp.NotModified(etag, 100));
+
+  // 只对GET/HEAD生效
+  SetConditional(&resp, "If-None-Match: \"abc\"\r\nContent-Length: 0\r\n", "POST");
+  CHECK(!resp.NotModified(etag, 100));
+}
+
+static void TestFileResponse() {
+  char dir[] = "/tmp/TestConditionalXXXXXX";
+  CHECK(mkdtemp(dir));
+  std::string root = dir;
+  FILE *fp = fopen((root + "/a.html").c_str(), "w");
+  CHECK(fp);
+  fputs("hello", fp);
+  fclose(fp);
+  struct stat st;
+  CHECK_EQ(stat((root + "/a.html").c_str(), &st), 0);
+  std::string etag = HttpResponse::MakeETag(st);
+
+  // 首次请求返回带校验值的200
+  HttpResponse resp;
+  Buffer head;
+  resp.Init(root, "/a.html", true);
+  std::string cache_control = "Cache-Control: max-age=60\r\n";
+  resp.setExtraHeaders(cache_control);
+  resp.MakeResponse(&head);
+  std::string str = head.RetrieveAllAsString();
+  CHECK(str.find("HTTP/1.1 200 OK\r\n") == 0);
+  CHECK(str.find("ETag: " + etag + "\r\n") != std::string::npos);
+  CHECK(str.find("Last-Modified: ") != std::string::npos);
+  CHECK(str.find(cache_control) != std::string::npos);
+  CHECK_EQ(resp.bodySize(), 5u);
+
+  // 携带ETag再次请求返回无响应体的304
+  HttpContext context;
+  Buffer buffer;
+  buffer.Append("GET /a.html HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n");
+  CHECK(context.ParseRequest(&buffer, Timestamp::Now()) && context.gotAll());
+  resp.Init(root, "/a.html", true);
+  resp.setConditional(context.request());
+  resp.setExtraHeaders(cache_control);
+  resp.MakeResponse(&head);
+  str = head.RetrieveAllAsString();
+  CHECK(str.find("HTTP/1.1 304 Not Modified\r\n") == 0) << str;
+  CHECK(str.find("ETag: " + etag + "\r\n") != std::string::npos);
+  CHECK(str.find(cache_control) != std::string::npos);
+  CHECK(str.find("Content-Length") == std::string::npos);
+  CHECK_EQ(str.rfind("\r\n\r\n"), str.size() - 4);
+  CHECK(!resp.body());
+
+  // 错误页面不带校验值及缓存策略
+  resp.Init(root, "/missing.html", true);
+  resp.setExtraHeaders(cache_control);
+  resp.MakeResponse(&head);
+  str = head.RetrieveAllAsString();
+  CHECK(str.find("ETag") == std::string::npos);
+  CHECK(str.find("Cache-Control") == std::string::npos);
+
+  unlink((root + "/a.html").c_str());
+  rmdir(dir);
+}
+
+int main(int argc, char *argv[]) {
+  TestHttpDate();
+  TestNotModified();
+  TestFileResponse();
+  LogInfo("TestConditional passed.");
+  return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-06 10:12:37
+ * @Contact: 2458006466@qq.com
+ * @Description: TestConnectionPool
+ */
+#include "Database/ConnectionPool.h"
+#include "Base/Logger.h"
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kMinConn = 2;
+static const int kMaxConn = 4;
+static const int kIdleTimeoutMs = 300;
+
+/// @brief 设置环境变量MIRROR_MYSQL="host:port:user:passwd:dbname"时连接本地MariaDB/MySQL
+/// 校验并发获取、超时、FIFO及空闲回收，否则校验数据库不可用时不会阻塞
+static bool ParseEnv(ConnectionPool::Options *options) {
+  const char *env = getenv("MIRROR_MYSQL");
+  if (!env) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(env);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  CHECK_EQ(fields.size(), 5u) << "MIRROR_MYSQL=host:port:user:passwd:dbname";
+  options->url = fields[0];
+  options->port = static_cast<unsigned int>(atoi(fields[1].c_str()));
+  options->user = fields[2];
+  options->passwd = fields[3];
+  options->dbname = fields[4];
+  return true;
+}
+
+static void TestLive(ConnectionPool *pool) {
+  CHECK_EQ(pool->stats().total, kMinConn);
+
+  // 1.线程数超过连接数时排队获取，连接数不超过上限
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2 * kMaxConn; ++i) {
+    threads.emplace_back([pool]() {
+      for (int n = 0; n < 200; ++n) {
+        MYSQL *conn = pool->getConnection(-1);
+        CHECK(conn);
+        std::this_thread::yield();
+        CHECK(pool->ReleaseConnection(conn));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ConnectionPool::Stats stats = pool->stats();
+  CHECK_EQ(stats.checkouts, 1600u);
+  CHECK_EQ(stats.busy, 0);
+  CHECK_LE(stats.total, kMaxConn);
+
+  // 2.线程数不超过连接数时，绝大多数获取命中线程亲和连接
+  threads.clear();
+  for (int i = 0; i < kMaxConn; ++i) {
+    threads.emplace_back([pool]() {
+      for (int n = 0; n < 200; ++n) {
+        MYSQL *conn = pool->getConnection(-1);
+        CHECK(conn);
+        CHECK(pool->ReleaseConnection(conn));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  stats = pool->stats();
+  CHECK_EQ(stats.checkouts, 2400u);
+  CHECK_GT(stats.affinity_hits, 400u);
+  LogInfo("checkouts {}, affinity hits {}, total wait {}us, max wait {}us.",
+          stats.checkouts, stats.affinity_hits, stats.total_wait_us, stats.max_wait_us);
+
+  // 3.连接耗尽时按期限返回
+  std::vector<MYSQL *> held;
+  for (int i = 0; i < kMaxConn; ++i) {
+    held.push_back(pool->getConnection());
+    CHECK(held.back());
+  }
+  CHECK(pool->getConnection(50) == nullptr);
+  CHECK_EQ(pool->stats().timeouts, 1u);
+
+  // 4.等待者按到达顺序获得连接
+  std::mutex mtx;
+  std::vector<int> order;
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < 3; ++i) {
+    waiters.emplace_back([pool, i, &mtx, &order]() {
+      MYSQL *conn = pool->getConnection(-1);
+      CHECK(conn);
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        order.push_back(i);
+      }
+      CHECK(pool->ReleaseConnection(conn));
+    });
+    while (pool->stats().waiting != static_cast<size_t>(i + 1)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  CHECK(pool->ReleaseConnection(held.back()));
+  held.pop_back();
+  for (auto &waiter : waiters) {
+    waiter.join();
+  }
+  CHECK(order == std::vector<int>({0, 1, 2}));
+  for (MYSQL *conn : held) {
+    CHECK(pool->ReleaseConnection(conn));
+  }
+
+  // 5.多余的空闲连接被回收
+  std::this_thread::sleep_for(std::chrono::milliseconds(kIdleTimeoutMs * 3));
+  CHECK_EQ(pool->stats().total, kMinConn);
+
+  // 6.使用中被服务端断开的连接不自动重连，归还时关闭，之后按需重建
+  MYSQL *victim = pool->getConnection();
+  MYSQL *killer = pool->getConnection();
+  CHECK(victim && killer);
+  std::string kill = "KILL " + std::to_string(mysql_thread_id(victim));
+  CHECK_EQ(mysql_query(killer, kill.c_str()), 0);
+  CHECK(pool->ReleaseConnection(killer));
+  CHECK(mysql_query(victim, "SELECT 1") != 0);
+  CHECK_GE(mysql_errno(victim), 2000u);
+  int total = pool->stats().total;
+  CHECK(pool->ReleaseConnection(victim));
+  CHECK_EQ(pool->stats().total, total - 1);
+  {
+    ConnectionPoolRAII raii(pool);
+    CHECK(raii.Execute("SELECT 1"));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  ConnectionPool::Options options;
+  options.url = "127.0.0.1";
+  options.port = 1;
+  options.min_conn = kMinConn;
+  options.max_conn = kMaxConn;
+  options.idle_timeout_ms = kIdleTimeoutMs;
+  options.health_check_ms = 0;
+  bool live = ParseEnv(&options);
+  ConnectionPool *pool = ConnectionPool::getInstance();
+  bool ready = pool->Init(options);
+  if (live) {
+    CHECK(ready);
+    TestLive(pool);
+  } else {
+    // 数据库不可用时立即失败，不等待期限
+    CHECK(!ready);
+    auto start = std::chrono::steady_clock::now();
+    CHECK(pool->getConnection(-1) == nullptr);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    CHECK_GE(pool->stats().connect_failures, static_cast<uint64_t>(kMinConn + 1));
+  }
+  LogInfo("TestConnectionPool passed.");
+  return 0;
+}
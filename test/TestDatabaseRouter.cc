@@ -0,0 +1,155 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-13 14:40:09
+ * @Contact: 2458006466@qq.com
+ * @Description: TestDatabaseRouter
+ */
+#include "Database/DatabaseRouter.h"
+#include "Database/ConnectionPool.h"
+#include "Base/Logger.h"
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kStickyMs = 200;
+static const int kBackoffMs = 100;
+
+/// @brief 设置MIRROR_MYSQL="host:port:user:passwd:dbname"及MIRROR_REPLICAS="port,port"时，
+/// 主库及副本连接本地不同端口上的MariaDB/MySQL，校验按负载选择副本及读己之写；
+/// 否则副本不可用，校验读操作回到主库
+static bool ParseEnv(ConnectionPool::Options *options, std::vector<unsigned int> *replica_ports) {
+  const char *env = getenv("MIRROR_MYSQL");
+  const char *replicas = getenv("MIRROR_REPLICAS");
+  if (!env || !replicas) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(env);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  CHECK_EQ(fields.size(), 5u) << "MIRROR_MYSQL=host:port:user:passwd:dbname";
+  options->url = fields[0];
+  options->port = static_cast<unsigned int>(atoi(fields[1].c_str()));
+  options->user = fields[2];
+  options->passwd = fields[3];
+  options->dbname = fields[4];
+  std::stringstream ports(replicas);
+  while (std::getline(ports, field, ',')) {
+    replica_ports->push_back(static_cast<unsigned int>(atoi(field.c_str())));
+  }
+  CHECK_EQ(replica_ports->size(), 2u) << "MIRROR_REPLICAS=port,port";
+  return true;
+}
+
+static void TestLive(DatabaseRouter *router, ConnectionPool *a, ConnectionPool *b) {
+  // 1.负载相同时轮流选择副本
+  ConnectionPool *first = router->Reader();
+  ConnectionPool *second = router->Reader();
+  CHECK(first != router->primary() && second != router->primary());
+  CHECK(first != second);
+
+  // 2.副本a的连接全部占用时选择b
+  std::vector<MYSQL *> held;
+  for (int i = 0; i < a->options().max_conn; ++i) {
+    held.push_back(a->getConnection());
+    CHECK(held.back());
+  }
+  for (int i = 0; i < 10; ++i) {
+    CHECK(router->Reader() == b);
+  }
+  for (MYSQL *conn : held) {
+    a->ReleaseConnection(conn);
+  }
+
+  // 3.写入后的读操作留在主库，过期后恢复读副本
+  {
+    ConnectionPoolRAII raii(router->Writer("alice"));
+    CHECK(raii.Execute("SELECT 1"));
+  }
+  CHECK(router->Reader("alice") == router->primary());
+  CHECK(router->Reader("bob") != router->primary());
+  std::this_thread::sleep_for(std::chrono::milliseconds(kStickyMs + 50));
+  CHECK(router->Reader("alice") != router->primary());
+  {
+    ConnectionPoolRAII raii(router->Reader("bob"));
+    ResultSet rows = raii.Query("SELECT 1");
+    CHECK(rows.Next());
+  }
+}
+
+static void TestUnavailable(DatabaseRouter *router, ConnectionPool *a, ConnectionPool *b) {
+  // 1.副本不可用时读主库，读己之写仍然生效
+  for (int i = 0; i < 10; ++i) {
+    CHECK(router->Reader() == router->primary());
+  }
+  router->Writer("alice");
+  CHECK(router->Reader("alice") == router->primary());
+  CHECK_EQ(router->stats().replica_reads, 0u);
+  CHECK_EQ(router->stats().sticky_reads, 1u);
+
+  // 2.失败超过退避时长后重新试探，不会因一次失败被永久跳过
+  std::this_thread::sleep_for(std::chrono::milliseconds(kBackoffMs + 50));
+  ConnectionPool *first = router->Reader();
+  CHECK(first == a || first == b);
+  CHECK(first->getConnection() == nullptr);
+  // 试探失败后重新退避，只剩另一个副本
+  ConnectionPool *second = router->Reader();
+  CHECK(second == (first == a ? b : a));
+  CHECK(second->getConnection() == nullptr);
+  CHECK(router->Reader() == router->primary());
+  CHECK_EQ(router->stats().replica_reads, 2u);
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  ConnectionPool::Options options;
+  options.min_conn = 1;
+  options.max_conn = 2;
+  options.checkout_timeout_ms = 200;
+  std::vector<unsigned int> replica_ports;
+  bool live = ParseEnv(&options, &replica_ports);
+  if (!live) {
+    // 拒绝连接的端口，建立连接立即失败
+    options.url = "127.0.0.1";
+    options.port = 1;
+    replica_ports = { 1, 1 };
+  }
+
+  ConnectionPool *primary = ConnectionPool::getInstance();
+  primary->Init(options);
+  ConnectionPool *a = ConnectionPool::getInstance("replica-a");
+  ConnectionPool *b = ConnectionPool::getInstance("replica-b");
+  CHECK(a != primary && a != b && ConnectionPool::getInstance("replica-a") == a);
+  CHECK(ConnectionPool::getInstance("") == primary);
+  options.port = replica_ports[0];
+  a->Init(options);
+  options.port = replica_ports[1];
+  b->Init(options);
+
+  DatabaseRouter::Options router_options;
+  router_options.sticky_ms = kStickyMs;
+  router_options.failure_backoff_ms = kBackoffMs;
+  DatabaseRouter router(primary, router_options);
+  // 没有副本时读写都使用主库，不记录会话
+  CHECK(router.Reader() == primary && router.Writer("alice") == primary);
+  CHECK(router.Reader("alice") == primary);
+  CHECK_EQ(router.stats().sticky_reads, 0u);
+
+  router.AddReplica(a);
+  router.AddReplica(b);
+  CHECK_EQ(router.replicas(), 2u);
+  if (live) {
+    TestLive(&router, a, b);
+  } else {
+    TestUnavailable(&router, a, b);
+  }
+  LogInfo("TestDatabaseRouter passed ({}).", live ? "live" : "unavailable");
+  return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-20 10:12:36
+ * @Contact: 2458006466@qq.com
+ * @Description: TestEventLoop
+ */
+#include "Core/EventLoop.h"
+#include "Core/EventLoopThread.h"
+#include "Base/Logger.h"
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace NAMESPACE;
+
+/// @brief 远小于Poll的超时(10秒)，超过即说明loop没有被及时唤醒
+static const int kQuitMs = 2000;
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+/// @brief 在loop线程中执行一个任务并等待其完成，之后loop空闲阻塞在Poll中
+static void WaitRunning(EventLoop *loop) {
+  std::promise<void> ran;
+  loop->RunInLoop([&ran]() { ran.set_value(); });
+  ran.get_future().wait();
+  // 任务执行后loop还要检查一次quit_，稍等使其确实回到Poll中阻塞
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  // 1.析构EventLoopThread时退出其loop并等待线程结束，而不是在析构线程中重入Loop
+  Clock::time_point start = Clock::now();
+  {
+    EventLoopThread thread(EventLoopThread::ThreadInitCallback(), "test-loop");
+    EventLoop *loop = thread.StartLoop();
+    CHECK(loop != nullptr);
+    WaitRunning(loop);
+  }
+  CHECK_LT(ElapsedMs(start), kQuitMs);
+
+  // 2.其他线程直接调用Quit时唤醒阻塞在Poll中的loop，Loop及时返回
+  std::promise<EventLoop *> created;
+  std::promise<void> exited;
+  std::thread other([&created, &exited]() {
+    EventLoop loop;
+    created.set_value(&loop);
+    loop.Loop();
+    exited.set_value();
+  });
+  EventLoop *loop = created.get_future().get();
+  WaitRunning(loop);
+  start = Clock::now();
+  loop->Quit();
+  CHECK(exited.get_future().wait_for(std::chrono::milliseconds(kQuitMs)) == std::future_status::ready);
+  CHECK_LT(ElapsedMs(start), kQuitMs);
+  other.join();
+
+  LogInfo("TestEventLoop passed.");
+  return 0;
+}
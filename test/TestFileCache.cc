@@ -0,0 +1,130 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-24 15:02:37
+ * @Contact: 2458006466@qq.com
+ * @Description: TestFileCache
+ */
+#include "Http/FileCache.h"
+#include "Base/Logger.h"
+#include "Base/ThreadPool.h"
+#include "Core/EventLoop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace NAMESPACE;
+
+static void WriteFile(const std::string &path, const std::string &content) {
+  FILE *fp = fopen(path.c_str(), "w");
+  CHECK(fp) << path;
+  fwrite(content.data(), 1, content.size(), fp);
+  fclose(fp);
+}
+
+static void TestHitAndEvict(const std::string &root) {
+  WriteFile(root + "/a.html", "aaaa");
+  WriteFile(root + "/b.txt", std::string(3000, 'b'));
+  // 每个分片容量 64KB / 16 = 4KB
+  FileCache cache(root, 64 * 1024, 8192);
+
+  FileCache::EntryPtr a = cache.Get("/a.html");
+  CHECK(a);
+  CHECK_EQ(a->body, "aaaa");
+  // 只含实体头部，状态行及连接等头部在发送时写入
+  CHECK(a->headers.find("Content-Type: text/html\r\n") == 0);
+  CHECK(a->headers.find("ETag: " + a->etag + "\r\n") != std::string::npos);
+  CHECK(a->headers.find("Last-Modified: ") != std::string::npos);
+  CHECK(a->headers.find("Connection") == std::string::npos);
+  CHECK_EQ(a->headers.rfind("Content-Length: 4\r\n"), a->headers.size() - 19);
+  CHECK(cache.Get("/a.html") == a);
+
+  // 不存在、目录及非规范路径不缓存
+  CHECK(!cache.Get("/missing.html"));
+  CHECK(!cache.Get("/"));
+  CHECK(!cache.Get("/./a.html"));
+  CHECK(!cache.Get("//a.html"));
+
+  // 失效后重新加载，已取出的缓存项仍然有效
+  WriteFile(root + "/a.html", "AAAAAA");
+  cache.Invalidate("/a.html");
+  CHECK_EQ(cache.Get("/a.html")->body, "AAAAAA");
+  CHECK(cache.Get("/a.html")->etag != a->etag);
+  CHECK_EQ(a->body, "aaaa");
+
+  // 超出分片容量的文件直接返回，不占用缓存
+  size_t before = cache.bytes();
+  WriteFile(root + "/big.txt", std::string(6000, 'c'));
+  CHECK_EQ(cache.Get("/big.txt")->body.size(), 6000u);
+  CHECK_EQ(cache.bytes(), before);
+  cache.Clear();
+  CHECK_EQ(cache.bytes(), 0u);
+}
+
+static void TestInotify(const std::string &root) {
+  WriteFile(root + "/c.html", "old");
+  EventLoop loop;
+  FileCache cache(root, 64 * 1024, 8192);
+  CHECK(cache.Watch(&loop));
+  CHECK_EQ(cache.Get("/c.html")->body, "old");
+
+  std::thread writer([&]() {
+    WriteFile(root + "/c.html", "new content");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    loop.QueueInLoop([&]() { loop.Quit(); });
+  });
+  loop.Loop();
+  writer.join();
+  CHECK_EQ(cache.Get("/c.html")->body, "new content");
+}
+
+static void TestGzipVariant(const std::string &root) {
+  std::string html;
+  for (int i = 0; i < 200; ++i) {
+    html += "<p>paragraph " + std::to_string(i) + "</p>\n";
+  }
+  WriteFile(root + "/d.html", html);
+  WriteFile(root + "/e.png", std::string(4096, 'e'));
+  ThreadPool pool;
+  pool.Start(1);
+  FileCache cache(root, 1024 * 1024, 64 * 1024);
+  cache.setWorkerPool(&pool);
+
+  // 首次请求提交压缩任务，之后返回gzip版本
+  FileCache::EntryPtr entry = cache.Get("/d.html");
+  CHECK(entry->headers.find("Vary: Accept-Encoding\r\n") != std::string::npos);
+  size_t before = cache.bytes();
+  FileCache::VariantPtr gzip = cache.Compressed(entry);
+  for (int i = 0; i < 200 && !gzip; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    gzip = cache.Compressed(entry);
+  }
+  CHECK(gzip);
+  CHECK(gzip->body.size() < html.size() / 2);
+  CHECK(gzip->headers.find("Content-Encoding: gzip\r\n") != std::string::npos);
+  CHECK(gzip->etag != entry->etag);
+  CHECK(gzip->headers.find("Content-Length: " + std::to_string(gzip->body.size()) + "\r\n") != std::string::npos);
+  CHECK(cache.bytes() > before);
+  CHECK(cache.Compressed(cache.Get("/d.html")) == gzip);
+
+  // 非文本类型不压缩
+  CHECK(!cache.Compressed(cache.Get("/e.png")));
+  pool.Stop();
+}
+
+int main(int argc, char *argv[]) {
+  char dir[] = "/tmp/TestFileCacheXXXXXX";
+  CHECK(mkdtemp(dir));
+  std::string root = dir;
+  TestHitAndEvict(root);
+  TestInotify(root);
+  TestGzipVariant(root);
+  for (const char *name : { "/a.html", "/b.txt", "/big.txt", "/c.html", "/d.html", "/e.png" }) {
+    unlink((root + name).c_str());
+  }
+  rmdir(dir);
+  LogInfo("TestFileCache passed.");
+  return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-28 15:20:44
+ * @Contact: 2458006466@qq.com
+ * @Description: TestGzip
+ */
+#include "Http/Gzip.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include <zlib.h>
+
+using namespace NAMESPACE;
+
+static std::string Gunzip(const char *data, size_t len) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  CHECK_EQ(inflateInit2(&zs, 15 + 16), Z_OK);
+  std::string out(1 << 22, '\0');
+  zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  zs.avail_in = static_cast<uInt>(len);
+  zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+  zs.avail_out = static_cast<uInt>(out.size());
+  CHECK_EQ(inflate(&zs, Z_FINISH), Z_STREAM_END);
+  out.resize(zs.total_out);
+  inflateEnd(&zs);
+  return out;
+}
+
+static void TestAccepted() {
+  CHECK(Gzip::Accepted("gzip"));
+  CHECK(Gzip::Accepted("gzip, deflate, br, zstd"));
+  CHECK(Gzip::Accepted("deflate;q=0.5, GZIP;q=0.8"));
+  CHECK(Gzip::Accepted("*"));
+  CHECK(Gzip::Accepted("x-gzip"));
+  CHECK(!Gzip::Accepted(""));
+  CHECK(!Gzip::Accepted("identity"));
+  CHECK(!Gzip::Accepted("br, deflate"));
+  CHECK(!Gzip::Accepted("gzip;q=0"));
+  CHECK(!Gzip::Accepted("gzip;q=0.0, *"));
+  CHECK(!Gzip::Accepted("*;q=0"));
+  CHECK(!Gzip::Accepted("gzipped"));
+}
+
+static void TestCompress() {
+  std::string body;
+  for (int i = 0; i < 20000; ++i) {
+    body += "<li>item " + std::to_string(i) + "</li>\n";
+  }
+  std::string once;
+  CHECK(Gzip::Compress(body.data(), body.size(), &once));
+  CHECK(once.size() < body.size() / 4);
+  CHECK_EQ(Gunzip(once.data(), once.size()), body);
+
+  // 流式压缩：分段写入，输出直接追加到Buffer
+  Buffer out;
+  Gzip::Stream stream;
+  for (size_t pos = 0; pos < body.size(); pos += 777) {
+    CHECK(stream.Write(body.data() + pos, std::min<size_t>(777, body.size() - pos), &out));
+  }
+  CHECK(stream.Finish(&out));
+  CHECK_EQ(Gunzip(out.peek(), out.ReadableBytes()), body);
+
+  CHECK(Gzip::Compressible("text/html"));
+  CHECK(Gzip::Compressible("application/xhtml+xml"));
+  CHECK(!Gzip::Compressible("image/jpeg"));
+}
+
+int main(int argc, char *argv[]) {
+  TestAccepted();
+  TestCompress();
+  LogInfo("TestGzip passed.");
+  return 0;
+}
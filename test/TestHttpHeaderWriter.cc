@@ -0,0 +1,106 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-30 15:08:21
+ * @Contact: 2458006466@qq.com
+ * @Description: TestHttpHeaderWriter
+ */
+#include "Http/HttpHeaderWriter.h"
+#include "Http/HttpResponse.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace NAMESPACE;
+
+/// @brief 统计本进程的堆分配次数
+static std::atomic<size_t> g_allocations(0);
+
+// 替换的new及delete均不内联，否则GCC在调用处看到malloc与delete配对会误报-Wmismatched-new-delete
+__attribute__((noinline)) void *operator new(size_t size) {
+  ++g_allocations;
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+static void TestFragments() {
+  Buffer buffer;
+  CHECK(HttpHeaderWriter::StatusLine(206, &buffer));
+  CHECK(!HttpHeaderWriter::StatusLine(299, &buffer));
+  HttpHeaderWriter::Connection(true, 60, 99, &buffer);
+  HttpHeaderWriter::Connection(true, 0, 0, &buffer);
+  HttpHeaderWriter::Connection(true, 0, 1, &buffer);
+  HttpHeaderWriter::Connection(false, 60, 99, &buffer);
+  HttpHeaderWriter::ContentTypeOf("/a/b.css", &buffer);
+  HttpHeaderWriter::ContentTypeOf("/noext", &buffer);
+  HttpHeaderWriter::ContentLength(0, &buffer);
+  HttpHeaderWriter::ContentLength(18446744073709551615ull, &buffer);
+  CHECK_EQ(buffer.RetrieveAllAsString(),
+    "HTTP/1.1 206 Partial Content\r\n"
+    "Connection: keep-alive\r\nKeep-Alive: timeout=60, max=99\r\n"
+    "Connection: keep-alive\r\n"
+    "Connection: keep-alive\r\nKeep-Alive: max=1\r\n"
+    "Connection: close\r\n"
+    "Content-Type: text/css\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 0\r\n"
+    "Content-Length: 18446744073709551615\r\n");
+  CHECK(HttpHeaderWriter::MimeType("/x.jpeg") == "image/jpeg");
+  CHECK(HttpHeaderWriter::MimeType("/x.html.bak") == "text/plain");
+  CHECK(HttpHeaderWriter::StatusMessage(404) == "Not Found");
+  CHECK(HttpHeaderWriter::StatusMessage(299).empty());
+
+  // Date为当前时间
+  HttpHeaderWriter::ServerAndDate(&buffer);
+  std::string headers = buffer.RetrieveAllAsString();
+  CHECK(headers.find("Server: ") == 0);
+  size_t pos = headers.find("Date: ");
+  CHECK(pos != std::string::npos);
+  time_t date = 0;
+  CHECK(Timestamp::ParseHttpDate(headers.substr(pos + 6, headers.size() - pos - 8), &date));
+  CHECK(date <= time(nullptr) && date + 2 >= time(nullptr));
+}
+
+static void TestNoAllocation() {
+  HttpResponse resp;
+  resp.Init("", "/a.html", true, 200);
+  std::string cache_control = "Cache-Control: no-cache\r\n";
+  resp.setExtraHeaders(cache_control);
+  Buffer buffer(64 * 1024);
+  // 预热：首次调用格式化Date
+  resp.MakeHead(StringPiece("Content-Type: text/html\r\nContent-Length: 5\r\n"), &buffer);
+  buffer.RetrieveAll();
+
+  size_t before = g_allocations;
+  std::string probe(100, 'x');
+  CHECK_EQ(g_allocations - before, 1u);
+  before = g_allocations;
+  for (int i = 0; i < 100; ++i) {
+    resp.MakeHead(StringPiece("Content-Type: text/html\r\nContent-Length: 5\r\n"), &buffer);
+    resp.MakeHead(1234, &buffer);
+    resp.MakeNotModified("\"abc\"", 784111777, &buffer);
+    buffer.RetrieveAll();
+  }
+  CHECK_EQ(g_allocations - before, 0u);
+}
+
+int main(int argc, char *argv[]) {
+  TestFragments();
+  TestNoAllocation();
+  LogInfo("TestHttpHeaderWriter passed.");
+  return 0;
+}
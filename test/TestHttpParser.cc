@@ -0,0 +1,237 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-21 14:20:05
+ * @Contact: 2458006466@qq.com
+ * @Description: TestHttpParser
+ */
+#include "Http/HttpParser.h"
+#include "Http/HttpContext.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include <string>
+#include <cstring>
+
+using namespace NAMESPACE;
+
+static const std::string kRequest =
+  "GET /index.html?user=mirror&id=7 HTTP/1.1\r\n"
+  "Host: 127.0.0.1:8080\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+  "Accept:text/html,application/xhtml+xml  \r\n"
+  "Cookie: \r\n"
+  "Connection: keep-alive\r\n"
+  "\r\n";
+
+static void CheckRequest(const HttpParser &parser) {
+  CHECK(parser.method() == "GET");
+  CHECK(parser.path() == "/index.html");
+  CHECK(parser.query() == "user=mirror&id=7");
+  CHECK(parser.version() == "1.1");
+  CHECK_EQ(parser.headerCount(), 5u);
+  CHECK(parser.headerName(0) == "Host");
+  CHECK(parser.headerValue(0) == "127.0.0.1:8080");
+  CHECK(parser.headerValue(2) == "text/html,application/xhtml+xml");
+  CHECK(parser.headerValue(3).empty());
+  CHECK(parser.headerName(4) == "Connection");
+  CHECK(parser.headerValue(4) == "keep-alive");
+  CHECK_EQ(parser.headSize(), kRequest.size());
+}
+
+/// @brief 在每个字节处截断请求，模拟任意TCP分段，解析结果须与一次性解析一致
+static void TestSplitAtEveryByte() {
+  for (size_t split = 0; split <= kRequest.size(); ++split) {
+    HttpParser parser;
+    Buffer buffer;
+    buffer.Append(kRequest.data(), split);
+    HttpParser::Status status = parser.Parse(buffer.peek(), buffer.ReadableBytes());
+    if (split < kRequest.size()) {
+      CHECK_EQ(status, HttpParser::kNeedMore);
+    }
+    // 追加剩余数据可能触发缓冲区搬移，解析器只保存偏移量不受影响
+    buffer.Append(kRequest.data() + split, kRequest.size() - split);
+    status = parser.Parse(buffer.peek(), buffer.ReadableBytes());
+    CHECK_EQ(status, HttpParser::kComplete);
+    CheckRequest(parser);
+  }
+}
+
+/// @brief 逐字节喂入数据
+static void TestByteByByte() {
+  HttpParser parser;
+  HttpParser::Status status = HttpParser::kNeedMore;
+  for (size_t i = 1; i <= kRequest.size(); ++i) {
+    status = parser.Parse(kRequest.data(), i);
+    CHECK(i == kRequest.size() || status == HttpParser::kNeedMore);
+  }
+  CHECK_EQ(status, HttpParser::kComplete);
+  CheckRequest(parser);
+}
+
+static void TestPipelined() {
+  std::string data = kRequest + "\r\nPOST /login.html HTTP/1.0\r\nContent-Length: 0\r\n\r\n";
+  HttpParser parser;
+  CHECK_EQ(parser.Parse(data.data(), data.size()), HttpParser::kComplete);
+  CheckRequest(parser);
+
+  size_t offset = parser.headSize();
+  parser.Reset();
+  CHECK_EQ(parser.Parse(data.data() + offset, data.size() - offset), HttpParser::kComplete);
+  CHECK(parser.method() == "POST");
+  CHECK(parser.path() == "/login.html");
+  CHECK(parser.query().empty());
+  CHECK(parser.version() == "1.0");
+  CHECK_EQ(parser.headerCount(), 1u);
+}
+
+static void TestMalformed() {
+  const char *cases[] = {
+    "GET /index.html\r\n\r\n",
+    "GET  /index.html HTTP/1.1\r\n\r\n",
+    "G(T / HTTP/1.1\r\n\r\n",
+    "GET / HTTQ/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nBad Header: x\r\n\r\n",
+    "GET / HTTP/1.1\r\n: empty\r\n\r\n",
+    "GET / HTTP/1.1\rX\r\n\r\n",
+  };
+  for (const char *req : cases) {
+    HttpParser parser;
+    CHECK_EQ(parser.Parse(req, strlen(req)), HttpParser::kError) << req;
+  }
+
+  // 超长头部
+  std::string huge = "GET / HTTP/1.1\r\nCookie: " + std::string(HttpParser::kMaxHeadSize, 'a');
+  HttpParser parser;
+  CHECK_EQ(parser.Parse(huge.data(), huge.size()), HttpParser::kError);
+}
+
+/// @brief 逐字节喂入请求，返回解析结果，完整请求的请求体写入body
+static bool FeedByteByByte(HttpContext *context, const std::string &data, std::string *body) {
+  Buffer buffer;
+  for (char ch : data) {
+    buffer.Append(&ch, 1);
+    if (!context->ParseRequest(&buffer, Timestamp::Now())) {
+      return false;
+    }
+    if (context->gotAll()) {
+      *body = context->request().body().ToString();
+      buffer.Retrieve(context->requestSize());
+      context->Reset();
+    }
+  }
+  return true;
+}
+
+static void TestBody() {
+  HttpContext context;
+  std::string body;
+  CHECK(FeedByteByByte(&context, "PUT /a HTTP/1.1\r\nContent-Length: 12\r\n\r\nhello\r\nworld", &body));
+  CHECK_EQ(body, "hello\r\nworld");
+  CHECK(FeedByteByByte(&context,
+    "PUT /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nX: y\r\n\r\n", &body));
+  CHECK_EQ(body, "hello world");
+
+  // 流式接收：请求体分段交给回调，结束时以空数据回调
+  std::string streamed;
+  int calls = 0;
+  HttpContext::BodyCallback cb = [&](const HttpRequest &req, const StringPiece &data) {
+    CHECK_EQ(req.getHeader("Host").ToString(), "x");
+    streamed.append(data.data(), data.size());
+    ++calls;
+    return true;
+  };
+  context.setBodySelector([&](const HttpRequest &) { return &cb; });
+  CHECK(FeedByteByByte(&context, "PUT /a HTTP/1.1\r\nHost: x\r\nContent-Length: 4\r\n\r\nabcd", &body));
+  CHECK_EQ(streamed, "abcd");
+  CHECK_EQ(calls, 5);
+  context.setBodySelector(HttpContext::BodySelector());
+
+  // 非法分帧
+  const char *bad[] = {
+    "PUT /a HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+    "PUT /a HTTP/1.1\r\nContent-Length: 1\r\nTransfer-Encoding: chunked\r\n\r\n",
+    "PUT /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    "PUT /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n",
+  };
+  for (const char *req : bad) {
+    context.Reset();
+    CHECK(!FeedByteByByte(&context, req, &body)) << req;
+    CHECK_EQ(context.errorCode(), 400) << req;
+  }
+  context.Reset();
+  CHECK(!FeedByteByByte(&context, "PUT /a HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", &body));
+  CHECK_EQ(context.errorCode(), 501);
+  context.Reset();
+  context.setMaxBodySize(3);
+  CHECK(!FeedByteByByte(&context, "PUT /a HTTP/1.1\r\nContent-Length: 4\r\n\r\n", &body));
+  CHECK_EQ(context.errorCode(), 413);
+}
+
+/// @brief 头部与请求体分两次到达，期间缓冲区被搬移，头部视图不得指向旧内存
+static void TestBodyAfterMove() {
+  const std::string value(4096, 'v');
+  const std::string body = "user=mirror&data=" + value;
+  const std::string head = "POST /register HTTP/1.1\r\n"
+                           "Content-Type: application/x-www-form-urlencoded\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+  HttpContext context;
+  Buffer first;
+  first.Append(head.data(), head.size());
+  CHECK(context.ParseRequest(&first, Timestamp::Now()));
+  CHECK(!context.gotAll());
+
+  // 模拟MakeSpace搬移数据：内容移到新缓冲区，旧内存被覆盖
+  Buffer second;
+  second.Append(first.peek(), first.ReadableBytes());
+  memset(const_cast<char *>(first.peek()), 'x', first.ReadableBytes());
+  second.Append(body.data(), body.size());
+  CHECK(context.ParseRequest(&second, Timestamp::Now()));
+  CHECK(context.gotAll());
+  const HttpRequest &req = context.request();
+  CHECK_EQ(req.getHeader("Content-Type").ToString(), "application/x-www-form-urlencoded");
+  CHECK_EQ(req.getPost("user"), "mirror");
+  CHECK_EQ(req.getPost("data"), value);
+  CHECK_EQ(context.requestSize(), head.size() + body.size());
+}
+
+/// @brief 请求路径规范化后再路由，"."、".."及重复的'/'不能绕过按路径的校验
+static void TestNormalizePath() {
+  const char *cases[][2] = {
+    { "/welcome.html", "/welcome.html" },
+    { "//welcome.html", "/welcome.html" },
+    { "/./welcome.html", "/welcome.html" },
+    { "/x/../welcome.html", "/welcome.html" },
+    { "/x//y/./../z", "/x/z" },
+    { "/x/y/..", "/x/" },
+    { "/x/.", "/x/" },
+    { "/x/", "/x/" },
+    { "/.well-known/a", "/.well-known/a" },
+    { "/..a/b", "/..a/b" },
+  };
+  for (const auto &item : cases) {
+    HttpContext context;
+    Buffer buffer;
+    buffer.Append("GET " + std::string(item[0]) + " HTTP/1.1\r\n\r\n");
+    CHECK(context.ParseRequest(&buffer, Timestamp::Now()) && context.gotAll()) << item[0];
+    CHECK_EQ(context.request().path(), item[1]) << item[0];
+  }
+  const char *bad[] = { "/../welcome.html", "/x/../../welcome.html", "//..//a" };
+  for (const char *path : bad) {
+    HttpContext context;
+    Buffer buffer;
+    buffer.Append("GET " + std::string(path) + " HTTP/1.1\r\n\r\n");
+    CHECK(!context.ParseRequest(&buffer, Timestamp::Now())) << path;
+    CHECK_EQ(context.errorCode(), 400) << path;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  TestSplitAtEveryByte();
+  TestByteByByte();
+  TestPipelined();
+  TestMalformed();
+  TestBody();
+  TestBodyAfterMove();
+  TestNormalizePath();
+  LogInfo("TestHttpParser passed.");
+  return 0;
+}
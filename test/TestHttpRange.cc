@@ -0,0 +1,125 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-29 14:22:36
+ * @Contact: 2458006466@qq.com
+ * @Description: TestHttpRange
+ */
+#include "Http/HttpRange.h"
+#include "Http/HttpResponse.h"
+#include "Http/HttpContext.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include <string>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static void TestParse() {
+  std::vector<HttpRange::ByteRange> ranges;
+  CHECK_EQ(HttpRange::Parse("bytes=0-499", 1000, &ranges), HttpRange::kSatisfiable);
+  CHECK(ranges.size() == 1 && ranges[0].offset == 0 && ranges[0].length == 500);
+  CHECK_EQ(HttpRange::Parse("bytes=900-", 1000, &ranges), HttpRange::kSatisfiable);
+  CHECK(ranges.size() == 1 && ranges[0].offset == 900 && ranges[0].length == 100);
+  CHECK_EQ(HttpRange::Parse("bytes=-300", 1000, &ranges), HttpRange::kSatisfiable);
+  CHECK(ranges.size() == 1 && ranges[0].offset == 700 && ranges[0].length == 300);
+  CHECK_EQ(HttpRange::Parse("bytes=-3000", 1000, &ranges), HttpRange::kSatisfiable);
+  CHECK(ranges.size() == 1 && ranges[0].offset == 0 && ranges[0].length == 1000);
+  CHECK_EQ(HttpRange::Parse("Bytes=990-99999999999999999999999", 1000, &ranges), HttpRange::kSatisfiable);
+  CHECK(ranges.size() == 1 && ranges[0].offset == 990 && ranges[0].length == 10);
+
+  // 排序并合并重叠及相邻区间，超出长度的区间丢弃
+  CHECK_EQ(HttpRange::Parse("bytes=500-599, 0-9,5-19,20-29 ,2000-", 1000, &ranges), HttpRange::kSatisfiable);
+  CHECK_EQ(ranges.size(), 2u);
+  CHECK(ranges[0].offset == 0 && ranges[0].length == 30);
+  CHECK(ranges[1].offset == 500 && ranges[1].length == 100);
+
+  // 无法满足
+  CHECK_EQ(HttpRange::Parse("bytes=1000-", 1000, &ranges), HttpRange::kUnsatisfiable);
+  CHECK_EQ(HttpRange::Parse("bytes=-0", 1000, &ranges), HttpRange::kUnsatisfiable);
+  CHECK_EQ(HttpRange::Parse("bytes=0-", 0, &ranges), HttpRange::kUnsatisfiable);
+
+  // 语法错误或区间过多则忽略
+  const char *ignored[] = { "items=0-1", "bytes=", "bytes=5-1", "bytes=a-b", "bytes=1", "bytes=0-1,x" };
+  for (const char *range : ignored) {
+    CHECK_EQ(HttpRange::Parse(range, 1000, &ranges), HttpRange::kIgnore) << range;
+  }
+  std::string many = "bytes=0-0";
+  for (size_t i = 1; i <= HttpRange::kMaxRanges; ++i) {
+    many += "," + std::to_string(i * 2) + "-" + std::to_string(i * 2);
+  }
+  CHECK_EQ(HttpRange::Parse(many, 1000, &ranges), HttpRange::kIgnore);
+}
+
+/// @brief 以请求头部初始化响应并生成区间响应，返回头部，响应体写入body
+static bool MakeRange(HttpResponse *resp, const std::string &headers, const std::string &content,
+                      std::string *head, std::string *body) {
+  HttpContext context;
+  Buffer buffer;
+  buffer.Append("GET /a.txt HTTP/1.1\r\n" + headers + "\r\n");
+  CHECK(context.ParseRequest(&buffer, Timestamp::Now()) && context.gotAll());
+  resp->Init("", "/a.txt", true);
+  resp->setConditional(context.request());
+  Buffer out;
+  if (!resp->MakeRange(content.data(), content.size(), "text/plain", "\"e\"", 784111777, &out)) {
+    return false;
+  }
+  *head = out.RetrieveAllAsString();
+  body->clear();
+  if (resp->body()) {
+    body->assign(resp->body(), resp->bodySize());
+  }
+  for (const StringPiece &part : resp->bodyParts()) {
+    body->append(part.data(), part.size());
+  }
+  return true;
+}
+
+static void TestResponse() {
+  std::string content = "0123456789abcdefghij";
+  HttpResponse resp;
+  std::string head;
+  std::string body;
+  CHECK(!MakeRange(&resp, "", content, &head, &body));
+
+  // 单区间直接引用原内容
+  CHECK(MakeRange(&resp, "Range: bytes=5-9\r\n", content, &head, &body));
+  CHECK(head.find("HTTP/1.1 206 Partial Content\r\n") == 0);
+  CHECK(head.find("Content-Range: bytes 5-9/20\r\n") != std::string::npos);
+  CHECK(head.find("Content-Length: 5\r\n") != std::string::npos);
+  CHECK(head.find("ETag: \"e\"\r\n") != std::string::npos);
+  CHECK_EQ(body, "56789");
+  CHECK(resp.body() == content.data() + 5);
+
+  // 多区间
+  CHECK(MakeRange(&resp, "Range: bytes=0-1,-2\r\n", content, &head, &body));
+  size_t pos = head.find("Content-Type: multipart/byteranges; boundary=");
+  CHECK(pos != std::string::npos);
+  std::string boundary = head.substr(pos + 45, head.find("\r\n", pos) - pos - 45);
+  CHECK(head.find("Content-Length: " + std::to_string(body.size()) + "\r\n") != std::string::npos);
+  std::string expected =
+    "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/20\r\n\r\n01"
+    "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 18-19/20\r\n\r\nij"
+    "\r\n--" + boundary + "--\r\n";
+  CHECK_EQ(body, expected);
+  CHECK(!resp.body());
+
+  // 无法满足
+  CHECK(MakeRange(&resp, "Range: bytes=100-\r\n", content, &head, &body));
+  CHECK(head.find("HTTP/1.1 416 Range Not Satisfiable\r\n") == 0);
+  CHECK(head.find("Content-Range: bytes */20\r\n") != std::string::npos);
+  CHECK(body.empty());
+
+  // If-Range不匹配时发送完整内容
+  CHECK(MakeRange(&resp, "Range: bytes=0-1\r\nIf-Range: \"e\"\r\n", content, &head, &body));
+  CHECK(MakeRange(&resp, "Range: bytes=0-1\r\nIf-Range: Sun, 06 Nov 1994 08:49:37 GMT\r\n", content, &head, &body));
+  CHECK(!MakeRange(&resp, "Range: bytes=0-1\r\nIf-Range: \"x\"\r\n", content, &head, &body));
+  CHECK(!MakeRange(&resp, "Range: bytes=0-1\r\nIf-Range: W/\"e\"\r\n", content, &head, &body));
+  CHECK(!MakeRange(&resp, "Range: bytes=0-1\r\nIf-Range: Sun, 06 Nov 1994 08:49:38 GMT\r\n", content, &head, &body));
+}
+
+int main(int argc, char *argv[]) {
+  TestParse();
+  TestResponse();
+  LogInfo("TestHttpRange passed.");
+  return 0;
+}
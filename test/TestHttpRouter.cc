@@ -0,0 +1,155 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-31 16:20:09
+ * @Contact: 2458006466@qq.com
+ * @Description: TestHttpRouter
+ */
+#include "Http/HttpRouter.h"
+#include "Http/HttpRequest.h"
+#include "Http/HttpResponse.h"
+#include "Base/Logger.h"
+#include "Base/Timestamp.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace NAMESPACE;
+
+/// @brief 统计本进程的堆分配次数
+static std::atomic<size_t> g_allocations(0);
+
+// 替换的new及delete均不内联，否则GCC在调用处看到malloc与delete配对会误报-Wmismatched-new-delete
+__attribute__((noinline)) void *operator new(size_t size) {
+  ++g_allocations;
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+/// @brief 处理函数把路由名写入响应路径，便于校验命中的是哪条路由
+static HttpRouter::Handler Named(const std::string &name) {
+  return [name](const HttpRequest &, HttpResponse *resp) {
+    resp->setPath(name);
+  };
+}
+
+/// @brief 查找并调用处理函数，返回命中的路由名，未命中返回空
+static std::string Dispatch(const HttpRouter &router, HttpRequest::Method method,
+                            const std::string &path, HttpRequest *req) {
+  req->setPath(path);
+  const HttpRouter::Route *route = router.Find(method, req->path(), req);
+  if (!route) {
+    return "";
+  }
+  HttpResponse resp;
+  route->handler(*req, &resp);
+  return resp.path();
+}
+
+static void TestMatch() {
+  HttpRouter router;
+  CHECK(router.Add(HttpRequest::kGet, "/", Named("root")));
+  CHECK(router.Add(HttpRequest::kGet, "/user", Named("user")));
+  CHECK(router.Add(HttpRequest::kGet, "/users", Named("users")));
+  CHECK(router.Add(HttpRequest::kGet, "/user/new", Named("user-new")));
+  CHECK(router.Add(HttpRequest::kGet, "/user/:id", Named("user-id")));
+  CHECK(router.Add(HttpRequest::kPost, "/user/:id", Named("user-id-post")));
+  CHECK(router.Add(HttpRequest::kGet, "/user/:id/posts/:post", Named("user-post")));
+  CHECK(router.Add(HttpRequest::kGet, "/static/*filepath", Named("static")));
+  CHECK(router.Add(HttpRequest::kGet, "/src/:name/raw", Named("src-raw")));
+  CHECK(router.Add(HttpRequest::kGet, "/src/*filepath", Named("src")));
+  CHECK_EQ(router.size(), 10u);
+
+  // 非法及冲突的路由
+  CHECK(!router.Add(HttpRequest::kGet, "user", Named("x")));
+  CHECK(!router.Add(HttpRequest::kGet, "/user/:name", Named("x")));
+  CHECK(!router.Add(HttpRequest::kGet, "/a/*path/b", Named("x")));
+  CHECK(!router.Add(HttpRequest::kGet, "/a/:", Named("x")));
+  CHECK(!router.Add(HttpRequest::kGet, "/user", Named("x")));
+  CHECK(!router.Add(HttpRequest::kGet, "/:a/:b/:c/:d/:e/:f/:g/:h/:i", Named("x")));
+
+  HttpRequest req;
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/", &req), "root");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/user", &req), "user");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/users", &req), "users");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/use", &req), "");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/user/", &req), "");
+
+  // 静态优先于参数
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/user/new", &req), "user-new");
+  CHECK_EQ(req.paramCount(), 0u);
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/user/newer", &req), "user-id");
+  CHECK(req.param("id") == "newer");
+  CHECK_EQ(Dispatch(router, HttpRequest::kPost, "/user/42", &req), "user-id-post");
+  CHECK(req.param("id") == "42");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/user/42/posts/7", &req), "user-post");
+  CHECK(req.param("id") == "42" && req.param("post") == "7");
+  CHECK(req.param("missing").empty());
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/user/42/posts", &req), "");
+
+  // 通配匹配剩余路径，参数失败时回溯到通配
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/static/css/a.css", &req), "static");
+  CHECK(req.param("filepath") == "css/a.css");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/static/", &req), "static");
+  CHECK(req.param("filepath").empty());
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/src/lib/raw", &req), "src-raw");
+  CHECK(req.param("name") == "lib");
+  CHECK_EQ(Dispatch(router, HttpRequest::kGet, "/src/lib/raw/x", &req), "src");
+  CHECK(req.param("filepath") == "lib/raw/x");
+  CHECK(req.param("name").empty());
+
+  // HEAD使用GET的处理函数，区分路径不存在与方法不支持
+  CHECK_EQ(Dispatch(router, HttpRequest::kHead, "/user/new", &req), "user-new");
+  bool path_matched = true;
+  CHECK(!router.Find(HttpRequest::kDelete, "/user/1", &req, &path_matched));
+  CHECK(path_matched);
+  CHECK(!router.Find(HttpRequest::kDelete, "/nothing", &req, &path_matched));
+  CHECK(!path_matched);
+}
+
+static void TestNoAllocation() {
+  HttpRouter router;
+  for (int i = 0; i < 2000; ++i) {
+    std::string id = std::to_string(i);
+    CHECK(router.Add(HttpRequest::kGet, "/api/v1/item" + id + "/:key", Named(id)));
+    CHECK(router.Add(HttpRequest::kPost, "/api/v1/item" + id + "/:key/*rest", Named(id)));
+  }
+  HttpRequest req;
+  req.setPath("/api/v1/item1234/abc/d/e");
+  std::string get_path = "/api/v1/item1999/xyz";
+
+  size_t before = g_allocations;
+  const HttpRouter::Route *post = nullptr;
+  const HttpRouter::Route *get = nullptr;
+  for (int i = 0; i < 1000; ++i) {
+    post = router.Find(HttpRequest::kPost, req.path(), &req);
+    get = router.Find(HttpRequest::kGet, get_path, nullptr);
+  }
+  CHECK_EQ(g_allocations - before, 0u);
+  CHECK(post && get);
+  CHECK(req.param("key") == "abc" && req.param("rest") == "d/e");
+
+  // 副本的参数指向副本自身的路径
+  HttpRequest copy(req);
+  CHECK(copy.param("rest") == "d/e");
+  CHECK(copy.param("rest").data() >= copy.path().data() &&
+        copy.param("rest").data() < copy.path().data() + copy.path().size());
+}
+
+int main(int argc, char *argv[]) {
+  TestMatch();
+  TestNoAllocation();
+  LogInfo("TestHttpRouter passed.");
+  return 0;
+}
@@ -8,6 +8,8 @@
 #include "Http/HttpRequest.h"
 #include "Http/HttpResponse.h"
 #include "Http/HttpServer.h"
+#include "Http/AccountHandler.h"
+#include "Database/MappedUserStore.h"
 #include "Base/Timestamp.h"
 #include <fstream>
 #include <sstream>
@@ -19,7 +21,15 @@ int main(int argc, char *argv[]) {
   setLogLevel(1);
   EventLoop loop;
   HttpServer server(&loop, InetAddress("0.0.0.0", 8080), "http-server", "../data/resources/html");
-  server.InitDatabase("localhost", "mirror", "cjy", "webdb", 3306, 8);
+  if (argc > 1) {
+    // 指定账号日志文件时不连接数据库
+    MappedUserStore::Options options;
+    options.path = argv[1];
+    AccountHandler::setUserStore(std::unique_ptr<UserStore>(new MappedUserStore(options)));
+  } else {
+    server.InitDatabase("localhost", "mirror", "cjy", "webdb", 3306, 8);
+  }
+  AccountHandler::Install(&server);
   server.Start();
   loop.Loop();
 }
@@ -0,0 +1,99 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-07 15:18:26
+ * @Contact: 2458006466@qq.com
+ * @Description: TestInsertBatcher
+ */
+#include "Database/InsertBatcher.h"
+#include "Database/ConnectionPool.h"
+#include "Base/Logger.h"
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kThreads = 8;
+static const int kRowsPerThread = 25;
+
+/// @brief 设置环境变量MIRROR_MYSQL="host:port:user:passwd:dbname"时写入本地MariaDB/MySQL的临时表，
+/// 校验合并写入及唯一约束冲突时的逐行结果，否则校验没有可用连接时每行都失败
+static bool InitFromEnv(ConnectionPool *pool) {
+  const char *env = getenv("MIRROR_MYSQL");
+  if (!env) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(env);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  CHECK_EQ(fields.size(), 5u) << "MIRROR_MYSQL=host:port:user:passwd:dbname";
+  // 临时表只在创建它的连接上可见，连接池只保留一条连接
+  return pool->Init(fields[0], fields[2], fields[3], fields[4], static_cast<unsigned int>(atoi(fields[1].c_str())), 1);
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  ConnectionPool *pool = ConnectionPool::getInstance();
+  bool live = InitFromEnv(pool);
+  if (live) {
+    ConnectionPoolRAII raii(pool);
+    CHECK(raii.Execute("CREATE TEMPORARY TABLE batch_test (name VARCHAR(32) PRIMARY KEY, passwd VARCHAR(32))"));
+  }
+
+  InsertBatcher::Options options;
+  options.table = "batch_test";
+  options.columns = { "name", "passwd" };
+  options.max_rows = 32;
+  options.max_delay_ms = 20;
+  std::atomic<int> succeeded(0);
+  std::atomic<int> failed(0);
+  {
+    InsertBatcher batcher(pool, options);
+    // 批次只按固定的几种行数拆分，预处理语句数量有上限
+    CHECK(batcher.chunkRows() == std::vector<size_t>({ 32, 8, 2, 1 }));
+    // 1.多个线程同时提交，其中一行与其他行重复
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < kRowsPerThread; ++i) {
+          int id = (t == 0 && i == 0) ? 1 : t * kRowsPerThread + i;
+          bool ok = batcher.Insert({ "user" + std::to_string(id), "passwd" });
+          ++(ok ? succeeded : failed);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    // 2.异步提交，析构时写完已提交的行
+    for (int i = 0; i < 10; ++i) {
+      batcher.Insert({ "async" + std::to_string(i), "passwd" }, [&](bool ok) {
+        ++(ok ? succeeded : failed);
+      });
+    }
+    InsertBatcher::Stats stats = batcher.stats();
+    CHECK_LT(stats.batches, static_cast<uint64_t>(kThreads * kRowsPerThread));
+    CHECK_EQ(stats.commit_failures, 0u);
+    LogInfo("batches {}, rows {}, failed {}, fallbacks {}.", stats.batches, stats.rows, stats.failed_rows, stats.fallbacks);
+  }
+
+  int total = kThreads * kRowsPerThread + 10;
+  CHECK_EQ(succeeded + failed, total);
+  if (live) {
+    CHECK_EQ(failed.load(), 1);
+    ConnectionPoolRAII raii(pool);
+    ResultSet rs = raii.Query("SELECT COUNT(*) FROM batch_test");
+    CHECK(rs.Next() && rs.row().getInt64(0) == total - 1);
+  } else {
+    CHECK_EQ(failed.load(), total);
+  }
+  LogInfo("TestInsertBatcher passed.");
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-14 15:20:43
+ * @Contact: 2458006466@qq.com
+ * @Description: TestKeepAlive
+ */
+#include "Http/HttpServer.h"
+#include "Base/Logger.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace NAMESPACE;
+
+static const int kPort = 18182;
+static const int kTimeout = 1;
+static const int kMaxRequests = 3;
+
+static bool KeepAlive(const char *version, const char *connection) {
+  HttpRequest req;
+  req.setVersion(version);
+  if (connection) {
+    req.AddHeader("Connection", connection);
+  }
+  return req.IsKeepAlive();
+}
+
+static void TestIsKeepAlive() {
+  // HTTP/1.1默认持久连接，HTTP/1.0须显式声明，选项不区分大小写
+  CHECK(KeepAlive("1.1", nullptr));
+  CHECK(KeepAlive("1.1", "keep-alive"));
+  CHECK(KeepAlive("1.1", "Upgrade"));
+  CHECK(!KeepAlive("1.1", "close"));
+  CHECK(!KeepAlive("1.1", "Close"));
+  CHECK(!KeepAlive("1.1", "keep-alive, close"));
+  CHECK(!KeepAlive("1.0", nullptr));
+  CHECK(KeepAlive("1.0", "Keep-Alive"));
+  CHECK(KeepAlive("1.0", "TE,  keep-alive "));
+  CHECK(!KeepAlive("1.0", "keep-alive, CLOSE"));
+  CHECK(!KeepAlive("0.9", nullptr));
+}
+
+static int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(fd >= 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < 100; ++i) {
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+      return fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  CHECK(false) << "connect failed";
+  return -1;
+}
+
+static void SendAll(int fd, const std::string &data) {
+  CHECK_EQ(write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+}
+
+/// @brief 读取到服务端关闭连接为止
+static std::string ReadAll(int fd) {
+  std::string data;
+  char buf[4096];
+  ssize_t n = 0;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    data.append(buf, n);
+  }
+  close(fd);
+  return data;
+}
+
+static size_t Count(const std::string &data, const std::string &pattern) {
+  size_t count = 0;
+  for (size_t pos = data.find(pattern); pos != std::string::npos; pos = data.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+static int64_t ElapsedMs(const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunClient(EventLoop *loop) {
+  // 1.公布剩余请求数，第max个响应带Connection: close后关闭连接，其后的请求被忽略
+  int fd = Connect();
+  std::string request = "GET /hello HTTP/1.1\r\n\r\n";
+  SendAll(fd, request + request + request + request);
+  std::string responses = ReadAll(fd);
+  CHECK_EQ(Count(responses, "HTTP/1.1 200 OK\r\n"), 3u) << responses;
+  CHECK(responses.find("Keep-Alive: timeout=1, max=2\r\n") != std::string::npos) << responses;
+  CHECK(responses.find("Keep-Alive: timeout=1, max=1\r\n") != std::string::npos) << responses;
+  CHECK_EQ(Count(responses, "Connection: close\r\n"), 1u) << responses;
+  CHECK_GT(responses.rfind("Connection: close\r\n"), responses.rfind("Keep-Alive"));
+
+  // 2.HTTP/1.0默认关闭，显式声明keep-alive时保持
+  fd = Connect();
+  SendAll(fd, "GET /hello HTTP/1.0\r\n\r\n");
+  responses = ReadAll(fd);
+  CHECK(responses.find("Connection: close\r\n") != std::string::npos) << responses;
+  fd = Connect();
+  SendAll(fd, "GET /hello HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\nGET /hello HTTP/1.0\r\n\r\n");
+  responses = ReadAll(fd);
+  CHECK_EQ(Count(responses, "HTTP/1.1 200 OK\r\n"), 2u) << responses;
+  CHECK(responses.find("Connection: keep-alive\r\n") < responses.find("Connection: close\r\n")) << responses;
+
+  // 3.空闲超过timeout后关闭，收到数据时重新计时
+  auto start = std::chrono::steady_clock::now();
+  fd = Connect();
+  std::this_thread::sleep_for(std::chrono::milliseconds(kTimeout * 1000 / 2));
+  SendAll(fd, request);
+  responses = ReadAll(fd);
+  CHECK_EQ(Count(responses, "HTTP/1.1 200 OK\r\n"), 1u) << responses;
+  CHECK_GE(ElapsedMs(start), kTimeout * 1500 - 100);
+  CHECK_LT(ElapsedMs(start), kTimeout * 1500 + 1500);
+
+  // 4.没有发送任何请求的连接同样超时关闭
+  start = std::chrono::steady_clock::now();
+  CHECK(ReadAll(Connect()).empty());
+  CHECK_GE(ElapsedMs(start), kTimeout * 1000 - 100);
+
+  // 5.HEAD响应只有头部，同一连接上紧随其后的响应不错位；
+  // 覆盖动态响应体、映射的文件及错误页面三种响应体
+  fd = Connect();
+  SendAll(fd, "HEAD /hello HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\nConnection: close\r\n\r\n");
+  responses = ReadAll(fd);
+  CHECK_EQ(Count(responses, "Content-Length: 5\r\n"), 2u) << responses;
+  CHECK_EQ(Count(responses, "\r\n\r\nHTTP/1.1 200 OK\r\n"), 1u) << responses;
+  CHECK_EQ(Count(responses, "hello"), 1u) << responses;
+  CHECK_EQ(responses.substr(responses.size() - 9), "\r\n\r\nhello") << responses;
+  fd = Connect();
+  SendAll(fd, "HEAD /files/a.txt HTTP/1.1\r\n\r\nHEAD /missing HTTP/1.1\r\n\r\nGET /files/a.txt HTTP/1.1\r\n\r\n");
+  responses = ReadAll(fd);
+  CHECK_EQ(Count(responses, "Content-Length: 10\r\n"), 2u) << responses;
+  CHECK_EQ(Count(responses, "\r\n\r\nHTTP/1.1 404 Not Found\r\n"), 1u) << responses;
+  CHECK_EQ(Count(responses, "\r\n\r\nHTTP/1.1 200 OK\r\n"), 1u) << responses;
+  CHECK_EQ(Count(responses, "File not found!"), 0u) << responses;
+  CHECK_EQ(responses.substr(responses.size() - 14), "\r\n\r\nfile body\n") << responses;
+  loop->QueueInLoop(std::bind(&EventLoop::Quit, loop));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  TestIsKeepAlive();
+
+  char dir[] = "/tmp/TestKeepAlive.XXXXXX";
+  CHECK(mkdtemp(dir) != nullptr);
+  std::string file = std::string(dir) + "/a.txt";
+  FILE *fp = fopen(file.c_str(), "w");
+  CHECK(fp != nullptr);
+  fputs("file body\n", fp);
+  fclose(fp);
+
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress("127.0.0.1", kPort), "keep-alive-test", "/nonexistent");
+  server.setKeepAlive(kTimeout, kMaxRequests);
+  server.Get("/hello", [](const HttpRequest &, HttpResponse *resp) {
+    resp->MakeResponse("hello", "text/plain");
+  });
+  server.Static("/files/", dir);
+  server.Start();
+  std::thread client(RunClient, &loop);
+  loop.Loop();
+  client.join();
+  unlink(file.c_str());
+  rmdir(dir);
+  LogInfo("TestKeepAlive passed.");
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-08 17:12:05
+ * @Contact: 2458006466@qq.com
+ * @Description: TestLruCache
+ */
+#include "Base/LruCache.h"
+#include "Base/Logger.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NAMESPACE;
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  // 1.单个分片时按最久未使用淘汰
+  {
+    ShardedLruCache<int> cache(3, 1);
+    int value = 0;
+    cache.Put("a", 1, 60000);
+    cache.Put("b", 2, 60000);
+    cache.Put("c", 3, 60000);
+    CHECK(cache.Get("a", &value) && value == 1);
+    cache.Put("d", 4, 60000);
+    CHECK(!cache.Get("b", &value));
+    CHECK(cache.Get("c", &value) && value == 3);
+    CHECK(cache.Erase("c") && !cache.Erase("c"));
+    CHECK_EQ(cache.stats().evictions, 1u);
+  }
+
+  // 2.过期的元素不再命中
+  {
+    ShardedLruCache<std::string> cache(64, 4);
+    std::string value;
+    cache.Put("short", "x", 20);
+    cache.Put("long", "y", 60000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    CHECK(!cache.Get("short", &value));
+    CHECK(cache.Get("long", &value) && value == "y");
+    CHECK_EQ(cache.stats().expirations, 1u);
+    CHECK_EQ(cache.size(), 1u);
+  }
+
+  // 3.多线程访问不同分片，命中率统计
+  {
+    ShardedLruCache<int> cache(1024);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&cache, t]() {
+        for (int i = 0; i < 1000; ++i) {
+          std::string key = "user" + std::to_string(t * 100 + i % 100);
+          int value = 0;
+          if (!cache.Get(key, &value)) {
+            cache.Put(key, i, 60000);
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    LruCacheStats stats = cache.stats();
+    CHECK_EQ(stats.hits + stats.misses, 4000u);
+    CHECK_EQ(stats.misses, 400u);
+    CHECK_GT(stats.hitRatio(), 0.89);
+    LogInfo("hit ratio {}.", stats.hitRatio());
+  }
+  LogInfo("TestLruCache passed.");
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-05 14:20:18
+ * @Contact: 2458006466@qq.com
+ * @Description: TestPreparedStatement
+ */
+#include "Database/ConnectionPool.h"
+#include "Base/Logger.h"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace NAMESPACE;
+
+/// @brief 设置环境变量MIRROR_MYSQL="host:port:user:passwd:dbname"时连接本地MariaDB/MySQL
+/// 校验参数绑定、长字段扩容及语句缓存，否则只校验没有可用连接时的失败路径
+static bool InitFromEnv(ConnectionPool *pool) {
+  const char *env = getenv("MIRROR_MYSQL");
+  if (!env) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(env);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  CHECK_EQ(fields.size(), 5u) << "MIRROR_MYSQL=host:port:user:passwd:dbname";
+  pool->Init(fields[0], fields[2], fields[3], fields[4], static_cast<unsigned int>(atoi(fields[1].c_str())), 2);
+  return true;
+}
+
+static void TestLive(ConnectionPool *pool) {
+  ConnectionPoolRAII raii(pool);
+  CHECK(raii.Execute("CREATE TEMPORARY TABLE stmt_test (id BIGINT, name TEXT)"));
+
+  // 1.参数中的引号无需转义，超过初始缓冲区的值在Fetch时扩容
+  const std::string quoted = "o'neil \"--";
+  const std::string large(4096, 'x');
+  PreparedStatement *insert = raii.Prepare("INSERT INTO stmt_test (id, name) VALUES (?, ?)");
+  CHECK(insert);
+  CHECK(insert->Bind(0, int64_t(1)).Bind(1, quoted).Execute());
+  CHECK(insert->Bind(0, int64_t(2)).Bind(1, large).Execute());
+  CHECK(insert->Bind(0, int64_t(3)).BindNull(1).Execute());
+  CHECK_EQ(insert->affectedRows(), 1u);
+
+  PreparedStatement *select = raii.Prepare("SELECT id, name FROM stmt_test WHERE id >= ? ORDER BY id");
+  CHECK(select && select->Bind(0, int64_t(1)).Execute());
+  CHECK_EQ(select->numRows(), 3u);
+  CHECK(select->Fetch() && select->getString(0) == "1" && select->getString(1) == quoted);
+  CHECK(select->Fetch() && select->getString(1) == large);
+  CHECK(select->Fetch() && select->isNull(1));
+  CHECK(!select->Fetch());
+
+  // 2.相同文本的语句复用缓存
+  CHECK(raii.Prepare("SELECT id, name FROM stmt_test WHERE id >= ? ORDER BY id") == select);
+  CHECK(!raii.Prepare("SELECT * FROM stmt_test_missing"));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  ConnectionPool *pool = ConnectionPool::getInstance();
+  if (InitFromEnv(pool)) {
+    TestLive(pool);
+  } else {
+    ConnectionPoolRAII raii(pool);
+    CHECK(raii.Prepare("SELECT 1") == nullptr);
+  }
+  LogInfo("TestPreparedStatement passed.");
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-06 17:03:44
+ * @Contact: 2458006466@qq.com
+ * @Description: TestResultSet
+ */
+#include "Database/ConnectionPool.h"
+#include "Base/Logger.h"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kRows = 1000;
+static const std::string kSelect =
+  "WITH RECURSIVE s(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM s WHERE n < " + std::to_string(kRows) + ") "
+  "SELECT n, IF(n % 2 = 1, 'row', NULL) FROM s";
+
+/// @brief 设置环境变量MIRROR_MYSQL="host:port:user:passwd:dbname"时连接本地MariaDB/MySQL
+/// 校验逐行读取、未读完时自动排空及移动语义，否则只校验无效结果集
+static bool InitFromEnv(ConnectionPool *pool) {
+  const char *env = getenv("MIRROR_MYSQL");
+  if (!env) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(env);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  CHECK_EQ(fields.size(), 5u) << "MIRROR_MYSQL=host:port:user:passwd:dbname";
+  return pool->Init(fields[0], fields[2], fields[3], fields[4], static_cast<unsigned int>(atoi(fields[1].c_str())), 1);
+}
+
+static void TestLive(ConnectionPool *pool) {
+  ConnectionPoolRAII raii(pool);
+
+  // 1.只读部分行，析构时排空剩余的行，连接可立即执行下一条语句
+  {
+    ResultSet rs = raii.Query(kSelect);
+    CHECK(rs);
+    CHECK_EQ(rs.numFields(), 2u);
+    for (int i = 1; i <= 10; ++i) {
+      CHECK(rs.Next());
+      CHECK_EQ(rs.row().getInt64(0), i);
+      if (i % 2 == 1) {
+        CHECK(rs.row()[1] == StringPiece("row"));
+      } else {
+        CHECK(rs.row().isNull(1) && rs.row()[1].empty());
+      }
+    }
+  }
+
+  // 2.移动后由新对象负责释放，读完全部的行
+  ResultSet moved;
+  {
+    ResultSet rs = raii.Query(kSelect);
+    moved = std::move(rs);
+    CHECK(!rs && !rs.Next());
+  }
+  int64_t sum = 0;
+  while (moved.Next()) {
+    sum += moved.row().getInt64(0);
+  }
+  CHECK_EQ(moved.error(), 0u);
+  CHECK_EQ(moved.rowCount(), static_cast<uint64_t>(kRows));
+  CHECK_EQ(sum, static_cast<int64_t>(kRows) * (kRows + 1) / 2);
+  moved.Close();
+
+  // 3.执行失败时返回无效结果集
+  CHECK(!raii.Query("SELECT * FROM result_set_missing"));
+  CHECK(raii.Execute("DO 1"));
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  ConnectionPool *pool = ConnectionPool::getInstance();
+  if (InitFromEnv(pool)) {
+    TestLive(pool);
+  } else {
+    ResultSet empty;
+    CHECK(!empty && !empty.Next());
+    CHECK_EQ(empty.rowCount(), 0u);
+  }
+  LogInfo("TestResultSet passed.");
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-11 15:26:40
+ * @Contact: 2458006466@qq.com
+ * @Description: TestSessionStore
+ */
+#include "Http/SessionStore.h"
+#include "Http/HttpRequest.h"
+#include "Http/HttpResponse.h"
+#include "Base/Buffer.h"
+#include "Base/Logger.h"
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace NAMESPACE;
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  std::string snapshot = "/tmp/TestSessionStore." + std::to_string(getpid());
+  SessionStore::Options options;
+  options.snapshot = snapshot;
+  options.snapshot_interval_ms = 20;
+  std::string alice;
+  std::string empty;
+  {
+    SessionStore store(options);
+    CHECK_EQ(store.size(), 0u);
+
+    // 1.创建会话，从Cookie头部中找回
+    alice = store.Create("alice");
+    empty = store.Create("");
+    CHECK_EQ(alice.size(), 32u);
+    CHECK(alice != empty);
+    // 请求头部只保存视图，值须在请求使用期间有效
+    std::string cookie = "theme=dark; SID=" + alice + "; lang=zh";
+    HttpRequest req;
+    req.AddHeader("Cookie", cookie);
+    std::string username;
+    CHECK(store.SessionId(req) == alice);
+    CHECK(store.Find(req, &username) && username == "alice");
+    CHECK(!store.Find("0123456789abcdef0123456789abcdef", &username));
+    CHECK(!store.Find("short", &username));
+
+    // 2.删除的会话不再命中
+    std::string bob = store.Create("bob");
+    store.Remove(bob);
+    CHECK(!store.Find(bob, &username));
+
+    // 3.Set-Cookie加到响应头部中
+    HttpResponse resp;
+    resp.Init("/nonexistent", "/", false, 200);
+    resp.AddHeader("Set-Cookie", store.SetCookie(alice));
+    Buffer buffer;
+    resp.MakeResponse("ok", "text/plain", &buffer);
+    std::string head = buffer.RetrieveAllAsString();
+    CHECK(head.find("\r\nSet-Cookie: SID=" + alice + "; Path=/; Max-Age=1800; HttpOnly") != std::string::npos) << head;
+
+    // 4.后台线程写入快照
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK_EQ(access(snapshot.c_str(), R_OK), 0);
+    // 快照中的会话ID可直接登录，只允许属主读写
+    struct stat st;
+    CHECK_EQ(stat(snapshot.c_str(), &st), 0);
+    mode_t mode = st.st_mode & 0777;
+    CHECK_EQ(mode, 0600u);
+  }
+
+  // 5.重启后从快照中载入
+  {
+    SessionStore store(options);
+    CHECK_EQ(store.size(), 2u);
+    std::string username = "x";
+    CHECK(store.Find(alice, &username) && username == "alice");
+    CHECK(store.Find(empty, &username) && username.empty());
+  }
+  unlink(snapshot.c_str());
+
+  // 6.过期的会话不再命中
+  {
+    SessionStore::Options short_lived;
+    short_lived.ttl_ms = 30;
+    SessionStore store(short_lived);
+    std::string id = store.Create("carol");
+    std::string username;
+    CHECK(store.Find(id, &username));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    CHECK(!store.Find(id, &username));
+  }
+  LogInfo("TestSessionStore passed.");
+  return 0;
+}
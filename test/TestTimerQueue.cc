@@ -0,0 +1,57 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-14 11:02:15
+ * @Contact: 2458006466@qq.com
+ * @Description: TestTimerQueue
+ */
+#include "Core/EventLoop.h"
+#include "Base/Logger.h"
+#include <string>
+#include <thread>
+
+using namespace NAMESPACE;
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  EventLoop loop;
+  std::string order;
+  int ticks = 0;
+
+  // 1.按到期时间先后执行，与添加顺序无关
+  loop.RunAfter(0.06, [&order]() { order += "c"; });
+  loop.RunAfter(0.02, [&order]() { order += "a"; });
+  loop.RunAfter(0.04, [&order]() { order += "b"; });
+
+  // 2.取消未到期的定时器
+  EventLoop::TimerId cancelled = loop.RunAfter(0.03, [&order]() { order += "x"; });
+  loop.Cancel(cancelled);
+
+  // 3.周期定时器在自身回调中取消
+  EventLoop::TimerId every = 0;
+  every = loop.RunEvery(0.01, [&loop, &ticks, &every]() {
+    if (++ticks == 5) {
+      loop.Cancel(every);
+    }
+  });
+
+  // 4.其他线程添加的定时器在loop线程中执行
+  Timestamp start = Timestamp::Now();
+  std::thread other([&loop, &order, start]() {
+    loop.RunAfter(0.08, [&loop, &order, start]() {
+      CHECK(loop.isInLoopThread());
+      order += "d";
+      // 已到期的时间立即执行
+      loop.RunAt(start, [&loop]() { loop.Quit(); });
+    });
+  });
+  other.join();
+  loop.Loop();
+
+  CHECK_EQ(order, "abcd");
+  CHECK_EQ(ticks, 5);
+  int64_t elapsed_us = Timestamp::Now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+  CHECK_GE(elapsed_us, 80000);
+  CHECK_LT(elapsed_us, 1000000);
+  LogInfo("TestTimerQueue passed.");
+  return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-11-12 14:18:30
+ * @Contact: 2458006466@qq.com
+ * @Description: TestUserStore
+ */
+#include "Database/MappedUserStore.h"
+#include "Base/Logger.h"
+#include <fcntl.h>
+#include <set>
+#include <sys/stat.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace NAMESPACE;
+
+static const int kUsers = 10000;
+static const char *const kPath = "./TestUserStore.log";
+
+/// @brief 大量注册时降低迭代次数以缩短测试时间
+static MappedUserStore::Options StoreOptions(uint32_t iterations = 100) {
+  MappedUserStore::Options options;
+  options.path = kPath;
+  options.iterations = iterations;
+  return options;
+}
+
+int main(int argc, char *argv[]) {
+  setLogLevel(3);
+  ::unlink(kPath);
+  {
+    // 1.注册、登录及重复注册
+    MappedUserStore store(StoreOptions());
+    CHECK(store.ok());
+    CHECK_EQ(store.Count(), 0);
+    CHECK_EQ(store.Authenticate("alice", "secret"), UserStore::kRejected);
+    CHECK_EQ(store.Register("alice", "secret"), UserStore::kOk);
+    CHECK_EQ(store.Register("alice", "other"), UserStore::kRejected);
+    CHECK_EQ(store.Register("", ""), UserStore::kOk);
+    CHECK_EQ(store.Register(std::string(300, 'x'), "p"), UserStore::kRejected);
+    CHECK_EQ(store.Authenticate("alice", "secret"), UserStore::kOk);
+    CHECK_EQ(store.Authenticate("alice", "Secret"), UserStore::kRejected);
+    CHECK_EQ(store.Authenticate("", ""), UserStore::kOk);
+    CHECK_EQ(store.Exists("alice"), UserStore::kOk);
+    CHECK_EQ(store.Exists("bob"), UserStore::kRejected);
+
+    // 2.多线程注册，索引扩容及映射增长
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&store, t]() {
+        for (int i = t; i < kUsers; i += 4) {
+          CHECK_EQ(store.Register("user" + std::to_string(i), "pass" + std::to_string(i)), UserStore::kOk);
+          CHECK(store.Authenticate("user" + std::to_string(i / 2), "pass" + std::to_string(i / 2)) !=
+                UserStore::kError);
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    CHECK_EQ(store.Count(), kUsers + 2);
+  }
+
+  // 3.重新打开后恢复全部用户，日志中不含明文密码
+  size_t size = 0;
+  {
+    MappedUserStore store(StoreOptions());
+    CHECK_EQ(store.Count(), kUsers + 2);
+    for (int i = 0; i < kUsers; i += 7) {
+      CHECK_EQ(store.Authenticate("user" + std::to_string(i), "pass" + std::to_string(i)), UserStore::kOk);
+    }
+    CHECK_EQ(store.Authenticate("alice", "secret"), UserStore::kOk);
+    std::set<std::string> names;
+    CHECK(store.ForEachUsername([&names](const StringPiece &name) { names.insert(name.ToString()); }));
+    CHECK_EQ(names.size(), static_cast<size_t>(kUsers + 2));
+    CHECK(names.count("user9999") == 1 && names.count("") == 1);
+    size = store.fileSize();
+  }
+  FILE *file = fopen(kPath, "rb");
+  std::string content(size, '\0');
+  CHECK_EQ(fread(&content[0], 1, size, file), size);
+  fclose(file);
+  CHECK(content.find("secret") == std::string::npos);
+  CHECK(content.find("user42") != std::string::npos);
+
+  // 4.写入时崩溃留下的不完整尾部被截断，之后的追加可以恢复
+  int fd = ::open(kPath, O_WRONLY | O_APPEND);
+  CHECK_EQ(::write(fd, content.data(), 20), 20);
+  ::close(fd);
+  {
+    MappedUserStore store(StoreOptions());
+    CHECK_EQ(store.fileSize(), size);
+    CHECK_EQ(store.Count(), kUsers + 2);
+    CHECK_EQ(store.Register("carol", "pw"), UserStore::kOk);
+  }
+  {
+    MappedUserStore store(StoreOptions());
+    CHECK_EQ(store.Count(), kUsers + 3);
+    CHECK_EQ(store.Authenticate("carol", "pw"), UserStore::kOk);
+  }
+
+  // 5.提高迭代次数后，旧记录按各自保存的迭代次数验证
+  {
+    MappedUserStore store(StoreOptions(2000));
+    CHECK_EQ(store.Register("dave", "pw"), UserStore::kOk);
+    CHECK_EQ(store.Authenticate("dave", "pw"), UserStore::kOk);
+    CHECK_EQ(store.Authenticate("dave", "pw2"), UserStore::kRejected);
+    CHECK_EQ(store.Authenticate("carol", "pw"), UserStore::kOk);
+    CHECK_EQ(store.Authenticate("carol", "pw2"), UserStore::kRejected);
+  }
+  {
+    MappedUserStore store(StoreOptions());
+    CHECK_EQ(store.Count(), kUsers + 4);
+    CHECK_EQ(store.Authenticate("dave", "pw"), UserStore::kOk);
+  }
+
+  // 6.早期FNV摘要格式的文件拒绝打开，且不被截断
+  ::unlink(kPath);
+  fd = ::open(kPath, O_WRONLY | O_CREAT, 0600);
+  CHECK_EQ(::write(fd, "1RSU", 4), 4);
+  CHECK_EQ(::write(fd, std::string(60, '\0').data(), 60), 60);
+  ::close(fd);
+  {
+    MappedUserStore store(StoreOptions());
+    CHECK(!store.ok());
+    CHECK_EQ(store.Authenticate("alice", "secret"), UserStore::kError);
+  }
+  struct stat st;
+  CHECK_EQ(::stat(kPath, &st), 0);
+  CHECK_EQ(st.st_size, 64);
+
+  // 7.无法打开时返回kError
+  MappedUserStore::Options missing;
+  missing.path = "./no-such-dir/users.log";
+  MappedUserStore broken(missing);
+  CHECK(!broken.ok());
+  CHECK_EQ(broken.Authenticate("alice", "secret"), UserStore::kError);
+  CHECK_EQ(broken.Count(), -1);
+  ::unlink(kPath);
+  LogInfo("TestUserStore passed.");
+  return 0;
+}
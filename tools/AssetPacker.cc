@@ -0,0 +1,26 @@
+/*
+ * @Author: chenjingyu
+ * @Date: 2024-10-25 14:36:50
+ * @Contact: 2458006466@qq.com
+ * @Description: AssetPacker
+ */
+#include "Http/AssetBundle.h"
+#include "Base/Logger.h"
+#include <string.h>
+
+using namespace NAMESPACE;
+
+/// @brief 构建时将文档根目录打包为资源包
+/// 用法：AssetPacker <root_path> <bundle_path> [--no-gzip]
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <root_path> <bundle_path> [--no-gzip]\n", argv[0]);
+    return 1;
+  }
+  bool gzip = !(argc > 3 && strcmp(argv[3], "--no-gzip") == 0);
+  if (!AssetBundle::Pack(argv[1], argv[2], gzip)) {
+    return 1;
+  }
+  // 打包后立即校验能否正常加载
+  return AssetBundle::Open(argv[2]) ? 0 : 1;
+}